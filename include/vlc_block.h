@@ -144,6 +144,21 @@ VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
+struct block_pool_stats
+{
+    uint64_t hits; /**< allocations served from the pool */
+    uint64_t misses; /**< allocations served by the heap */
+    size_t bytes; /**< memory held by the pool */
+};
+
+/**
+ * Gets the statistics of the block_Alloc() buffer pool (see "block-pool").
+ *
+ * The counters add up over the process lifetime; they are zero if the pool
+ * was never enabled.
+ */
+VLC_API void block_pool_GetStats(struct block_pool_stats *);
+
 /**
  * Reallocates a block.
  *
@@ -229,6 +244,35 @@ static inline block_t *block_Duplicate( block_t *p_block )
  */
 VLC_API block_t *block_heap_Alloc(void *, size_t) VLC_USED VLC_MALLOC;
 
+/**
+ * Shares a block between slices.
+ *
+ * Creates a slice covering the whole payload of an existing block, from which
+ * further slices can be created with block_Slice(). The parent block is
+ * released when the last slice referencing it is released.
+ *
+ * The payload is shared without copy: a slice can be modified in place as
+ * long as no other slice covers the same bytes.
+ *
+ * @param parent block to share (released in case of error)
+ * @return NULL in case of error, or a valid block_t pointer.
+ */
+VLC_API block_t *block_slice_Alloc(block_t *parent) VLC_USED VLC_MALLOC;
+
+/**
+ * Slices a shared block.
+ *
+ * Creates a block referencing part of the payload of a slice, as created by
+ * block_slice_Alloc() or block_Slice(), without copying it.
+ * The new block has the default properties (no flags and no timestamps).
+ *
+ * @param slice slice to reference (it is not consumed)
+ * @param offset offset of the new block in the payload of the slice
+ * @param length length of the new block
+ * @return NULL in case of error, or a valid block_t pointer.
+ */
+VLC_API block_t *block_Slice(block_t *slice, size_t offset, size_t length) VLC_USED VLC_MALLOC;
+
 /**
  * Wraps a memory mapping in a block
  *
@@ -621,6 +665,89 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 
 /** @} */
 
+/**
+ * \defgroup block_ring Lock-free block queue
+ *
+ * Bounded single-producer single-consumer block queue.
+ *
+ * Unlike the block FIFO, the ring takes no lock: exactly one thread may
+ * push blocks (the producer) and exactly one thread may pop blocks (the
+ * consumer) at any given time. Producer (or consumer) calls from different
+ * threads must be serialized by the caller.
+ * @{
+ */
+
+typedef struct vlc_ring vlc_ring_t;
+
+/**
+ * Creates a lock-free block queue.
+ *
+ * @param max capacity in queued items (rounded up to a power of two)
+ * @return the queue or NULL on memory error
+ */
+VLC_API vlc_ring_t *vlc_ring_New(size_t max) VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a lock-free block queue.
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning Neither the producer nor the consumer may be using the queue.
+ */
+VLC_API void vlc_ring_Delete(vlc_ring_t *);
+
+/**
+ * Queues a linked-list of blocks (producer side).
+ *
+ * The whole list takes a single item of the queue.
+ *
+ * @param block the head of the list of blocks (must not be NULL)
+ * @return true on success, false if the queue is full (the blocks are
+ * then left untouched and still owned by the caller).
+ */
+VLC_API bool vlc_ring_Push(vlc_ring_t *, block_t *block) VLC_USED;
+
+/**
+ * Dequeues the first block, if any (consumer side).
+ *
+ * @return a single block (i.e. with a NULL p_next pointer) or NULL if the
+ * queue is empty.
+ */
+VLC_API block_t *vlc_ring_Pop(vlc_ring_t *) VLC_USED;
+
+/**
+ * Discards all blocks queued so far (producer side).
+ *
+ * The blocks are actually released by the consumer in vlc_ring_Pop().
+ * Blocks pushed afterwards are not affected.
+ */
+VLC_API void vlc_ring_Discard(vlc_ring_t *);
+
+/**
+ * Counts blocks in a lock-free queue.
+ *
+ * Discarded blocks are not counted. This can be called from any thread, but
+ * the value is only a snapshot if the producer or the consumer is active.
+ *
+ * @return the number of blocks in the queue
+ */
+VLC_API size_t vlc_ring_GetCount(const vlc_ring_t *) VLC_USED;
+
+/**
+ * Counts bytes in a lock-free queue.
+ *
+ * See vlc_ring_GetCount().
+ *
+ * @return the total number of bytes
+ */
+VLC_API size_t vlc_ring_GetBytes(const vlc_ring_t *) VLC_USED;
+
+VLC_USED static inline bool vlc_ring_IsEmpty(const vlc_ring_t *ring)
+{
+    return vlc_ring_GetCount(ring) == 0;
+}
+
+/** @} */
+
 /** @} */
 
 #endif /* VLC_BLOCK_H */
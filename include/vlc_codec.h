@@ -228,7 +228,8 @@ struct encoder_t
 
     /* Common encoder options */
     int i_threads;               /* Number of threads to use during encoding */
-    int i_iframes;               /* One I frame per i_iframes */
+    int i_iframes;               /* One I frame per i_iframes (if non-zero,
+                                    and none at scene cuts) */
     int i_bframes;               /* One B frame per i_bframes */
     int i_tolerance;             /* Bitrate tolerance */
 
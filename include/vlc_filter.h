@@ -278,6 +278,28 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Slice callback, processing the slice i_index out of i_count.
+ *
+ * It is called from any thread, concurrently with the other slices.
+ */
+typedef void (*filter_slice_cb)( filter_t *, void *opaque,
+                                 unsigned i_index, unsigned i_count );
+
+/**
+ * It returns the number of slices used by filter_ExecuteSlices().
+ *
+ * It does not change during the lifetime of the filter, so that per slice
+ * buffers can be allocated when the filter is opened.
+ */
+VLC_API unsigned filter_GetSliceCount( filter_t * );
+
+/**
+ * It calls a slice callback for each slice, on the thread pool shared by
+ * the video filters, and waits for all of them to complete.
+ */
+VLC_API void filter_ExecuteSlices( filter_t *, filter_slice_cb, void *opaque );
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
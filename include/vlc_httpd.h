@@ -71,6 +71,17 @@ VLC_API httpd_host_t *vlc_rtsp_HostNew( vlc_object_t * ) VLC_USED;
 /* delete a host */
 VLC_API void httpd_HostDelete( httpd_host_t * );
 
+/* host statistics */
+typedef struct
+{
+    uint64_t i_connections;    /* accepted connections */
+    unsigned i_clients;        /* currently connected clients */
+    uint64_t i_bytes_received;
+    uint64_t i_bytes_sent;
+} httpd_host_stats_t;
+
+VLC_API void httpd_HostGetStats( httpd_host_t *, httpd_host_stats_t * );
+
 typedef struct
 {
     char * name;
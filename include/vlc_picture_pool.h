@@ -87,6 +87,9 @@ VLC_API picture_pool_t * picture_pool_New(unsigned count,
  * This is a convenience wrapper for picture_NewFromFormat() and
  * picture_pool_New().
  *
+ * Unlike other pools, such a pool can be grown with picture_pool_Grow(), by
+ * up to 64 pictures in total.
+ *
  * @param fmt video format of pictures to allocate from the heap
  * @param count number of pictures to allocate
  *
@@ -95,6 +98,22 @@ VLC_API picture_pool_t * picture_pool_New(unsigned count,
 VLC_API picture_pool_t * picture_pool_NewFromFormat(const video_format_t *fmt,
                                                     unsigned count) VLC_USED;
 
+/**
+ * Allocates more pictures from the heap into a pool created by
+ * picture_pool_NewFromFormat().
+ *
+ * The new pictures are immediately available to picture_pool_Get() and
+ * picture_pool_Wait().
+ *
+ * @param count number of pictures to add
+ *
+ * @return VLC_SUCCESS, VLC_ENOMEM if only some pictures could be added, or
+ * VLC_EGENERIC if the pool cannot grow by that many pictures
+ *
+ * @note This function is thread-safe.
+ */
+VLC_API int picture_pool_Grow(picture_pool_t *, unsigned count);
+
 /**
  * Releases a pool created by picture_pool_NewExtended(), picture_pool_New()
  * or picture_pool_NewFromFormat().
@@ -32,6 +32,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #ifdef HAVE_FSTATVFS
 #   include <sys/statvfs.h>
 #   if defined (HAVE_SYS_MOUNT_H)
@@ -69,6 +72,9 @@ struct access_sys_t
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    uint64_t i_pos; /* of the next block, when mapping the file */
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -128,6 +134,10 @@ static bool IsRemote (const char *path)
 #endif
 
 static ssize_t Read (stream_t *, void *, size_t);
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
 static int FileSeek (stream_t *, uint64_t);
 static int NoSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
@@ -231,6 +241,19 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Mapped blocks are handed out without any copy. Remote files could
+         * be truncated behind our back, causing SIGBUS on access. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "mapping file in memory");
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+            p_access->pf_seek = MmapSeek;
+            p_sys->i_pos = 0;
+        }
 #endif
     }
     else
@@ -253,7 +276,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -287,6 +310,85 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+/** Size of the file mappings (large enough to amortize the page faults) */
+#define FILE_MMAP_SIZE (16 << 20)
+
+static block_t *BlockMmap (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct stat st;
+
+    /* The file may be growing */
+    if (fstat (p_sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+    if ((uint64_t)st.st_size <= p_sys->i_pos)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    size_t length = __MIN((uint64_t)st.st_size - p_sys->i_pos, FILE_MMAP_SIZE);
+    uint64_t page_mask = sysconf (_SC_PAGESIZE) - 1;
+    uint64_t offset = p_sys->i_pos & ~page_mask;
+    size_t skip = p_sys->i_pos - offset;
+    block_t *block = NULL;
+
+    void *addr = mmap (NULL, skip + length, PROT_READ, MAP_PRIVATE,
+                       p_sys->fd, offset);
+    if (addr != MAP_FAILED)
+    {
+        posix_madvise (addr, skip + length, POSIX_MADV_SEQUENTIAL);
+        posix_madvise (addr, skip + length, POSIX_MADV_WILLNEED);
+
+        block = block_mmap_Alloc (addr, skip + length);
+        if (block != NULL)
+        {
+            block->p_buffer += skip;
+            block->i_buffer -= skip;
+        }
+    }
+    else
+    {   /* Fall back to reading, e.g. if the address space is exhausted */
+        msg_Warn (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+
+        block = block_Alloc (length);
+        if (block != NULL)
+        {
+            ssize_t val = pread (p_sys->fd, block->p_buffer, length,
+                                 p_sys->i_pos);
+            if (val <= 0)
+            {
+                if (val < 0)
+                    msg_Err (p_access, "read error: %s",
+                             vlc_strerror_c(errno));
+                block_Release (block);
+                *eof = true;
+                return NULL;
+            }
+            block->i_buffer = val;
+        }
+    }
+
+    if (block != NULL)
+        p_sys->i_pos += block->i_buffer;
+    return block;
+}
+
+/* The next block is mapped from the new position */
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    sys->i_pos = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -40,6 +40,10 @@ vlc_module_begin ()
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
 
+    add_bool("file-mmap", false, N_("Map files in memory"),
+             N_("Read local files by mapping them in memory, rather than "
+                "copying their content into buffers."), true)
+
     add_submodule()
     set_section( N_("Directory" ), NULL )
     set_capability( "access", 55 )
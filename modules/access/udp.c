@@ -59,6 +59,9 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Receive batch size")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received per " \
+    "system call. Set to 1 to receive datagrams one at a time.")
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -69,6 +72,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_integer( "udp-batch", 32, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -76,17 +83,36 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef SO_RXQ_OVFL
+# define UDP_CMSG_SIZE CMSG_SPACE(sizeof (uint32_t))
+#endif
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+    uint32_t dropped; /* last kernel receive queue overflow count */
+    uint64_t lost;
+#ifdef HAVE_RECVMMSG
+    /* Batched receive ring */
+    unsigned batch;
+    block_t **ring;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+# ifdef UDP_CMSG_SIZE
+    char (*cmsgs)[UDP_CMSG_SIZE];
+# endif
+#endif
 };
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( stream_t *, bool * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( stream_t *, bool * );
+#endif
 static int Control( stream_t *, int, va_list );
 
 /*****************************************************************************
@@ -169,11 +195,43 @@ static int Open( vlc_object_t *p_this )
     }
 
     sys->mtu = 7 * 188;
+    sys->dropped = 0;
+    sys->lost = 0;
 
     sys->timeout = var_InheritInteger( p_access, "udp-timeout");
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef SO_RXQ_OVFL
+    /* Ask the kernel to report receive queue overflows */
+    setsockopt( sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int) );
+#endif
+
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    if( sys->batch > 1 )
+    {
+        sys->ring = vlc_obj_calloc( p_this, sys->batch, sizeof( *sys->ring ) );
+        sys->msgs = vlc_obj_calloc( p_this, sys->batch, sizeof( *sys->msgs ) );
+        sys->iovecs = vlc_obj_calloc( p_this, sys->batch,
+                                      sizeof( *sys->iovecs ) );
+# ifdef UDP_CMSG_SIZE
+        sys->cmsgs = vlc_obj_calloc( p_this, sys->batch,
+                                     sizeof( *sys->cmsgs ) );
+        if( unlikely(sys->cmsgs == NULL) )
+            sys->ring = NULL;
+# endif
+        if( unlikely(sys->ring == NULL || sys->msgs == NULL
+                  || sys->iovecs == NULL) )
+        {
+            net_Close( sys->fd );
+            return VLC_ENOMEM;
+        }
+
+        p_access->pf_block = BlockUDPBatch;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -185,6 +243,12 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    if( sys->batch > 1 )
+        for( unsigned i = 0; i < sys->batch; i++ )
+            if( sys->ring[i] != NULL )
+                block_Release( sys->ring[i] );
+#endif
     net_Close( sys->fd );
 }
 
@@ -212,12 +276,55 @@ static int Control( stream_t *p_access, int i_query, va_list args )
                    * var_InheritInteger(p_access, "network-caching");
             break;
 
+        case STREAM_GET_LOST:
+        {
+            access_sys_t *sys = p_access->p_sys;
+
+            *va_arg( args, uint64_t * ) = sys->lost;
+            break;
+        }
+
         default:
             return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * CheckDrops: account for datagrams dropped by the kernel
+ *****************************************************************************/
+static void CheckDrops(stream_t *access, struct msghdr *msg, block_t *pkt)
+{
+#ifdef SO_RXQ_OVFL
+    access_sys_t *sys = access->p_sys;
+
+    if (msg->msg_controllen == 0)
+        return;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+
+        uint32_t dropped;
+
+        memcpy(&dropped, CMSG_DATA(cmsg), sizeof (dropped));
+        if (dropped == sys->dropped)
+            continue;
+
+        msg_Warn(access, "%"PRIu32" packet(s) dropped (receive buffer full)",
+                 dropped - sys->dropped);
+        sys->lost += (uint32_t)(dropped - sys->dropped);
+        sys->dropped = dropped;
+        pkt->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    }
+#else
+    VLC_UNUSED(access); VLC_UNUSED(msg); VLC_UNUSED(pkt);
+#endif
+}
+
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
@@ -237,9 +344,16 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
         .iov_base = pkt->p_buffer,
         .iov_len = sys->mtu,
     };
+#ifdef UDP_CMSG_SIZE
+    char control[UDP_CMSG_SIZE];
+#endif
     struct msghdr msg = {
         .msg_iov = &iov,
         .msg_iovlen = 1,
+#ifdef UDP_CMSG_SIZE
+        .msg_control = control,
+        .msg_controllen = sizeof (control),
+#endif
 #ifdef __linux__
         .msg_flags = MSG_TRUNC,
 #endif
@@ -280,5 +394,109 @@ skip:
 #endif
         pkt->i_buffer = len;
 
+    CheckDrops(access, &msg, pkt);
     return pkt;
 }
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockUDPBatch: receive all pending datagrams (up to udp-batch) at once
+ *****************************************************************************/
+static block_t *BlockUDPBatch(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+    unsigned count;
+
+    /* Refill the slots consumed by the previous call */
+    for (count = 0; count < sys->batch; count++)
+    {
+        if (sys->ring[count] == NULL)
+        {
+            sys->ring[count] = block_Alloc(sys->mtu);
+            if (unlikely(sys->ring[count] == NULL))
+                break;
+        }
+
+        struct msghdr *hdr = &sys->msgs[count].msg_hdr;
+
+        sys->iovecs[count].iov_base = sys->ring[count]->p_buffer;
+        sys->iovecs[count].iov_len = sys->ring[count]->i_buffer;
+        hdr->msg_iov = &sys->iovecs[count];
+        hdr->msg_iovlen = 1;
+# ifdef UDP_CMSG_SIZE
+        hdr->msg_control = sys->cmsgs[count];
+        hdr->msg_controllen = sizeof (sys->cmsgs[count]);
+# endif
+        hdr->msg_flags = 0;
+    }
+
+    if (unlikely(count == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return NULL;
+    }
+
+    int flags = MSG_DONTWAIT;
+#ifdef __linux__
+    flags |= MSG_TRUNC; /* report the real length of truncated datagrams */
+#endif
+    int val = recvmmsg(sys->fd, sys->msgs, count, flags, NULL);
+    if (val <= 0)
+        return NULL;
+
+    block_t *chain = NULL, **pp = &chain;
+    size_t mtu = sys->mtu;
+
+    for (int i = 0; i < val; i++)
+    {
+        block_t *pkt = sys->ring[i];
+        size_t len = sys->msgs[i].msg_len;
+
+        sys->ring[i] = NULL;
+
+        if (sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, pkt->i_buffer);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            if (len > mtu)
+                mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+
+        CheckDrops(access, &sys->msgs[i].msg_hdr, pkt);
+        *pp = pkt;
+        pp = &pkt->p_next;
+    }
+
+    if (mtu != sys->mtu)
+    {   /* Reallocate the remaining ring slots with the new MTU */
+        for (unsigned i = val; i < sys->batch; i++)
+            if (sys->ring[i] != NULL)
+            {
+                block_Release(sys->ring[i]);
+                sys->ring[i] = NULL;
+            }
+        sys->mtu = mtu;
+    }
+
+    return chain;
+}
+#endif
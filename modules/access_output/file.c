@@ -35,8 +35,12 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
+#endif
 #ifdef __OS2__
 #   include <io.h>      /* setmode() */
 #endif
@@ -73,114 +77,105 @@ static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
     return val;
 }
 
+#define FILE_IOV_MAX (IOV_MAX < 64 ? IOV_MAX : 64)
+
 /*****************************************************************************
- * Write: standard write on a file descriptor.
+ * WriteChain: vectored write of a whole block chain
  *****************************************************************************/
-static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+static ssize_t WriteChain(sout_access_out_t *access, block_t *block,
+                          ssize_t (*writev_cb)(int, const struct iovec *, int))
 {
-    size_t i_write = 0;
+    int fd = (intptr_t)access->p_sys;
+    size_t total = 0;
 
-    while( p_buffer )
+    while (block != NULL)
     {
-        ssize_t val = write ((intptr_t)p_access->p_sys,
-                             p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
+        struct iovec iov[FILE_IOV_MAX];
+        int count = 0;
+
+        for (const block_t *b = block; b != NULL && count < FILE_IOV_MAX;
+             b = b->p_next)
         {
-            if (errno == EINTR)
+            if (b->i_buffer == 0)
                 continue;
-            block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
-            return -1;
+            iov[count].iov_base = b->p_buffer;
+            iov[count].iov_len = b->i_buffer;
+            count++;
         }
 
-        if ((size_t)val >= p_buffer->i_buffer)
-        {
-            block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
-            p_buffer = p_next;
+        if (count == 0)
+        {   /* only empty blocks left */
+            block_ChainRelease(block);
+            break;
         }
-        else
-        {
-            p_buffer->p_buffer += val;
-            p_buffer->i_buffer -= val;
+
+        ssize_t val = writev_cb(fd, iov, count);
+        if (val <= 0)
+        {   /* FIXME: errno is meaningless if val is zero */
+            if (errno == EINTR)
+                continue;
+            block_ChainRelease(block);
+            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
+            return -1;
         }
-        i_write += val;
-    }
-    return i_write;
-}
 
-static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
-{
-    int fd = (intptr_t)access->p_sys;
-    ssize_t total = 0;
+        total += val;
 
-    while (block != NULL)
-    {
-        if (block->i_buffer == 0)
+        /* Release what was written, keep the rest for the next round */
+        while (block != NULL && (size_t)val >= block->i_buffer)
         {
             block_t *next = block->p_next;
+
+            val -= block->i_buffer;
             block_Release(block);
             block = next;
-            continue;
         }
 
-        /* TODO: vectorized I/O with writev() */
-        ssize_t val = vlc_write(fd, block->p_buffer, block->i_buffer);
-        if (val < 0)
+        if (block != NULL)
         {
-            if (errno == EINTR)
-                continue;
-
-            block_ChainRelease(block);
-            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            total = -1;
-            break;
+            block->p_buffer += val;
+            block->i_buffer -= val;
         }
-
-        total += val;
-
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
     }
-
     return total;
 }
 
-#ifdef S_ISSOCK
-static ssize_t Send(sout_access_out_t *access, block_t *block)
+static ssize_t WriteV(int fd, const struct iovec *iov, int count)
 {
-    int fd = (intptr_t)access->p_sys;
-    size_t total = 0;
+#ifdef _WIN32
+    return vlc_writev(fd, iov, count);
+#else
+    return writev(fd, iov, count);
+#endif
+}
 
-    while (block != NULL)
-    {
-        if (block->i_buffer == 0)
-        {
-            block_t *next = block->p_next;
-            block_Release(block);
-            block = next;
-            continue;
-        }
+/*****************************************************************************
+ * Write: standard write on a file descriptor.
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    return WriteChain( p_access, p_buffer, WriteV );
+}
 
-        /* TODO: vectorized I/O with sendmsg() */
-        ssize_t val = send(fd, block->p_buffer, block->i_buffer, MSG_NOSIGNAL);
-        if (val <= 0)
-        {   /* FIXME: errno is meaningless if val is zero */
-            if (errno == EINTR)
-                continue;
-            block_ChainRelease(block);
-            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            return -1;
-        }
+static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
+{
+    return WriteChain(access, block, vlc_writev);
+}
 
-        total += val;
+#ifdef S_ISSOCK
+static ssize_t SendV(int fd, const struct iovec *iov, int count)
+{
+    struct msghdr msg = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = count,
+    };
 
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
-    }
-    return total;
+    return sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+static ssize_t Send(sout_access_out_t *access, block_t *block)
+{
+    return WriteChain(access, block, SendV);
 }
 #endif
 
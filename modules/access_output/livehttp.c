@@ -105,6 +105,23 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define CMAF_TEXT N_("Fragmented MP4 segments")
+#define CMAF_LONGTEXT N_("Expect fragmented MP4 (CMAF) from the mp4frag muxer. "\
+                         "The initialization section is written to its own "\
+                         "file and segments are split on key frame fragments.")
+
+#define INIT_TEXT N_("Initialization section file")
+#define INIT_LONGTEXT N_("Path to the fragmented MP4 initialization section. "\
+                         "Defaults to the segment path with the segment "\
+                         "number replaced by \"init\".")
+
+#define PARTLEN_TEXT N_("Partial segment duration (ms)")
+#define PARTLEN_LONGTEXT N_("Publish each fragment as a low-latency partial "\
+                            "segment, with this target duration, along with "\
+                            "a preload hint for the next one. The muxer "\
+                            "fragment duration must not exceed it. "\
+                            "0 disables partial segments.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +152,13 @@ vlc_module_begin ()
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "cmaf", false,
+              CMAF_TEXT, CMAF_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "init", NULL,
+                INIT_TEXT, INIT_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "part-duration", 0,
+                 PARTLEN_TEXT, PARTLEN_LONGTEXT, true )
+        change_integer_range( 0, 10000 )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,21 +180,35 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "cmaf",
+    "init",
+    "part-duration",
     NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
+typedef struct output_part
+{
+    uint64_t i_offset;
+    size_t i_size;
+    mtime_t i_duration;
+    bool b_independent;
+} output_part_t;
+
 typedef struct output_segment
 {
     char *psz_filename;
     char *psz_uri;
     char *psz_key_uri;
     char *psz_duration;
+    char *psz_entry; /* index lines, rendered once the segment is closed */
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    output_part_t *p_parts;
+    unsigned i_parts;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -205,6 +243,16 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t segments_t;
+
+    /* Fragmented MP4: the pending fragment is in ongoing_segment */
+    bool b_cmaf;
+    char *psz_initPath;
+    char *psz_initUri;
+    mtime_t i_partlenm;
+    mtime_t i_partdts;
+    mtime_t i_partend;
+    bool b_part_independent;
+    uint64_t i_segment_size;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -212,6 +260,10 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static ssize_t WriteFragmented( sout_access_out_t *p_access, block_t *p_buffer );
+static ssize_t closePart( sout_access_out_t *p_access, mtime_t i_end );
+static char *formatInitPath( const char *psz_path );
+static char *formatInitUri( const char *psz_indexUrl, const char *psz_initPath );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -278,6 +330,37 @@ static int Open( vlc_object_t *p_this )
     p_sys->psz_keyfile  = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "key-loadfile" );
     p_sys->key_uri      = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "key-uri" );
 
+    p_sys->b_cmaf = var_GetBool( p_access, SOUT_CFG_PREFIX "cmaf" );
+    p_sys->i_partlenm = CLOCK_FREQ / 1000 *
+        var_GetInteger( p_access, SOUT_CFG_PREFIX "part-duration" );
+    if( p_sys->b_cmaf )
+    {
+        if( p_sys->key_uri || p_sys->psz_keyfile )
+        {
+            msg_Err( p_access, "Encryption is not supported with fragmented MP4" );
+            goto error;
+        }
+
+        p_sys->psz_initPath = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "init" );
+        if( p_sys->psz_initPath )
+            p_sys->psz_initUri = p_sys->psz_indexUrl ?
+                formatInitUri( p_sys->psz_indexUrl, p_sys->psz_initPath ) :
+                strdup( p_sys->psz_initPath );
+        else
+        {
+            p_sys->psz_initPath = formatInitPath( p_access->psz_path );
+            p_sys->psz_initUri = formatInitPath( p_sys->psz_indexUrl ?
+                                 p_sys->psz_indexUrl : p_access->psz_path );
+        }
+        if( unlikely( !p_sys->psz_initPath || !p_sys->psz_initUri ) )
+            goto error;
+    }
+    else if( p_sys->i_partlenm )
+    {
+        msg_Warn( p_access, "Partial segments need fragmented MP4 segments" );
+        p_sys->i_partlenm = 0;
+    }
+
     p_access->p_sys = p_sys;
 
     if( p_sys->psz_keyfile && ( LoadCryptFile( p_access ) < 0 ) )
@@ -301,10 +384,20 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
 
-    p_access->pf_write = Write;
+    p_access->pf_write = p_sys->b_cmaf ? WriteFragmented : Write;
     p_access->pf_control = Control;
 
     return VLC_SUCCESS;
+
+error:
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_initUri );
+    free( p_sys->key_uri );
+    free( p_sys->psz_keyfile );
+    free( p_sys->psz_indexUrl );
+    free( p_sys->psz_indexPath );
+    free( p_sys );
+    return VLC_EGENERIC;
 }
 
 /************************************************************************
@@ -504,10 +597,62 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg )
     return psz_result;
 }
 
+/*****************************************************************************
+ * formatInitPath: initialization section path, from the segments one
+ *****************************************************************************/
+static char *formatInitPath( const char *psz_path )
+{
+    char *psz_result;
+    char *psz_init;
+
+    if ( ! ( psz_result = vlc_strftime( psz_path ) ) )
+        return NULL;
+
+    size_t i_prefix = strcspn( psz_result, SEG_NUMBER_PLACEHOLDER );
+    size_t i_cnt = strspn( psz_result + i_prefix, SEG_NUMBER_PLACEHOLDER );
+    int ret;
+
+    if ( i_cnt )
+        ret = asprintf( &psz_init, "%.*sinit%s", (int)i_prefix, psz_result,
+                        psz_result + i_prefix + i_cnt );
+    else
+        ret = asprintf( &psz_init, "%s.init", psz_result );
+    free( psz_result );
+
+    return ret < 0 ? NULL : psz_init;
+}
+
+/*****************************************************************************
+ * formatInitUri: initialization section URI, from the given init file name
+ * in place of the file part of the index URL
+ *****************************************************************************/
+static char *formatInitUri( const char *psz_indexUrl, const char *psz_initPath )
+{
+    char *psz_result;
+    char *psz_uri;
+
+    if ( ! ( psz_result = vlc_strftime( psz_indexUrl ) ) )
+        return NULL;
+
+    const char *psz_name = strrchr( psz_initPath, '/' );
+    psz_name = psz_name ? psz_name + 1 : psz_initPath;
+
+    const char *psz_file = strrchr( psz_result, '/' );
+    size_t i_prefix = psz_file ? (size_t)( psz_file + 1 - psz_result ) : 0;
+
+    if ( asprintf( &psz_uri, "%.*s%s", (int)i_prefix, psz_result, psz_name ) < 0 )
+        psz_uri = NULL;
+    free( psz_result );
+
+    return psz_uri;
+}
+
 static void destroySegment( output_segment_t *segment )
 {
     free( segment->psz_filename );
     free( segment->psz_duration );
+    free( segment->psz_entry );
+    free( segment->p_parts );
     free( segment->psz_uri );
     free( segment->psz_key_uri );
     free( segment );
@@ -555,6 +700,45 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
     return duration >= (first->f_seglength + (float)(p_sys->i_numsegs * p_sys->i_seglen));
 }
 
+/* Formats a duration as seconds, without depending on the locale */
+#define DURATION_FMT "%"PRId64".%03"PRId64
+#define DURATION_ARGS(d) (d) / CLOCK_FREQ, (d) % CLOCK_FREQ / 1000
+
+/************************************************************************
+ * writeIndexMap: fragmented MP4 initialization and low-latency tags
+ ************************************************************************/
+static int writeIndexMap( sout_access_out_sys_t *p_sys, FILE *fp )
+{
+    if ( fprintf( fp, "#EXT-X-MAP:URI=\"%s\"\n", p_sys->psz_initUri ) < 0 )
+        return -1;
+    if ( p_sys->i_partlenm &&
+         fprintf( fp, "#EXT-X-PART-INF:PART-TARGET="DURATION_FMT"\n"
+                      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK="DURATION_FMT"\n",
+                  DURATION_ARGS( p_sys->i_partlenm ),
+                  DURATION_ARGS( 3 * p_sys->i_partlenm ) ) < 0 )
+        return -1;
+    return 0;
+}
+
+/************************************************************************
+ * writeIndexParts: list the partial segments, as byte ranges of the segment
+ ************************************************************************/
+static int writeIndexParts( FILE *fp, const output_segment_t *segment )
+{
+    for ( unsigned i = 0; i < segment->i_parts; i++ )
+    {
+        const output_part_t *part = &segment->p_parts[i];
+
+        if ( fprintf( fp, "#EXT-X-PART:DURATION="DURATION_FMT",URI=\"%s\","
+                          "BYTERANGE=\"%zu@%"PRIu64"\"%s\n",
+                      DURATION_ARGS( part->i_duration ), segment->psz_uri,
+                      part->i_size, part->i_offset,
+                      part->b_independent ? ",INDEPENDENT=YES" : "" ) < 0 )
+            return -1;
+    }
+    return 0;
+}
+
 /************************************************************************
  * updateIndexAndDel: If necessary, update index file & delete old segments
  ************************************************************************/
@@ -593,8 +777,9 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             return -1;
         }
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:%d\n#EXT-X-ALLOW-CACHE:%s"
                           "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                          p_sys->b_cmaf ? 6 : 3,
                           p_sys->b_caching ? "YES" : "NO",
                           p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
                           i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
@@ -604,6 +789,13 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             fclose( fp );
             return -1;
         }
+
+        if ( p_sys->b_cmaf && writeIndexMap( p_sys, fp ) < 0 )
+        {
+            free( psz_idxTmp );
+            fclose( fp );
+            return -1;
+        }
         char *psz_current_uri=NULL;
 
 
@@ -646,7 +838,24 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
                 }
             }
 
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
+            /* Keep the parts within 3 target durations of the live edge */
+            if ( p_sys->i_partlenm && p_sys->i_segment - i <= 3 )
+                val = writeIndexParts( fp, segment );
+            else
+                val = 0;
+
+            if ( val >= 0 && p_sys->i_handle >= 0 && i == p_sys->i_segment )
+            {
+                /* The segment being written is only announced by its parts */
+                if ( p_sys->i_partlenm )
+                    val = fprintf( fp, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\","
+                                   "BYTERANGE-START=%"PRIu64"\n", segment->psz_uri,
+                                   p_sys->i_segment_size );
+            }
+            else if ( val >= 0 && segment->psz_entry )
+                val = fputs( segment->psz_entry, fp );
+            else if ( val >= 0 )
+                val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
             if ( val < 0 )
             {
                 free( psz_current_uri );
@@ -741,6 +950,9 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
             return;
         }
         segment->f_seglength = p_sys->f_seglen;
+        if ( asprintf( &segment->psz_entry, "#EXTINF:%s,\n%s\n",
+                       segment->psz_duration, segment->psz_uri ) < 0 )
+            segment->psz_entry = NULL;
 
         segment->i_segment_number = p_sys->i_segment;
 
@@ -762,6 +974,14 @@ static void Close( vlc_object_t * p_this )
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
 
+    if( p_sys->b_cmaf )
+    {
+        if( p_sys->ongoing_segment && p_sys->i_handle >= 0 )
+            closePart( p_access, p_sys->i_partend );
+        closeCurrentSegment( p_access, p_sys, true );
+        goto end;
+    }
+
     if( p_sys->ongoing_segment )
         block_ChainLastAppend( &p_sys->full_segments_end, p_sys->ongoing_segment );
     p_sys->ongoing_segment = NULL;
@@ -798,6 +1018,7 @@ static void Close( vlc_object_t * p_this )
 
     closeCurrentSegment( p_access, p_sys, true );
 
+end:
     if( p_sys->key_uri )
     {
         gcry_cipher_close( p_sys->aes_ctx );
@@ -817,6 +1038,8 @@ static void Close( vlc_object_t * p_this )
         destroySegment( segment );
     }
 
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_initUri );
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -900,6 +1123,8 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     p_sys->i_handle = fd;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
+    p_sys->i_segment_size = 0;
+    p_sys->f_seglen = 0.f;
     return fd;
 }
 /*****************************************************************************
@@ -1056,3 +1281,207 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 
     return i_write;
 }
+
+/*****************************************************************************
+ * writeBlocks: write and release a block chain
+ *****************************************************************************/
+static ssize_t writeBlocks( int fd, block_t *p_block )
+{
+    ssize_t i_write = 0;
+
+    while( p_block )
+    {
+        ssize_t val = vlc_write( fd, p_block->p_buffer, p_block->i_buffer );
+        if ( val == -1 )
+        {
+           if ( errno == EINTR )
+              continue;
+           block_ChainRelease( p_block );
+           return -1;
+        }
+
+        if ( (size_t)val >= p_block->i_buffer )
+        {
+           block_t *p_next = p_block->p_next;
+           block_Release (p_block);
+           p_block = p_next;
+        }
+        else
+        {
+           p_block->p_buffer += val;
+           p_block->i_buffer -= val;
+        }
+        i_write += val;
+    }
+    return i_write;
+}
+
+/*****************************************************************************
+ * writeInitSection: replace the fragmented MP4 initialization section file
+ *****************************************************************************/
+static int writeInitSection( sout_access_out_t *p_access, block_t *p_block )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    char *psz_tmp;
+
+    if ( asprintf( &psz_tmp, "%s.tmp", p_sys->psz_initPath ) < 0 )
+    {
+        block_ChainRelease( p_block );
+        return -1;
+    }
+
+    int fd = vlc_open( psz_tmp, O_WRONLY | O_CREAT | O_LARGEFILE | O_TRUNC, 0666 );
+    if ( fd == -1 )
+    {
+        msg_Err( p_access, "cannot open `%s' (%s)", psz_tmp,
+                 vlc_strerror_c(errno) );
+        block_ChainRelease( p_block );
+        free( psz_tmp );
+        return -1;
+    }
+
+    ssize_t val = writeBlocks( fd, p_block );
+    vlc_close( fd );
+
+    if ( val < 0 || vlc_rename( psz_tmp, p_sys->psz_initPath ) < 0 )
+    {
+        vlc_unlink( psz_tmp );
+        msg_Err( p_access, "Error writing initialization section %s",
+                 p_sys->psz_initPath );
+        free( psz_tmp );
+        return -1;
+    }
+    msg_Dbg( p_access, "Wrote initialization section %s", p_sys->psz_initPath );
+    free( psz_tmp );
+    return 0;
+}
+
+/*****************************************************************************
+ * closePart: append the pending fragment to the segment, as a partial segment
+ *****************************************************************************/
+static ssize_t closePart( sout_access_out_t *p_access, mtime_t i_end )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    output_segment_t *segment = vlc_array_item_at_index( &p_sys->segments_t, vlc_array_count( &p_sys->segments_t ) - 1 );
+
+    block_t *p_part = p_sys->ongoing_segment;
+    p_sys->ongoing_segment = NULL;
+    p_sys->ongoing_segment_end = &p_sys->ongoing_segment;
+
+    ssize_t i_write = writeBlocks( p_sys->i_handle, p_part );
+    if ( i_write < 0 )
+    {
+        msg_Err( p_access, "cannot write to `%s' (%s)", segment->psz_filename,
+                 vlc_strerror_c(errno) );
+        return -1;
+    }
+
+    p_sys->f_seglen = (float)( i_end - p_sys->i_opendts ) / CLOCK_FREQ;
+    p_sys->b_segment_has_data = true;
+
+    if ( p_sys->i_partlenm )
+    {
+        output_part_t *p_parts = realloc( segment->p_parts,
+                                 ( segment->i_parts + 1 ) * sizeof( *p_parts ) );
+        if ( unlikely( !p_parts ) )
+            return -1;
+        segment->p_parts = p_parts;
+        p_parts[segment->i_parts++] = (output_part_t) {
+            .i_offset = p_sys->i_segment_size,
+            .i_size = i_write,
+            .i_duration = i_end - p_sys->i_partdts,
+            .b_independent = p_sys->b_part_independent,
+        };
+        if ( i_end - p_sys->i_partdts > p_sys->i_partlenm )
+            msg_Warn( p_access, "Partial segment longer than its target" );
+    }
+    p_sys->i_segment_size += i_write;
+
+    if ( p_sys->i_partlenm )
+        updateIndexAndDel( p_access, p_sys, false );
+    return i_write;
+}
+
+/* Fragments start with a moof box, flagged as I if it starts with a key
+ * frame, see the mp4frag muxer */
+static bool isFragmentStart( const block_t *p_block )
+{
+    return p_block->i_buffer >= 8 && !memcmp( &p_block->p_buffer[4], "moof", 4 );
+}
+
+/*****************************************************************************
+ * WriteFragmented: write fragmented MP4 as soon as each fragment is complete
+ *****************************************************************************/
+static ssize_t WriteFragmented( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_write = 0;
+
+    while( p_buffer )
+    {
+        block_t *p_next = p_buffer->p_next;
+        p_buffer->p_next = NULL;
+
+        if( p_buffer->i_flags & BLOCK_FLAG_HEADER )
+        {
+            if( writeInitSection( p_access, p_buffer ) < 0 )
+            {
+                block_ChainRelease( p_next );
+                return -1;
+            }
+            p_buffer = p_next;
+            continue;
+        }
+
+        if( isFragmentStart( p_buffer ) )
+        {
+            bool b_independent = p_buffer->i_flags & BLOCK_FLAG_TYPE_I;
+
+            if( p_sys->ongoing_segment )
+            {
+                ssize_t ret = closePart( p_access, p_buffer->i_dts );
+                if( ret < 0 )
+                {
+                    block_ChainRelease( p_buffer );
+                    block_ChainRelease( p_next );
+                    return -1;
+                }
+                i_write += ret;
+            }
+
+            /* Segments start with a key frame fragment */
+            if( p_sys->i_handle >= 0 && b_independent &&
+                p_buffer->i_dts - p_sys->i_opendts >= p_sys->i_seglenm )
+                closeCurrentSegment( p_access, p_sys, false );
+
+            if( p_sys->i_handle < 0 )
+            {
+                p_sys->i_opendts = p_buffer->i_dts;
+                msg_Dbg( p_access, "Setting new opendts %"PRId64, p_sys->i_opendts );
+                if( openNextFile( p_access, p_sys ) < 0 )
+                {
+                    block_ChainRelease( p_buffer );
+                    block_ChainRelease( p_next );
+                    return -1;
+                }
+            }
+            p_sys->i_partdts = p_sys->i_partend = p_buffer->i_dts;
+            p_sys->b_part_independent = b_independent;
+        }
+        else if( p_sys->i_handle < 0 )
+        {
+            /* No fragment to attach it to */
+            block_Release( p_buffer );
+            p_buffer = p_next;
+            continue;
+        }
+
+        if( p_buffer->i_dts > VLC_TS_INVALID )
+            p_sys->i_partend = __MAX( p_sys->i_partend,
+                                      p_buffer->i_dts + p_buffer->i_length );
+        block_ChainLastAppend( &p_sys->ongoing_segment_end, p_buffer );
+        p_buffer = p_next;
+    }
+
+    return i_write;
+}
@@ -46,10 +46,18 @@
 #else
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
+#endif
+#ifdef __linux__
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+/* Maximum number of packets sent with a single system call */
+#define MAX_BATCH_PACKETS 64
 
 /*****************************************************************************
  * Module descriptor
@@ -70,6 +78,9 @@ static void Close( vlc_object_t * );
                           "of packets that will be sent at a time. It " \
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split groups of packets into " \
+                        "datagrams (UDP generic segmentation offload).")
 
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
@@ -79,6 +90,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef UDP_SEGMENT
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +106,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef UDP_SEGMENT
+    "gso",
+#endif
     NULL
 };
 
@@ -114,6 +131,7 @@ struct sout_access_out_sys_t
     mtime_t       i_caching;
     int           i_handle;
     bool          b_mtu_warning;
+    bool          b_gso;
     size_t        i_mtu;
 
     block_fifo_t *p_fifo;
@@ -209,6 +227,11 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+#else
+    p_sys->b_gso = false;
+#endif
     p_sys->p_fifo = block_FifoNew();
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
@@ -380,6 +403,134 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * SendPackets: send a group of packets, with as few system calls as possible
+ *****************************************************************************/
+static void SendPacket( sout_access_out_t *p_access, const block_t *p_pk )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+        msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+}
+
+#ifdef HAVE_SENDMMSG
+/* Builds one message per packet, or with segmentation offload, one message
+ * per run of equally-sized packets (only the last one may be shorter). */
+static unsigned PrepareMessages( sout_access_out_sys_t *p_sys,
+                                 block_t *const *pp_pk, unsigned i_count,
+                                 struct mmsghdr *msgs, struct iovec *iov,
+                                 unsigned *pi_pk_count, char *control )
+{
+    unsigned i_msg = 0;
+
+    for( unsigned i = 0; i < i_count; i_msg++ )
+    {
+        const size_t i_seg = pp_pk[i]->i_buffer;
+        size_t i_total = i_seg;
+        unsigned n = 1;
+
+        iov[i].iov_base = pp_pk[i]->p_buffer;
+        iov[i].iov_len = i_seg;
+
+        while( p_sys->b_gso && i + n < i_count
+            && pp_pk[i + n - 1]->i_buffer == i_seg
+            && pp_pk[i + n]->i_buffer <= i_seg
+            && i_total + pp_pk[i + n]->i_buffer <= 65507 )
+        {
+            iov[i + n].iov_base = pp_pk[i + n]->p_buffer;
+            iov[i + n].iov_len = pp_pk[i + n]->i_buffer;
+            i_total += pp_pk[i + n]->i_buffer;
+            n++;
+        }
+
+        memset( &msgs[i_msg], 0, sizeof( msgs[i_msg] ) );
+        msgs[i_msg].msg_hdr.msg_iov = &iov[i];
+        msgs[i_msg].msg_hdr.msg_iovlen = n;
+#ifdef UDP_SEGMENT
+        if( n > 1 )
+        {
+            char *buf = control + i_msg * CMSG_SPACE(sizeof (uint16_t));
+            struct cmsghdr *cmsg;
+            uint16_t i_gso = i_seg;
+
+            msgs[i_msg].msg_hdr.msg_control = buf;
+            msgs[i_msg].msg_hdr.msg_controllen =
+                CMSG_SPACE(sizeof (uint16_t));
+            cmsg = CMSG_FIRSTHDR( &msgs[i_msg].msg_hdr );
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+            memcpy( CMSG_DATA(cmsg), &i_gso, sizeof (i_gso) );
+        }
+#else
+        VLC_UNUSED(control);
+#endif
+        pi_pk_count[i_msg] = n;
+        i += n;
+    }
+    return i_msg;
+}
+#endif
+
+static void SendPackets( sout_access_out_t *p_access,
+                         block_t *const *pp_pk, unsigned i_count )
+{
+#ifdef HAVE_SENDMMSG
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    while( i_count > 1 )
+    {
+        struct mmsghdr msgs[MAX_BATCH_PACKETS];
+        struct iovec iov[MAX_BATCH_PACKETS];
+        unsigned pk_count[MAX_BATCH_PACKETS];
+        char control[MAX_BATCH_PACKETS * CMSG_SPACE(sizeof (uint16_t))];
+        unsigned i_msg = PrepareMessages( p_sys, pp_pk, i_count, msgs, iov,
+                                          pk_count, control );
+
+        int val = sendmmsg( p_sys->i_handle, msgs, i_msg, 0 );
+        if( val < 0 )
+        {
+            if( p_sys->b_gso && i_msg < i_count
+             && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT) )
+            {
+                msg_Warn( p_access, "segmentation offload not available: %s",
+                          vlc_strerror_c(errno) );
+                p_sys->b_gso = false;
+                continue;
+            }
+            if( errno != ENOSYS )
+                msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            break; /* fall back to one packet at a time */
+        }
+
+        for( int i = 0; i < val; i++ )
+        {
+            pp_pk += pk_count[i];
+            i_count -= pk_count[i];
+        }
+    }
+#endif
+    /* One packet at a time */
+    for( unsigned i = 0; i < i_count; i++ )
+        SendPacket( p_access, pp_pk[i] );
+}
+
+struct udp_batch
+{
+    block_t *pp_pk[MAX_BATCH_PACKETS];
+    unsigned i_count;
+    mtime_t  i_date_last;
+};
+
+static void BatchRelease( void *data )
+{
+    struct udp_batch *batch = data;
+
+    for( unsigned i = 0; i < batch->i_count; i++ )
+        block_Release( batch->pp_pk[i] );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -387,50 +538,53 @@ static void* ThreadWrite( void *data )
 {
     sout_access_out_t *p_access = data;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    mtime_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    struct udp_batch batch = { .i_count = 0, .i_date_last = -1 };
 
+    /* Packets of a group are queued and sent together once the last one of
+     * the group is due. */
+    vlc_cleanup_push( BatchRelease, &batch );
     for (;;)
     {
         block_t *p_pk = block_FifoGet( p_sys->p_fifo );
         mtime_t       i_date, i_sent;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        if( batch.i_date_last > 0 )
         {
-            if( i_date - i_date_last > 2000000 )
+            if( i_date - batch.i_date_last > 2000000 )
             {
                 if( !i_dropped_packets )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+                             i_date - batch.i_date_last );
 
                 block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-                i_date_last = i_date;
+                batch.i_date_last = i_date;
                 i_dropped_packets++;
                 continue;
             }
-            else if( i_date - i_date_last < -1000 )
+            else if( i_date - batch.i_date_last < -1000 )
             {
                 if( !i_dropped_packets )
                     msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                             batch.i_date_last - i_date );
             }
         }
 
-        block_cleanup_push( p_pk );
+        batch.pp_pk[batch.i_count++] = p_pk;
+        batch.i_date_last = i_date;
         i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            mwait( i_date );
-            i_to_send = i_group;
-        }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+        if( i_to_send && !(p_pk->i_flags & BLOCK_FLAG_CLOCK)
+         && batch.i_count < MAX_BATCH_PACKETS )
+            continue;
+
+        mwait( i_date );
+        i_to_send = i_group;
+        SendPackets( p_access, batch.pp_pk, batch.i_count );
 
         if( i_dropped_packets )
         {
@@ -447,9 +601,10 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
-        i_date_last = i_date;
+        for( unsigned i = 0; i < batch.i_count; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, batch.pp_pk[i] );
+        batch.i_count = 0;
     }
+    vlc_cleanup_pop();
     return NULL;
 }
@@ -828,6 +828,18 @@ int OpenEncoder( vlc_object_t *p_this )
 #endif
     }
 
+    /* Fixed GOP requested by the caller: no scene-cut key frames */
+    if( p_enc->fmt_in.i_cat == VIDEO_ES && p_enc->i_iframes > 0 )
+    {
+        p_context->gop_size = p_enc->i_iframes;
+        p_context->keyint_min = p_enc->i_iframes;
+        /* libx264 takes the x264 threshold, where 0 disables scene-cuts */
+        add_av_option_int( p_enc, &options, "sc_threshold",
+                           strcmp( p_codec->name, "libx264" ) ? 1000000000 : 0 );
+        /* Hurrying up turns key frames into P frames */
+        p_sys->b_hurry_up = false;
+    }
+
     if( i_codec_id == AV_CODEC_ID_RAWVIDEO )
     {
         /* XXX: hack: Force same codec (will be handled by transcode) */
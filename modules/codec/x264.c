@@ -1445,6 +1445,20 @@ static int  Open ( vlc_object_t *p_this )
     }
     free(psz_opts);
 
+    /* Fixed GOP requested by the caller: key frames only every i_iframes
+     * pictures, whatever the options */
+    if( p_enc->i_iframes > 0 )
+    {
+        p_sys->param.i_keyint_max = p_enc->i_iframes;
+        p_sys->param.i_scenecut_threshold = 0;
+        p_sys->param.b_intra_refresh = false;
+#if X264_BUILD >= 102 && X264_BUILD <= 114
+        p_sys->param.i_open_gop = X264_OPEN_GOP_NONE;
+#elif X264_BUILD >= 115
+        p_sys->param.b_open_gop = false;
+#endif
+    }
+
     /* Open the encoder */
     p_sys->h = x264_encoder_open( &p_sys->param );
 
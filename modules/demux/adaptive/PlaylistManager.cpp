@@ -110,6 +110,8 @@ bool PlaylistManager::setupPeriod()
     if(!logic && !(logic = createLogic(logicType, conManager)))
         return false;
 
+    const int64_t i_prefetch = var_InheritInteger(p_demux, "adaptive-prefetch");
+
     std::vector<BaseAdaptationSet*> sets = currentPeriod->getAdaptationSets();
     std::vector<BaseAdaptationSet*>::iterator it;
     for(it=sets.begin();it!=sets.end();++it)
@@ -121,6 +123,9 @@ bool PlaylistManager::setupPeriod()
             if(!tracker)
                 continue;
 
+            if(i_prefetch > 0)
+                tracker->setPrefetchDepth(i_prefetch);
+
             AbstractStream *st = streamFactory->create(p_demux, set->getStreamFormat(),
                                                        tracker, conManager);
             if(!st)
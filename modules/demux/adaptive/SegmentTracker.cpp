@@ -84,6 +84,7 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     index_sent = false;
     init_sent = false;
     curRepresentation = NULL;
+    prefetchDepth = 0;
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNSUPPORTED;
@@ -127,6 +128,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    clearPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -246,7 +248,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetched(rep, next);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -273,6 +277,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager);
     }
 
     return chunk;
@@ -303,6 +308,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    clearPrefetched();
     curNumber = next = segnumber;
 }
 
@@ -356,6 +362,73 @@ void SegmentTracker::updateSelected()
     }
 }
 
+void SegmentTracker::setPrefetchDepth(unsigned depth)
+{
+    prefetchDepth = depth;
+    if(prefetchDepth == 0)
+        clearPrefetched();
+}
+
+SegmentChunk * SegmentTracker::getPrefetched(BaseRepresentation *rep, uint64_t number)
+{
+    SegmentChunk *chunk = NULL;
+    /* anything before the requested segment, or from another
+     * representation, won't be used anymore */
+    while(!prefetched.empty())
+    {
+        const PrefetchedChunk &p = prefetched.front();
+        if(p.rep == rep && p.number > number)
+            break;
+        if(p.rep == rep && p.number == number)
+            chunk = p.chunk;
+        else
+            delete p.chunk; /* cancels the download */
+        prefetched.pop_front();
+        if(chunk)
+            break;
+    }
+    return chunk;
+}
+
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    /* Start downloading the following segments now, so their transfers
+     * overlap with the current one instead of waiting for each request's
+     * round trip. Chunks are handed out in order by getNextChunk(). */
+    uint64_t number = next;
+    if(!prefetched.empty())
+        number = prefetched.back().number + 1;
+
+    while(prefetched.size() < prefetchDepth)
+    {
+        bool b_gap = false;
+        uint64_t found;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &found, &b_gap);
+        if(!segment)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(found, rep, connManager);
+        if(!chunk)
+            break;
+
+        PrefetchedChunk p;
+        p.rep = rep;
+        p.number = found;
+        p.chunk = chunk;
+        prefetched.push_back(p);
+        number = found + 1;
+    }
+}
+
+void SegmentTracker::clearPrefetched()
+{
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).chunk;
+    prefetched.clear();
+}
+
 void SegmentTracker::notify(const SegmentTrackerEvent &event) const
 {
     std::list<SegmentTrackerListenerInterface *>::const_iterator it;
@@ -127,10 +127,14 @@ namespace adaptive
             void notifyBufferingLevel(mtime_t, mtime_t, mtime_t) const;
             void registerListener(SegmentTrackerListenerInterface *);
             void updateSelected();
+            void setPrefetchDepth(unsigned);
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetched(BaseRepresentation *, uint64_t);
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *);
+            void clearPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +146,16 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+
+            /* Chunks of the upcoming segments, already downloading */
+            struct PrefetchedChunk
+            {
+                BaseRepresentation *rep;
+                uint64_t number;
+                SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            unsigned prefetchDepth;
     };
 }
 
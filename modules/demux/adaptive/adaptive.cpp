@@ -76,6 +76,20 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_CACHE_DIR_TEXT N_("Segments cache directory")
+#define ADAPT_CACHE_DIR_LONGTEXT N_("Keep the downloaded segments in this directory " \
+    "so that they can be shared with other instances. " \
+    "Only segments with a Cache-Control max-age are kept. Disabled if empty.")
+
+#define ADAPT_CACHE_SIZE_TEXT N_("Segments cache size in MiB")
+#define ADAPT_CACHE_SIZE_LONGTEXT N_("Maximum size of the segments cache directory. " \
+    "Least recently used segments are evicted first.")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetch depth")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of upcoming segments of each stream " \
+    "downloaded in parallel with the current one. Reduces the impact of " \
+    "the request latency on high round-trip time links. 0 to disable.")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -122,6 +136,10 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-prefetch", 0, 0, 8,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+        add_directory( "adaptive-cache-dir", NULL, ADAPT_CACHE_DIR_TEXT, ADAPT_CACHE_DIR_LONGTEXT, true )
+        add_integer( "adaptive-cache-size", 256, ADAPT_CACHE_SIZE_TEXT, ADAPT_CACHE_SIZE_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -126,6 +127,8 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
     prepared = false;
     eof = false;
     sourceid = id;
+    cached = NULL;
+    cachewriter = NULL;
     if(!init(url))
         eof = true;
 }
@@ -134,6 +137,9 @@ HTTPChunkSource::~HTTPChunkSource()
 {
     if(connection)
         connection->setUsed(false);
+    if(cached)
+        block_Release(cached);
+    delete cachewriter;
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -182,6 +188,17 @@ block_t * HTTPChunkSource::read(size_t readsize)
         return NULL;
     }
 
+    if(cached)
+    {
+        readsize = std::min(readsize, cached->i_buffer - consumed);
+        memcpy(p_block->p_buffer, &cached->p_buffer[consumed], readsize);
+        p_block->i_buffer = readsize;
+        consumed += readsize;
+        if(consumed == cached->i_buffer)
+            eof = true;
+        return p_block;
+    }
+
     mtime_t time = mdate();
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     time = mdate() - time;
@@ -197,12 +214,22 @@ block_t * HTTPChunkSource::read(size_t readsize)
         consumed += p_block->i_buffer;
         if((size_t)ret < readsize)
             eof = true;
+        storeCache(p_block);
         connManager->updateDownloadRate(sourceid, p_block->i_buffer, time);
     }
 
     return p_block;
 }
 
+void HTTPChunkSource::storeCache(const block_t *p_block)
+{
+    if(cachewriter && !cachewriter->write(p_block))
+    {
+        delete cachewriter;
+        cachewriter = NULL;
+    }
+}
+
 bool HTTPChunkSource::prepare(int i_redir)
 {
     if(prepared)
@@ -211,6 +238,18 @@ bool HTTPChunkSource::prepare(int i_redir)
     if(!connManager)
         return false;
 
+    SegmentCache *cache = connManager->getSegmentCache();
+    if(cache && i_redir == 0 && !connection)
+    {
+        cached = cache->get(params.getUrl(), bytesRange);
+        if(cached)
+        {
+            contentLength = cached->i_buffer;
+            prepared = true;
+            return true;
+        }
+    }
+
     if(!connection)
     {
         connection = connManager->getConnection(params);
@@ -228,6 +267,9 @@ bool HTTPChunkSource::prepare(int i_redir)
     /* Because we don't know Chunk size at start, we need to get size
            from content length */
     contentLength = connection->getContentLength();
+    if(cache)
+        cachewriter = cache->store(params.getUrl(), bytesRange,
+                                   contentLength, connection->getMaxAge());
     prepared = true;
 
     return true;
@@ -251,6 +293,7 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     eof = false;
     held = false;
     downloadstart = 0;
+    downloader = NULL;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -282,6 +325,13 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+mtime_t HTTPChunkBufferedSource::getDownloadTime() const
+{
+    /* concurrent transfers share the link: measure each one against
+     * its share of the elapsed time */
+    return downloader ? downloader->getSharedTime() : mdate();
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     vlc_mutex_locker locker( &lock );
@@ -307,6 +357,19 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
+    if(cached)
+    {
+        /* served from the cache: no download, nor rate update */
+        buffered += cached->i_buffer;
+        block_ChainLastAppend(&pp_tail, cached);
+        cached = NULL;
+        done = true;
+        downloadstart = 0;
+        vlc_cond_signal(&avail);
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
@@ -336,12 +399,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_mutex_locker locker( &lock );
         done = true;
         rate.size = buffered + consumed;
-        rate.time = mdate() - downloadstart;
+        rate.time = getDownloadTime() - downloadstart;
         downloadstart = 0;
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
+        storeCache(p_block);
         vlc_mutex_locker locker( &lock );
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
@@ -349,7 +413,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         {
             done = true;
             rate.size = buffered + consumed;
-            rate.time = mdate() - downloadstart;
+            rate.time = getDownloadTime() - downloadstart;
             downloadstart = 0;
         }
     }
@@ -366,7 +430,7 @@ bool HTTPChunkBufferedSource::prepare()
 {
     if(!prepared)
     {
-        downloadstart = mdate();
+        downloadstart = getDownloadTime();
         return HTTPChunkSource::prepare();
     }
     return true;
@@ -41,6 +41,8 @@ namespace adaptive
         class AbstractConnection;
         class AbstractConnectionManager;
         class AbstractChunk;
+        class SegmentCacheWriter;
+        class Downloader;
 
         class AbstractChunkSource
         {
@@ -95,12 +97,15 @@ namespace adaptive
 
             protected:
                 virtual bool      prepare(int = 0);
+                void              storeCache(const block_t *);
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
                 size_t              consumed; /* read pointer */
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                block_t            *cached; /* segment from the cache */
+                SegmentCacheWriter *cachewriter;
 
             private:
                 bool init(const std::string &);
@@ -125,6 +130,7 @@ namespace adaptive
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                mtime_t            getDownloadTime() const;
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -133,6 +139,7 @@ namespace adaptive
                 bool                done;
                 bool                eof;
                 mtime_t             downloadstart;
+                Downloader         *downloader;
                 mutable vlc_mutex_t lock;
                 vlc_cond_t          avail;
                 bool                held;
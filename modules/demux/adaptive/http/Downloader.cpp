@@ -32,19 +32,24 @@ Downloader::Downloader()
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&donecond);
+    vlc_mutex_init(&clocklock);
     killed = false;
-    thread_handle_valid = false;
+    active = 0;
+    sharedtime = 0;
+    lastupdate = 0;
 }
 
-bool Downloader::start()
+bool Downloader::start(unsigned count)
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < count)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            return !threads.empty();
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
     return true;
 }
 
@@ -52,18 +57,22 @@ Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
+    vlc_mutex_destroy(&clocklock);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&donecond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->hold();
+    source->downloader = this;
     chunks.push_back(source);
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
@@ -72,11 +81,32 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the worker to leave the source */
+    while(isDownloading(source))
+        vlc_cond_wait(&donecond, &lock);
     source->release();
     chunks.remove(source);
     vlc_mutex_unlock(&lock);
 }
 
+mtime_t Downloader::getSharedTime()
+{
+    vlc_mutex_locker locker(&clocklock);
+    updateSharedTime(0);
+    return sharedtime;
+}
+
+void Downloader::updateSharedTime(int diff)
+{
+    const mtime_t now = mdate();
+    if(active > 0)
+        sharedtime += (now - lastupdate) / active;
+    else
+        sharedtime += now - lastupdate;
+    lastupdate = now;
+    active += diff;
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     Downloader *instance = static_cast<Downloader *>(opaque);
@@ -92,27 +122,61 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+HTTPChunkBufferedSource * Downloader::getIdleSource() const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+        if(!isDownloading(*it))
+            return *it;
+    }
+    return NULL;
+}
+
+bool Downloader::isDownloading(const HTTPChunkBufferedSource *source) const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = downloading.begin(); it != downloading.end(); ++it)
+    {
+        if(*it == source)
+            return true;
+    }
+    return false;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while(!(source = getIdleSource()) && !killed)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        /* The oldest idle source is picked first, so that already
+         * started transfers are continued before starting new ones */
+        downloading.push_back(source);
+        vlc_mutex_lock(&clocklock);
+        updateSharedTime(1);
+        vlc_mutex_unlock(&clocklock);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        vlc_mutex_lock(&clocklock);
+        updateSharedTime(-1);
+        vlc_mutex_unlock(&clocklock);
+        downloading.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            chunks.remove(source);
+            source->release();
         }
+        vlc_cond_broadcast(&donecond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -36,20 +37,31 @@ namespace adaptive
             public:
                 Downloader();
                 ~Downloader();
-                bool start();
+                bool start(unsigned = 1);
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                mtime_t getSharedTime();
 
             private:
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getIdleSource() const;
+                bool isDownloading(const HTTPChunkBufferedSource *) const;
+                void updateSharedTime(int);
+                std::vector<vlc_thread_t> threads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   donecond;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> downloading;
+                /* Elapsed time divided by the number of concurrent
+                 * transfers, so each one gets its bandwidth share */
+                vlc_mutex_t  clocklock;
+                unsigned     active;
+                mtime_t      sharedtime;
+                mtime_t      lastupdate;
         };
 
     }
@@ -38,6 +38,7 @@ AbstractConnection::AbstractConnection(vlc_object_t *p_object_)
     available = true;
     bytesRead = 0;
     contentLength = 0;
+    maxAge = 0;
 }
 
 AbstractConnection::~AbstractConnection()
@@ -59,6 +60,11 @@ size_t AbstractConnection::getContentLength() const
     return contentLength;
 }
 
+int AbstractConnection::getMaxAge() const
+{
+    return maxAge;
+}
+
 HTTPConnection::HTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
                                Socket *socket_, const ConnectionParams &proxy, bool persistent)
     : AbstractConnection( p_object_ )
@@ -132,6 +138,7 @@ int HTTPConnection::request(const std::string &path, const BytesRange &range)
     chunked = false;
     chunked_eof = false;
     chunkLength = 0;
+    maxAge = 0;
 
     /* Set new path for this query */
     params.setPath(path);
@@ -387,6 +394,28 @@ void HTTPConnection::onHeader(const std::string &key,
     {
         authStorage->addCookie( value, params );
     }
+    else if(key == "Cache-Control")
+    {
+        std::istringstream ss(value);
+        ss.imbue(std::locale("C"));
+        std::string directive;
+        while(std::getline(ss, directive, ','))
+        {
+            directive.erase(0, directive.find_first_not_of(' '));
+            if(directive == "no-store" || directive == "no-cache")
+            {
+                maxAge = -1; /* never reusable */
+            }
+            else if(maxAge >= 0 && directive.compare(0, 8, "max-age=") == 0)
+            {
+                std::istringstream age(directive.substr(8));
+                age.imbue(std::locale("C"));
+                int i_age;
+                if(age >> i_age)
+                    maxAge = i_age;
+            }
+        }
+    }
 }
 
 std::string HTTPConnection::buildRequestHeader(const std::string &path) const
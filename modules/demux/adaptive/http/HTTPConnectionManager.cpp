@@ -30,6 +30,7 @@
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
 
@@ -40,11 +41,12 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    segmentCache = NULL;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
 {
-
+    delete segmentCache;
 }
 
 void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, mtime_t time)
@@ -58,6 +60,11 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+SegmentCache * AbstractConnectionManager::getSegmentCache() const
+{
+    return segmentCache;
+}
+
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, ConnectionFactory *factory_)
     : AbstractConnectionManager( p_object_ )
 {
@@ -72,11 +79,15 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
 {
     vlc_mutex_init(&lock);
     downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    /* prefetching needs concurrent transfers, enough for the
+     * prefetched segments of both audio and video streams */
+    const int64_t i_prefetch = var_InheritInteger(p_object, "adaptive-prefetch");
+    downloader->start(i_prefetch > 0 ? 2 * (i_prefetch + 1) : 1);
     if(var_InheritBool(p_object, "adaptive-use-access"))
         factory = new (std::nothrow) StreamUrlConnectionFactory();
     else
         factory = new (std::nothrow) ConnectionFactory( storage );
+    segmentCache = SegmentCache::create(p_object);
 }
 
 HTTPConnectionManager::~HTTPConnectionManager   ()
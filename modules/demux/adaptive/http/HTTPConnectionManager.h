@@ -42,6 +42,7 @@ namespace adaptive
         class AuthStorage;
         class Downloader;
         class AbstractChunkSource;
+        class SegmentCache;
 
         class AbstractConnectionManager : public IDownloadRateObserver
         {
@@ -55,9 +56,11 @@ namespace adaptive
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                SegmentCache * getSegmentCache() const;
 
             protected:
                 vlc_object_t                                       *p_object;
+                SegmentCache                                       *segmentCache;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
@@ -0,0 +1,449 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLabs and VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "../tools/Debug.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <ctime>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_FLOCK
+# include <sys/file.h>
+#endif
+
+using namespace adaptive::http;
+
+#define SEGMENT_CACHE_SUFFIX ".seg"
+/* how often the directory is rescanned for entries of other instances */
+#define SEGMENT_CACHE_SCAN_INTERVAL 60
+
+/* Header of the cache files, followed by the key, then the data.
+ * The cache is local, hence the native byte order. */
+struct SegmentCacheHeader
+{
+    char     magic[4];
+    uint32_t keylength;
+    int64_t  expires;   /* seconds since the Epoch */
+    uint64_t length;
+};
+
+static const char segmentCacheMagic[4] = { 'V', 'S', 'C', '1' };
+
+/* Writers keep their temporary file locked until it is renamed or removed,
+ * so that other instances do not remove it while it is being written. */
+static bool lockTemporary(int fd)
+{
+#ifdef HAVE_FLOCK
+    return flock(fd, LOCK_EX | LOCK_NB) == 0;
+#else
+    VLC_UNUSED(fd);
+    return true;
+#endif
+}
+
+static bool readFull(int fd, void *p_buf, size_t len)
+{
+    uint8_t *p = static_cast<uint8_t *>(p_buf);
+    while(len > 0)
+    {
+        ssize_t ret = read(fd, p, len);
+        if(ret <= 0)
+        {
+            if(ret < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        p += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+SegmentCache::SegmentCache(vlc_object_t *p_obj_, const std::string &dir_, uint64_t maxsize_)
+{
+    p_obj = p_obj_;
+    dir = dir_;
+    maxsize = maxsize_;
+    hits = misses = stores = 0;
+    totalsize = 0;
+    lastscan = 0;
+    vlc_mutex_init(&lock);
+}
+
+SegmentCache::~SegmentCache()
+{
+    msg_Dbg(p_obj, "segment cache: %u hit(s), %u miss(es), %u stored",
+            hits, misses, stores);
+    vlc_mutex_destroy(&lock);
+}
+
+SegmentCache * SegmentCache::create(vlc_object_t *p_obj)
+{
+    char *psz_dir = var_InheritString(p_obj, "adaptive-cache-dir");
+    if(!psz_dir)
+        return NULL;
+
+    std::string dir(psz_dir);
+    free(psz_dir);
+    if(dir.empty())
+        return NULL;
+
+    if(vlc_mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        msg_Warn(p_obj, "cannot create segment cache directory %s: %s",
+                 dir.c_str(), vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    int64_t i_size = var_InheritInteger(p_obj, "adaptive-cache-size");
+    if(i_size <= 0)
+        return NULL;
+
+    SegmentCache *cache = new (std::nothrow) SegmentCache(p_obj, dir, (uint64_t) i_size << 20);
+    /* learn the current size of the directory */
+    if(cache)
+        cache->trim();
+    return cache;
+}
+
+std::string SegmentCache::getKey(const std::string &url, const BytesRange &range) const
+{
+    std::stringstream ss;
+    ss.imbue(std::locale("C"));
+    ss << url;
+    if(range.isValid())
+        ss << "#" << range.getStartByte() << "-" << range.getEndByte();
+    return ss.str();
+}
+
+std::string SegmentCache::getPath(const std::string &key) const
+{
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, key.c_str(), key.length());
+    EndMD5(&md5);
+
+    std::string path = dir + DIR_SEP;
+    char *psz_hash = psz_md5_hash(&md5);
+    if(psz_hash)
+    {
+        path.append(psz_hash);
+        free(psz_hash);
+    }
+    return path + SEGMENT_CACHE_SUFFIX;
+}
+
+block_t * SegmentCache::get(const std::string &url, const BytesRange &range)
+{
+    const std::string key = getKey(url, range);
+    const std::string path = getPath(key);
+    block_t *p_block = NULL;
+    uint64_t removed = 0;
+
+    int fd = vlc_open(path.c_str(), O_RDWR);
+    if(fd != -1)
+    {
+        SegmentCacheHeader hdr;
+        std::vector<char> filekey;
+
+        if(readFull(fd, &hdr, sizeof(hdr)) &&
+           !memcmp(hdr.magic, segmentCacheMagic, 4) &&
+           hdr.keylength == key.length() && hdr.length <= maxsize)
+        {
+            filekey.resize(hdr.keylength);
+            if(readFull(fd, &filekey[0], hdr.keylength) &&
+               !memcmp(&filekey[0], key.c_str(), hdr.keylength))
+            {
+                if(hdr.expires < (int64_t) time(NULL))
+                {
+                    /* stale */
+                    struct stat st;
+                    if(fstat(fd, &st) == 0 && vlc_unlink(path.c_str()) == 0)
+                        removed = st.st_size;
+                }
+                else if((p_block = block_Alloc(hdr.length)) &&
+                        !readFull(fd, p_block->p_buffer, hdr.length))
+                {
+                    block_Release(p_block);
+                    p_block = NULL;
+                }
+            }
+        }
+
+        /* Rewrite the header to refresh the modification time used
+         * for the LRU eviction */
+        if(p_block && (lseek(fd, 0, SEEK_SET) != 0 ||
+                       vlc_write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)))
+            msg_Warn(p_obj, "cannot refresh segment cache entry %s", path.c_str());
+
+        vlc_close(fd);
+    }
+
+    vlc_mutex_lock(&lock);
+    totalsize -= std::min(totalsize, removed);
+    if(p_block)
+        hits++;
+    else
+        misses++;
+    AdvDebug(msg_Dbg(p_obj, "segment cache %s for %s (%u hits, %u misses)",
+                     p_block ? "hit" : "miss", key.c_str(), hits, misses));
+    vlc_mutex_unlock(&lock);
+
+    return p_block;
+}
+
+SegmentCacheWriter * SegmentCache::store(const std::string &url, const BytesRange &range,
+                                         size_t length, int maxage)
+{
+    /* only complete responses which the server allows to be reused */
+    if(maxage <= 0 || length == 0 || length > maxsize / 4)
+        return NULL;
+
+    const std::string key = getKey(url, range);
+    const std::string path = getPath(key);
+
+    std::string tmppath = path + ".XXXXXX";
+    std::vector<char> tmpl(tmppath.begin(), tmppath.end());
+    tmpl.push_back('\0');
+
+    int fd = vlc_mkstemp(&tmpl[0]);
+    if(fd == -1)
+        return NULL;
+    tmppath = &tmpl[0];
+
+    if(!lockTemporary(fd))
+    {
+        vlc_close(fd);
+        vlc_unlink(tmppath.c_str());
+        return NULL;
+    }
+
+    FILE *file = fdopen(fd, "wb");
+    if(!file)
+    {
+        vlc_close(fd);
+        vlc_unlink(tmppath.c_str());
+        return NULL;
+    }
+
+    SegmentCacheHeader hdr;
+    memcpy(hdr.magic, segmentCacheMagic, 4);
+    hdr.keylength = key.length();
+    hdr.expires = (int64_t) time(NULL) + maxage;
+    hdr.length = length;
+
+    if(fwrite(&hdr, sizeof(hdr), 1, file) != 1 ||
+       fwrite(key.c_str(), key.length(), 1, file) != 1)
+    {
+        fclose(file);
+        vlc_unlink(tmppath.c_str());
+        return NULL;
+    }
+
+    SegmentCacheWriter *writer = new (std::nothrow)
+            SegmentCacheWriter(this, file, tmppath, path, length);
+    if(!writer)
+    {
+        fclose(file);
+        vlc_unlink(tmppath.c_str());
+    }
+    return writer;
+}
+
+void SegmentCache::commit(const std::string &tmppath, const std::string &path)
+{
+    struct stat st;
+    uint64_t added = 0, replaced = 0;
+
+    if(vlc_stat(tmppath.c_str(), &st) == 0)
+        added = st.st_size;
+    if(vlc_stat(path.c_str(), &st) == 0)
+        replaced = st.st_size;
+
+    /* rename() atomically replaces any entry written by another instance */
+    if(vlc_rename(tmppath.c_str(), path.c_str()) != 0)
+    {
+        vlc_unlink(tmppath.c_str());
+        return;
+    }
+
+    /* Other instances sharing the directory are only accounted for by the
+     * scans, hence the periodic rescan even below the limit */
+    vlc_mutex_lock(&lock);
+    stores++;
+    totalsize = totalsize - std::min(totalsize, replaced) + added;
+    const bool b_trim = totalsize > maxsize ||
+                        lastscan + SEGMENT_CACHE_SCAN_INTERVAL < time(NULL);
+    vlc_mutex_unlock(&lock);
+
+    if(b_trim)
+        trim();
+}
+
+struct SegmentCacheFile
+{
+    std::string path;
+    time_t      mtime;
+    uint64_t    size;
+
+    bool operator<(const SegmentCacheFile &other) const
+    {
+        return mtime < other.mtime;
+    }
+};
+
+void SegmentCache::trim()
+{
+    DIR *p_dir = vlc_opendir(dir.c_str());
+    if(!p_dir)
+        return;
+
+    std::vector<SegmentCacheFile> files;
+    uint64_t total = 0;
+    const time_t now = time(NULL);
+    const char *psz_name;
+
+    while((psz_name = vlc_readdir(p_dir)) != NULL)
+    {
+        std::string name(psz_name);
+        std::string::size_type suffix = name.rfind(SEGMENT_CACHE_SUFFIX);
+        if(suffix == std::string::npos)
+            continue;
+
+        SegmentCacheFile file;
+        file.path = dir + DIR_SEP + name;
+
+        struct stat st;
+        if(vlc_stat(file.path.c_str(), &st) != 0)
+            continue;
+
+        /* leftovers from interrupted downloads, unless still being written */
+        if(suffix + strlen(SEGMENT_CACHE_SUFFIX) != name.length())
+        {
+            if(st.st_mtime + 3600 < now)
+            {
+                int fd = vlc_open(file.path.c_str(), O_RDONLY);
+                if(fd != -1)
+                {
+                    if(lockTemporary(fd))
+                        vlc_unlink(file.path.c_str());
+                    vlc_close(fd);
+                }
+            }
+            continue;
+        }
+
+        file.mtime = st.st_mtime;
+        file.size = st.st_size;
+        total += file.size;
+        files.push_back(file);
+    }
+    closedir(p_dir);
+
+    if(total > maxsize)
+    {
+        /* evict the least recently used entries */
+        std::sort(files.begin(), files.end());
+        const uint64_t target = maxsize - maxsize / 8;
+        std::vector<SegmentCacheFile>::const_iterator it;
+        for(it = files.begin(); it != files.end() && total > target; ++it)
+        {
+            if(vlc_unlink((*it).path.c_str()) == 0 || errno == ENOENT)
+                total -= (*it).size;
+        }
+    }
+
+    vlc_mutex_lock(&lock);
+    totalsize = total;
+    lastscan = now;
+    vlc_mutex_unlock(&lock);
+}
+
+SegmentCacheWriter::SegmentCacheWriter(SegmentCache *cache_, FILE *file_,
+                                       const std::string &tmppath_,
+                                       const std::string &path_, size_t length_)
+{
+    cache = cache_;
+    file = file_;
+    tmppath = tmppath_;
+    path = path_;
+    length = length_;
+    written = 0;
+}
+
+SegmentCacheWriter::~SegmentCacheWriter()
+{
+    if(file)
+    {
+        fclose(file);
+        vlc_unlink(tmppath.c_str());
+    }
+}
+
+bool SegmentCacheWriter::write(const block_t *p_block)
+{
+    if(!file)
+        return false;
+
+    if(written + p_block->i_buffer > length ||
+       fwrite(p_block->p_buffer, 1, p_block->i_buffer, file) != p_block->i_buffer)
+    {
+        fclose(file);
+        file = NULL;
+        vlc_unlink(tmppath.c_str());
+        return false;
+    }
+
+    written += p_block->i_buffer;
+
+    /* complete, make it visible */
+    if(written == length)
+        return commit();
+    return true;
+}
+
+bool SegmentCacheWriter::commit()
+{
+    if(!file || written != length)
+        return false;
+
+    int ret = fclose(file);
+    file = NULL;
+    if(ret != 0)
+    {
+        vlc_unlink(tmppath.c_str());
+        return false;
+    }
+
+    cache->commit(tmppath, path);
+    return true;
+}
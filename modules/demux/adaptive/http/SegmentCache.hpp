@@ -0,0 +1,90 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLabs and VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP_
+#define SEGMENTCACHE_HPP_
+
+#include "BytesRange.hpp"
+
+#include <vlc_common.h>
+
+#include <string>
+#include <ctime>
+
+namespace adaptive
+{
+    namespace http
+    {
+        class SegmentCacheWriter;
+
+        /* On-disk LRU cache of downloaded segments, shared between processes.
+         * Entries are keyed by url and byte range, written to a temporary
+         * file and atomically renamed into place once complete, and expire
+         * according to the Cache-Control max-age of the response. */
+        class SegmentCache
+        {
+            public:
+                SegmentCache(vlc_object_t *, const std::string &dir, uint64_t maxsize);
+                ~SegmentCache();
+                static SegmentCache * create(vlc_object_t *);
+
+                block_t * get(const std::string &url, const BytesRange &);
+                SegmentCacheWriter * store(const std::string &url, const BytesRange &,
+                                           size_t length, int maxage);
+
+            private:
+                friend class SegmentCacheWriter;
+                std::string getKey(const std::string &, const BytesRange &) const;
+                std::string getPath(const std::string &) const;
+                void commit(const std::string &tmppath, const std::string &path);
+                void trim();
+
+                vlc_object_t *p_obj;
+                std::string dir;
+                uint64_t maxsize;
+                vlc_mutex_t lock;
+                uint64_t totalsize; /* as of the last scan, plus our own stores */
+                time_t lastscan;
+                unsigned hits;
+                unsigned misses;
+                unsigned stores;
+        };
+
+        class SegmentCacheWriter
+        {
+            public:
+                SegmentCacheWriter(SegmentCache *, FILE *, const std::string &tmppath,
+                                   const std::string &path, size_t length);
+                ~SegmentCacheWriter();
+                bool write(const block_t *);
+
+            private:
+                bool commit();
+
+                SegmentCache *cache;
+                FILE *file;
+                std::string tmppath;
+                std::string path;
+                size_t length;
+                size_t written;
+        };
+    }
+}
+
+#endif
@@ -342,6 +342,8 @@ public:
         ,f_duration(-1.0)
         ,p_input(NULL)
         ,p_ev(NULL)
+        ,i_sliced_bytes(0)
+        ,i_copied_bytes(0)
     {
         vlc_mutex_init( &lock_demuxer );
     }
@@ -397,6 +399,10 @@ public:
 
     /* event */
     event_thread_t *p_ev;
+
+    /* frame data sliced from the stream buffer or copied, for statistics */
+    uint64_t       i_sliced_bytes;
+    uint64_t       i_copied_bytes;
 };
 
 
@@ -28,6 +28,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "stream_io_callback.hpp"
 
 #include <new>
 #include <iterator>
@@ -61,11 +62,15 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,i_seek_index_size(0)
+    ,p_cluster_scanner(NULL)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    SaveSeekIndex();
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -694,12 +699,59 @@ bool matroska_segment_c::Preload( )
 
     b_preloaded = true;
 
+    if( !b_cues && cluster && !seek_index_path.empty() )
+        LoadSeekIndex();
+
     if( cluster )
         EnsureDuration();
 
     return true;
 }
 
+/* The seek index keeps what was learnt about files without Cues, so that
+ * seeking does not have to scan the clusters again on the next playback */
+void matroska_segment_c::LoadSeekIndex()
+{
+    _seeker.load_index( &sys.demuxer, seek_index_path, seek_index_key );
+    i_seek_index_size = _seeker.index_size();
+
+    if( !var_InheritBool( &sys.demuxer, "mkv-seek-index-background" ) ||
+        sys.demuxer.psz_file == NULL )
+        return;
+
+    /* continue from the last cluster known */
+    SegmentSeeker::fptr_t i_start = *_seeker._cluster_positions.rbegin();
+    SegmentSeeker::fptr_t i_end = segment->IsFiniteSize()
+        ? segment->GetEndPosition()
+        : std::numeric_limits<SegmentSeeker::fptr_t>::max();
+
+    p_cluster_scanner = new (std::nothrow) ClusterScanner( &sys.demuxer,
+        sys.demuxer.psz_file, i_start, i_end, i_timescale );
+    if( p_cluster_scanner && !p_cluster_scanner->start() )
+    {
+        msg_Warn( &sys.demuxer, "cannot scan clusters in the background" );
+        delete p_cluster_scanner;
+        p_cluster_scanner = NULL;
+    }
+}
+
+void matroska_segment_c::SaveSeekIndex()
+{
+    if( p_cluster_scanner )
+    {
+        p_cluster_scanner->stop();
+        p_cluster_scanner->merge( _seeker );
+        delete p_cluster_scanner;
+        p_cluster_scanner = NULL;
+    }
+
+    if( seek_index_path.empty() || b_cues )
+        return;
+
+    if( _seeker.index_size() != i_seek_index_size )
+        _seeker.save_index( &sys.demuxer, seek_index_path, seek_index_key );
+}
+
 /* Here we try to load elements that were found in Seek Heads, but not yet parsed */
 bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position )
 {
@@ -853,6 +905,9 @@ bool matroska_segment_c::Seek( demux_t &demuxer, mtime_t i_absolute_mk_date, mti
 
     // find appropriate seekpoints //
 
+    if( p_cluster_scanner )
+        p_cluster_scanner->merge( _seeker );
+
     try {
         seekpoints = _seeker.get_seekpoints( *this, i_mk_date, priority, selected_tracks );
     }
@@ -1189,6 +1244,12 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
             vars.obj->cluster = &kcluster;
             vars.b_cluster_timecode = false;
             vars.ep->Down ();
+
+            /* the whole cluster is about to be read */
+            vlc_stream_io_callback *p_io = dynamic_cast<vlc_stream_io_callback*>( &vars.obj->es.I_O() );
+            if( p_io != NULL && kcluster.IsFiniteSize() &&
+                kcluster.GetEndPosition() > p_io->getFilePointer() )
+                p_io->prefetch( kcluster.GetEndPosition() - p_io->getFilePointer() );
         }
         E_CASE( KaxCues, kcue )
         {
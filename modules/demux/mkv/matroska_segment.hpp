@@ -134,6 +134,10 @@ public:
     bool                           b_preloaded;
     bool                           b_ref_external_segments;
 
+    /* persistent seek index, empty if disabled */
+    std::string                    seek_index_path;
+    std::string                    seek_index_key;
+
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
     bool PreloadClusters( uint64 i_cluster_position );
@@ -170,8 +174,12 @@ private:
     bool TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void LoadSeekIndex();
+    void SaveSeekIndex();
 
     SegmentSeeker _seeker;
+    size_t         i_seek_index_size;
+    ClusterScanner *p_cluster_scanner;
 
     friend SegmentSeeker;
 };
@@ -29,8 +29,16 @@
 #include "util.hpp"
 #include "stream_io_callback.hpp"
 
+#include <vlc_fs.h>
+
 #include <sstream>
 #include <limits>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 namespace { 
     template<class It, class T>
@@ -73,7 +81,14 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
             : UINT64_MAX
     };
 
-    add_cluster_position( cinfo.fpos );
+    return add_cluster( cinfo );
+}
+
+SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::add_cluster( Cluster const& cinfo )
+{
+    if( !std::binary_search( _cluster_positions.begin(), _cluster_positions.end(), cinfo.fpos ) )
+        add_cluster_position( cinfo.fpos );
 
     cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
 
@@ -486,3 +501,437 @@ SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
     ms.es.I_O().setFilePointer( fpos );
 }
 
+
+/*****************************************************************************
+ * Persistent index
+ *****************************************************************************
+ * The index is only meaningful for the exact file it was built from, the
+ * caller provides a key identifying it which is stored along the data.
+ * Values are stored in host byte order: the index lives in the user cache.
+ *****************************************************************************/
+namespace {
+    static const char   index_magic[8] = { 'V','L','C','M','K','V','S','I' };
+    static const uint32_t index_version = 1;
+
+    template<class T> bool write_value( FILE *f, T const& value )
+    {
+        return fwrite( &value, sizeof( value ), 1, f ) == 1;
+    }
+
+    template<class T> bool read_value( FILE *f, T& value )
+    {
+        return fread( &value, sizeof( value ), 1, f ) == 1;
+    }
+
+    /* reads an element count, rejecting counts larger than the file could hold */
+    bool read_count( FILE *f, uint64_t i_size, size_t i_record, uint64_t& count )
+    {
+        long i_pos = ftell( f );
+        if( !read_value( f, count ) || i_pos < 0 )
+            return false;
+        return count <= ( i_size - i_pos ) / i_record;
+    }
+}
+
+size_t
+SegmentSeeker::index_size() const
+{
+    size_t i_size = _ranges_searched.size() + _cluster_positions.size() + _clusters.size();
+
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+        i_size += it->second.size();
+
+    return i_size;
+}
+
+bool
+SegmentSeeker::load_index( demux_t *p_demux, std::string const& path, std::string const& key )
+{
+    FILE *f = vlc_fopen( path.c_str(), "rb" );
+    if( f == NULL )
+        return false;
+
+    bool b_ok = false;
+    SegmentSeeker index;
+    char magic[sizeof( index_magic )];
+    uint32_t i_version, i_key_size;
+    uint64_t i_size, count;
+
+    if( fseek( f, 0, SEEK_END ) || ( i_size = ftell( f ) ) == uint64_t( -1 ) ||
+        fseek( f, 0, SEEK_SET ) )
+        goto end;
+
+    if( fread( magic, sizeof( magic ), 1, f ) != 1 ||
+        memcmp( magic, index_magic, sizeof( magic ) ) ||
+        !read_value( f, i_version ) || i_version != index_version ||
+        !read_value( f, i_key_size ) || i_key_size != key.size() )
+        goto end;
+
+    {
+        std::vector<char> file_key( i_key_size );
+        if( i_key_size && fread( &file_key[0], i_key_size, 1, f ) != 1 )
+            goto end;
+        if( !std::equal( file_key.begin(), file_key.end(), key.begin() ) )
+            goto end;
+    }
+
+    /* searched ranges */
+    if( !read_count( f, i_size, 2 * sizeof( fptr_t ), count ) )
+        goto end;
+    for( ; count; --count )
+    {
+        fptr_t start, end;
+        if( !read_value( f, start ) || !read_value( f, end ) || end < start )
+            goto end;
+        index._ranges_searched.push_back( Range( start, end ) );
+    }
+
+    /* cluster positions */
+    if( !read_count( f, i_size, sizeof( fptr_t ), count ) )
+        goto end;
+    for( ; count; --count )
+    {
+        fptr_t fpos;
+        if( !read_value( f, fpos ) )
+            goto end;
+        index._cluster_positions.push_back( fpos );
+    }
+
+    /* clusters */
+    if( !read_count( f, i_size, 2 * sizeof( fptr_t ) + 2 * sizeof( mtime_t ), count ) )
+        goto end;
+    for( ; count; --count )
+    {
+        Cluster cinfo;
+        if( !read_value( f, cinfo.fpos ) || !read_value( f, cinfo.pts ) ||
+            !read_value( f, cinfo.duration ) || !read_value( f, cinfo.size ) )
+            goto end;
+        index._clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) );
+    }
+
+    /* seekpoints per track */
+    if( !read_count( f, i_size, sizeof( track_id_t ) + sizeof( uint64_t ), count ) )
+        goto end;
+    for( ; count; --count )
+    {
+        track_id_t track_id;
+        uint64_t i_points;
+
+        if( !read_value( f, track_id ) ||
+            !read_count( f, i_size, sizeof( fptr_t ) + sizeof( mtime_t ) + sizeof( int32_t ), i_points ) )
+            goto end;
+
+        seekpoints_t& seekpoints = index._tracks_seekpoints[ track_id ];
+        for( ; i_points; --i_points )
+        {
+            Seekpoint sp;
+            int32_t i_trust;
+
+            if( !read_value( f, sp.fpos ) || !read_value( f, sp.pts ) || !read_value( f, i_trust ) )
+                goto end;
+            if( i_trust != Seekpoint::TRUSTED && i_trust != Seekpoint::QUESTIONABLE &&
+                i_trust != Seekpoint::DISABLED )
+                goto end;
+            sp.trust_level = static_cast<Seekpoint::TrustLevel>( i_trust );
+            seekpoints.push_back( sp );
+        }
+    }
+
+    b_ok = true;
+
+end:
+    fclose( f );
+
+    if( !b_ok )
+    {
+        msg_Warn( p_demux, "ignoring invalid seek index %s", path.c_str() );
+        return false;
+    }
+
+    /* merge with what is already known about the segment */
+
+    for( ranges_t::const_iterator it = index._ranges_searched.begin(); it != index._ranges_searched.end(); ++it )
+        mark_range_as_searched( *it );
+
+    for( cluster_positions_t::const_iterator it = index._cluster_positions.begin(); it != index._cluster_positions.end(); ++it )
+    {
+        if( !std::binary_search( _cluster_positions.begin(), _cluster_positions.end(), *it ) )
+            add_cluster_position( *it );
+    }
+
+    for( cluster_map_t::const_iterator it = index._clusters.begin(); it != index._clusters.end(); ++it )
+        add_cluster( it->second );
+
+    for( tracks_seekpoints_t::const_iterator it = index._tracks_seekpoints.begin(); it != index._tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+            add_seekpoint( it->first, *sp );
+    }
+
+    msg_Dbg( p_demux, "loaded seek index %s (%zu clusters)", path.c_str(), index._clusters.size() );
+    return true;
+}
+
+bool
+SegmentSeeker::save_index( demux_t *p_demux, std::string const& path, std::string const& key ) const
+{
+    std::string tmp_path = path + ".tmp";
+
+    FILE *f = vlc_fopen( tmp_path.c_str(), "wb" );
+    if( f == NULL )
+    {
+        msg_Warn( p_demux, "cannot create seek index %s: %s", tmp_path.c_str(), vlc_strerror_c( errno ) );
+        return false;
+    }
+
+    bool b_ok = fwrite( index_magic, sizeof( index_magic ), 1, f ) == 1 &&
+                write_value( f, index_version ) &&
+                write_value( f, uint32_t( key.size() ) ) &&
+                ( key.empty() || fwrite( key.data(), key.size(), 1, f ) == 1 );
+
+    b_ok = b_ok && write_value( f, uint64_t( _ranges_searched.size() ) );
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); b_ok && it != _ranges_searched.end(); ++it )
+        b_ok = write_value( f, it->start ) && write_value( f, it->end );
+
+    b_ok = b_ok && write_value( f, uint64_t( _cluster_positions.size() ) );
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); b_ok && it != _cluster_positions.end(); ++it )
+        b_ok = write_value( f, *it );
+
+    b_ok = b_ok && write_value( f, uint64_t( _clusters.size() ) );
+    for( cluster_map_t::const_iterator it = _clusters.begin(); b_ok && it != _clusters.end(); ++it )
+        b_ok = write_value( f, it->second.fpos ) && write_value( f, it->second.pts ) &&
+               write_value( f, it->second.duration ) && write_value( f, it->second.size );
+
+    b_ok = b_ok && write_value( f, uint64_t( _tracks_seekpoints.size() ) );
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); b_ok && it != _tracks_seekpoints.end(); ++it )
+    {
+        b_ok = write_value( f, it->first ) && write_value( f, uint64_t( it->second.size() ) );
+
+        for( seekpoints_t::const_iterator sp = it->second.begin(); b_ok && sp != it->second.end(); ++sp )
+            b_ok = write_value( f, sp->fpos ) && write_value( f, sp->pts ) &&
+                   write_value( f, int32_t( sp->trust_level ) );
+    }
+
+    if( fclose( f ) )
+        b_ok = false;
+
+    if( !b_ok || vlc_rename( tmp_path.c_str(), path.c_str() ) )
+    {
+        msg_Warn( p_demux, "cannot write seek index %s", path.c_str() );
+        vlc_unlink( tmp_path.c_str() );
+        return false;
+    }
+
+    msg_Dbg( p_demux, "saved seek index %s", path.c_str() );
+    return true;
+}
+
+/*****************************************************************************
+ * Background cluster scanning
+ *****************************************************************************/
+ClusterScanner::ClusterScanner( demux_t *p_demux, const char *psz_file,
+                                SegmentSeeker::fptr_t start, SegmentSeeker::fptr_t end,
+                                uint64_t i_timescale )
+    : p_demux( p_demux )
+    , path( psz_file )
+    , i_start( start )
+    , i_end( end )
+    , i_timescale( i_timescale )
+    , fd( -1 )
+    , b_started( false )
+    , b_abort( false )
+{
+    vlc_mutex_init( &lock );
+}
+
+ClusterScanner::~ClusterScanner()
+{
+    stop();
+
+    if( fd != -1 )
+        vlc_close( fd );
+
+    vlc_mutex_destroy( &lock );
+}
+
+bool
+ClusterScanner::start()
+{
+    fd = vlc_open( path.c_str(), O_RDONLY );
+    if( fd == -1 )
+        return false;
+
+    if( vlc_clone( &thread, Run, this, VLC_THREAD_PRIORITY_LOW ) )
+        return false;
+
+    b_started = true;
+    return true;
+}
+
+void
+ClusterScanner::stop()
+{
+    if( !b_started )
+        return;
+
+    vlc_mutex_lock( &lock );
+    b_abort = true;
+    vlc_mutex_unlock( &lock );
+
+    vlc_join( thread, NULL );
+    b_started = false;
+}
+
+void
+ClusterScanner::merge( SegmentSeeker& seeker )
+{
+    std::vector<SegmentSeeker::Cluster> clusters;
+
+    vlc_mutex_lock( &lock );
+    clusters.swap( found );
+    vlc_mutex_unlock( &lock );
+
+    for( size_t i = 0; i < clusters.size(); ++i )
+        seeker.add_cluster( clusters[i] );
+}
+
+void *
+ClusterScanner::Run( void *data )
+{
+    static_cast<ClusterScanner*>( data )->scan();
+    return NULL;
+}
+
+bool
+ClusterScanner::aborted()
+{
+    vlc_mutex_lock( &lock );
+    bool b_ret = b_abort;
+    vlc_mutex_unlock( &lock );
+    return b_ret;
+}
+
+bool
+ClusterScanner::read_at( SegmentSeeker::fptr_t fpos, uint8_t *p_buf, size_t i_size )
+{
+    if( lseek( fd, fpos, SEEK_SET ) != off_t( fpos ) )
+        return false;
+
+    while( i_size > 0 )
+    {
+        ssize_t i_read = read( fd, p_buf, i_size );
+        if( i_read <= 0 )
+        {
+            if( i_read < 0 && errno == EINTR )
+                continue;
+            return false;
+        }
+        p_buf  += i_read;
+        i_size -= i_read;
+    }
+    return true;
+}
+
+/* reads an EBML ID (marker kept) or size (UINT64_MAX if unknown) */
+bool
+ClusterScanner::read_vint( SegmentSeeker::fptr_t& fpos, uint64_t& value, bool b_id )
+{
+    uint8_t buf[8];
+
+    if( !read_at( fpos, buf, 1 ) )
+        return false;
+
+    unsigned i_len = 1;
+    unsigned i_mask = 0x80;
+    while( i_len <= 8 && !( buf[0] & i_mask ) )
+    {
+        i_len++;
+        i_mask >>= 1;
+    }
+    if( i_len > ( b_id ? 4 : 8 ) )
+        return false;
+
+    if( i_len > 1 && !read_at( fpos + 1, buf + 1, i_len - 1 ) )
+        return false;
+
+    uint64_t i_value = b_id ? buf[0] : ( buf[0] & ( i_mask - 1 ) );
+    bool b_unknown = i_value == i_mask - 1;
+
+    for( unsigned i = 1; i < i_len; i++ )
+    {
+        i_value = ( i_value << 8 ) | buf[i];
+        b_unknown &= buf[i] == 0xff;
+    }
+
+    fpos += i_len;
+    value = ( !b_id && b_unknown ) ? UINT64_MAX : i_value;
+    return true;
+}
+
+void
+ClusterScanner::scan()
+{
+    static const uint64_t id_cluster = 0x1F43B675;
+    static const uint64_t id_cluster_timecode = 0xE7;
+
+    SegmentSeeker::fptr_t fpos = i_start;
+    size_t i_count = 0;
+
+    while( fpos < i_end && !aborted() )
+    {
+        SegmentSeeker::fptr_t data = fpos;
+        uint64_t id, size;
+
+        if( !read_vint( data, id, true ) || !read_vint( data, size, false ) )
+            break;
+
+        /* elements of unknown size cannot be skipped without parsing them */
+        if( size == UINT64_MAX || data > i_end || size > i_end - data )
+            break;
+
+        if( id == id_cluster )
+        {
+            SegmentSeeker::fptr_t child = data;
+
+            while( child < data + size )
+            {
+                uint64_t child_id, child_size;
+
+                if( !read_vint( child, child_id, true ) || !read_vint( child, child_size, false ) ||
+                    child_size == UINT64_MAX )
+                    break;
+
+                if( child_id == id_cluster_timecode )
+                {
+                    uint8_t buf[8];
+                    uint64_t i_timecode = 0;
+
+                    if( child_size > sizeof( buf ) || !read_at( child, buf, child_size ) )
+                        break;
+                    for( uint64_t i = 0; i < child_size; i++ )
+                        i_timecode = ( i_timecode << 8 ) | buf[i];
+
+                    SegmentSeeker::Cluster cinfo = {
+                        /* fpos     */ fpos,
+                        /* pts      */ mtime_t( i_timecode * i_timescale / INT64_C( 1000 ) ),
+                        /* duration */ mtime_t( -1 ),
+                        /* size     */ data + size - fpos
+                    };
+
+                    vlc_mutex_lock( &lock );
+                    found.push_back( cinfo );
+                    vlc_mutex_unlock( &lock );
+
+                    i_count++;
+                    break;
+                }
+
+                child += child_size;
+            }
+        }
+
+        fpos = data + size;
+    }
+
+    msg_Dbg( p_demux, "cluster scan done, %zu clusters found", i_count );
+}
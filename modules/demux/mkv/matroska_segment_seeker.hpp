@@ -30,6 +30,7 @@
 #include <vector>
 #include <map>
 #include <limits>
+#include <string>
 
 class matroska_segment_c;
 
@@ -109,6 +110,7 @@ class SegmentSeeker
 
         cluster_positions_t::iterator add_cluster_position( fptr_t pos );
         cluster_map_t      ::iterator add_cluster( KaxCluster * const );
+        cluster_map_t      ::iterator add_cluster( Cluster const& );
 
         void mkv_jump_to( matroska_segment_c&, fptr_t );
 
@@ -118,6 +120,10 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        bool load_index( demux_t *, std::string const& path, std::string const& key );
+        bool save_index( demux_t *, std::string const& path, std::string const& key ) const;
+        size_t index_size() const;
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
@@ -125,4 +131,38 @@ class SegmentSeeker
         cluster_map_t       _clusters;
 };
 
+/* Locates the clusters of a local file from a separate thread, without
+ * disturbing the demuxer: only the cluster headers and timecodes are read */
+class ClusterScanner
+{
+    public:
+        ClusterScanner( demux_t *, const char *psz_file, SegmentSeeker::fptr_t start,
+                        SegmentSeeker::fptr_t end, uint64_t i_timescale );
+        ~ClusterScanner();
+
+        bool start();
+        void stop();
+        void merge( SegmentSeeker& );
+
+    private:
+        static void *Run( void * );
+        void scan();
+        bool aborted();
+        bool read_at( SegmentSeeker::fptr_t, uint8_t *, size_t );
+        bool read_vint( SegmentSeeker::fptr_t&, uint64_t&, bool b_id );
+
+        demux_t              *p_demux;
+        std::string           path;
+        SegmentSeeker::fptr_t i_start;
+        SegmentSeeker::fptr_t i_end;
+        uint64_t              i_timescale;
+        int                   fd;
+
+        vlc_thread_t          thread;
+        vlc_mutex_t           lock;
+        bool                  b_started;
+        bool                  b_abort;
+        std::vector<SegmentSeeker::Cluster> found;
+};
+
 #endif /* include-guard */
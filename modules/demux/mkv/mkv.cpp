@@ -34,9 +34,11 @@
 #include "stream_io_callback.hpp"
 
 #include <new>
+#include <sys/stat.h>
 
 #include <vlc_fs.h>
 #include <vlc_url.h>
+#include <vlc_md5.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -76,6 +78,14 @@ vlc_module_begin ()
             N_("Preload clusters"),
             N_("Find all cluster positions by jumping cluster-to-cluster before playback"), true );
 
+    add_bool( "mkv-seek-index", false,
+            N_("Cache seek index"),
+            N_("Keep the seek positions found in local files without cues, to seek faster when they are played again."), true );
+
+    add_bool( "mkv-seek-index-background", true,
+            N_("Build seek index in background"),
+            N_("Look for the cluster positions during playback when the seek index is cached."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -85,6 +95,53 @@ static int  Demux  ( demux_t * );
 static int  Control( demux_t *, int, va_list );
 static int  Seek   ( demux_t *, mtime_t i_mk_date, double f_percent, virtual_chapter_c *p_vchapter, bool b_precise = true );
 
+/*****************************************************************************
+ * GetSeekIndex: identifies a local file for its persistent seek index
+ *****************************************************************************/
+static bool GetSeekIndex( demux_t *p_demux, std::string & path, std::string & key )
+{
+    if( !var_InheritBool( p_demux, "mkv-seek-index" ) ||
+        p_demux->psz_file == NULL || strcmp( p_demux->psz_access, "file" ) )
+        return false;
+
+    struct stat st;
+    const uint8_t *p_peek;
+    ssize_t i_peek;
+
+    if( vlc_stat( p_demux->psz_file, &st ) ||
+        ( i_peek = vlc_stream_Peek( p_demux->s, &p_peek, 65536 ) ) < 0 )
+        return false;
+
+    /* the size, the modification time and the head of the file (which
+     * holds the segment information) catch most modifications */
+    uint64_t i_size  = st.st_size;
+    int64_t  i_mtime = st.st_mtime;
+    struct md5_s md5;
+
+    InitMD5( &md5 );
+    AddMD5( &md5, &i_size, sizeof( i_size ) );
+    AddMD5( &md5, &i_mtime, sizeof( i_mtime ) );
+    AddMD5( &md5, p_peek, i_peek );
+    EndMD5( &md5 );
+
+    char *psz_key = psz_md5_hash( &md5 );
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    bool b_ret = psz_key != NULL && psz_dir != NULL;
+
+    if( b_ret )
+    {
+        path = std::string( psz_dir ) + DIR_SEP "mkv";
+        vlc_mkdir( psz_dir, 0700 );
+        vlc_mkdir( path.c_str(), 0700 );
+        path = path + DIR_SEP + psz_key;
+        key = psz_key;
+    }
+
+    free( psz_dir );
+    free( psz_key );
+    return b_ret;
+}
+
 /*****************************************************************************
  * Open: initializes matroska demux structures
  *****************************************************************************/
@@ -96,6 +153,7 @@ static int Open( vlc_object_t * p_this )
     matroska_segment_c *p_segment;
     const uint8_t      *p_peek;
     std::string         s_path, s_filename;
+    std::string         s_index_path, s_index_key;
     vlc_stream_io_callback *p_io_callback;
     EbmlStream         *p_io_stream;
     bool                b_need_preload = false;
@@ -107,6 +165,8 @@ static int Open( vlc_object_t * p_this )
     if( p_peek[0] != 0x1a || p_peek[1] != 0x45 ||
         p_peek[2] != 0xdf || p_peek[3] != 0xa3 ) return VLC_EGENERIC;
 
+    bool b_seek_index = GetSeekIndex( p_demux, s_index_path, s_index_key );
+
     /* Set the demux function */
     p_demux->pf_demux   = Demux;
     p_demux->pf_control = Control;
@@ -138,6 +198,14 @@ static int Open( vlc_object_t * p_this )
 
     for (size_t i=0; i<p_stream->segments.size(); i++)
     {
+        if( b_seek_index )
+        {
+            char psz_pos[24];
+            snprintf( psz_pos, sizeof(psz_pos), "-%" PRIu64,
+                      p_stream->segments[i]->segment->GetElementPosition() );
+            p_stream->segments[i]->seek_index_path = s_index_path + psz_pos + ".idx";
+            p_stream->segments[i]->seek_index_key  = s_index_key + psz_pos;
+        }
         p_stream->segments[i]->Preload();
         b_need_preload |= p_stream->segments[i]->b_ref_external_segments;
         if ( p_stream->segments[i]->translations.size() &&
@@ -261,6 +329,9 @@ static int Open( vlc_object_t * p_this )
 
     p_sys->InitUi();
 
+    var_Create( p_demux, "demux-sliced-bytes", VLC_VAR_INTEGER );
+    var_Create( p_demux, "demux-copied-bytes", VLC_VAR_INTEGER );
+
     return VLC_SUCCESS;
 
 error:
@@ -283,6 +354,11 @@ static void Close( vlc_object_t *p_this )
             p_segment->ESDestroy();
     }
 
+    msg_Dbg( p_demux, "frames: %" PRIu64 " bytes shared with the stream, "
+             "%" PRIu64 " bytes copied", p_sys->i_sliced_bytes, p_sys->i_copied_bytes );
+    var_Destroy( p_demux, "demux-copied-bytes" );
+    var_Destroy( p_demux, "demux-sliced-bytes" );
+
     delete p_sys;
 }
 
@@ -493,6 +569,41 @@ static int Seek( demux_t *p_demux, mtime_t i_mk_date, double f_percent, virtual_
     return p_vsegment->Seek( *p_demux, i_mk_date, p_vchapter, b_precise ) ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
+/* Frames of the cluster read ahead are referenced instead of copied */
+static block_t *FrameToBlock( matroska_segment_c *p_segment, KaxSimpleBlock *p_simpleblock,
+                              DataBuffer *data )
+{
+    demux_sys_t &sys = p_segment->sys;
+
+    /* A SimpleBlock is read in one go by BlockGet(), right after its header
+     * is parsed: its buffer holds the payload found in the stream at
+     * GetElementPosition() + HeadSize(), and the frames point into it. The
+     * frames of a BlockGroup are copied, the group being read by its parent */
+    if( p_simpleblock != NULL )
+    {
+        vlc_stream_io_callback *p_io = dynamic_cast<vlc_stream_io_callback*>( &p_segment->es.I_O() );
+        const binary *p_data = p_simpleblock->GetBuffer();
+
+        if( p_io != NULL && p_data != NULL && data->Buffer() >= p_data &&
+            data->Buffer() + data->Size() <= p_data + p_simpleblock->GetSize() )
+        {
+            uint64 i_pos = p_simpleblock->GetElementPosition() + p_simpleblock->HeadSize() +
+                           ( data->Buffer() - p_data );
+
+            block_t *p_block = p_io->slice( i_pos, data->Size() );
+            if( p_block != NULL )
+            {
+                assert( !memcmp( p_block->p_buffer, data->Buffer(), data->Size() ) );
+                sys.i_sliced_bytes += data->Size();
+                return p_block;
+            }
+        }
+    }
+
+    sys.i_copied_bytes += data->Size();
+    return MemToBlock( data->Buffer(), data->Size(), 0 );
+}
+
 /* Needed by matroska_segment::Seek() and Seek */
 void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
                   mtime_t i_pts, mtime_t i_duration, bool b_key_picture,
@@ -570,7 +681,7 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         else if( unlikely( track.fmt.i_codec == VLC_CODEC_WAVPACK ) )
             p_block = packetize_wavpack( track, data->Buffer(), data->Size() );
         else
-            p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+            p_block = FrameToBlock( p_segment, simpleblock, data );
 
         if( p_block == NULL )
         {
@@ -724,6 +835,9 @@ static int Demux( demux_t *p_demux)
         }
 
         msg_Warn( p_demux, "cannot get block EOF?" );
+        /* for benchmarks, see test/vlc-demux-bench.c */
+        var_SetInteger( p_demux, "demux-sliced-bytes", p_sys->i_sliced_bytes );
+        var_SetInteger( p_demux, "demux-copied-bytes", p_sys->i_copied_bytes );
         return 0;
     }
 
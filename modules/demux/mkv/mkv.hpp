@@ -112,6 +112,7 @@ enum
 };
 
 #define MKVD_TIMECODESCALE 1000000
+#define MKV_PREFETCH_MAX   (16 * 1024 * 1024) /* largest cluster read at once */
 
 #define MKV_IS_ID( el, C ) ( el != NULL && typeid( *el ) == typeid( C ) )
 #define MKV_CHECKED_PTR_DECL( name, type, src ) type * name = MKV_IS_ID(src, type) ? static_cast<type*>(src) : NULL
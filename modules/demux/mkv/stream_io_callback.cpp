@@ -34,6 +34,22 @@ vlc_stream_io_callback::vlc_stream_io_callback( stream_t *s_, bool b_owner_ )
                        : s( s_), b_owner( b_owner_ )
 {
     mb_eof = false;
+    p_window = NULL;
+    i_window_start = 0;
+    i_window_offset = 0;
+
+    /* reading a whole cluster at once would delay live streams */
+    if( vlc_stream_Control( s, STREAM_CAN_SEEK, &b_can_prefetch ) )
+        b_can_prefetch = false;
+}
+
+void vlc_stream_io_callback::releaseWindow( void )
+{
+    if( p_window != NULL )
+    {
+        block_Release( p_window );
+        p_window = NULL;
+    }
 }
 
 uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
@@ -41,14 +57,76 @@ uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
     if( i_size <= 0 || mb_eof )
         return 0;
 
-    int i_ret = vlc_stream_Read( s, p_buffer, i_size );
-    return i_ret < 0 ? 0 : i_ret;
+    size_t i_done = 0;
+
+    if( p_window != NULL )
+    {
+        i_done = std::min( i_size, p_window->i_buffer - i_window_offset );
+        memcpy( p_buffer, p_window->p_buffer + i_window_offset, i_done );
+        i_window_offset += i_done;
+
+        if( i_done == i_size )
+            return i_done;
+
+        /* the stream continues right after the window */
+        releaseWindow();
+    }
+
+    int i_ret = vlc_stream_Read( s, static_cast<uint8_t *>( p_buffer ) + i_done,
+                                 i_size - i_done );
+    return i_done + ( i_ret < 0 ? 0 : i_ret );
+}
+
+/* Reads the next i_size bytes (typically a whole Cluster) at once, so that
+ * the many small reads done by libebml are served from memory */
+bool vlc_stream_io_callback::prefetch( uint64 i_size )
+{
+    if( !b_can_prefetch || mb_eof || i_size == 0 )
+        return false;
+
+    uint64 i_pos = getFilePointer();
+
+    if( p_window != NULL )
+    {
+        if( i_window_start + p_window->i_buffer >= i_pos + i_size )
+            return true;
+
+        releaseWindow();
+        if( vlc_stream_Seek( s, i_pos ) )
+            return false;
+    }
+
+    block_t *p_block = vlc_stream_Block( s, std::min<uint64>( i_size, MKV_PREFETCH_MAX ) );
+    if( p_block == NULL )
+        return false;
+
+    p_window = block_slice_Alloc( p_block );
+    if( p_window == NULL )
+    {
+        vlc_stream_Seek( s, i_pos );
+        return false;
+    }
+
+    i_window_start  = i_pos;
+    i_window_offset = 0;
+    return true;
+}
+
+/* References data already read from the window, without copying it */
+block_t *vlc_stream_io_callback::slice( uint64 i_pos, size_t i_size )
+{
+    if( p_window == NULL || i_pos < i_window_start ||
+        i_pos - i_window_start > i_window_offset ||
+        i_size > i_window_offset - ( i_pos - i_window_start ) )
+        return NULL;
+
+    return block_Slice( p_window, i_pos - i_window_start, i_size );
 }
 
 void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
 {
     int64_t i_pos, i_size;
-    int64_t i_current = vlc_stream_Tell( s );
+    int64_t i_current = getFilePointer();
 
     switch( mode )
     {
@@ -66,6 +144,20 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
     if(i_pos == i_current)
         return;
 
+    if( p_window != NULL )
+    {
+        /* only skip forward: the data before may have been sliced, and
+         * modified since then */
+        if( i_pos > i_current &&
+            static_cast<uint64>( i_pos ) - i_window_start < p_window->i_buffer )
+        {
+            i_window_offset = i_pos - i_window_start;
+            mb_eof = false;
+            return;
+        }
+        releaseWindow();
+    }
+
     if( i_pos < 0 || ( ( i_size = stream_Size( s ) ) != 0 && i_pos >= i_size ) )
     {
         mb_eof = true;
@@ -84,6 +176,8 @@ uint64 vlc_stream_io_callback::getFilePointer( void )
 {
     if ( s == NULL )
         return 0;
+    if( p_window != NULL )
+        return i_window_start + i_window_offset;
     return vlc_stream_Tell( s );
 }
 
@@ -104,6 +198,6 @@ uint64 vlc_stream_io_callback::toRead( void )
     if( i_size <= 0 )
         return UINT64_MAX;
 
-    return static_cast<uint64>( i_size - vlc_stream_Tell( s ) );
+    return static_cast<uint64>( i_size - getFilePointer() );
 }
 
@@ -32,12 +32,22 @@ class vlc_stream_io_callback: public IOCallback
     stream_t       *s;
     bool           mb_eof;
     bool           b_owner;
+    bool           b_can_prefetch;
+
+    /* data read ahead, the stream is positioned at its end;
+     * it is shared with the blocks sliced from it */
+    block_t        *p_window;
+    uint64         i_window_start;
+    size_t         i_window_offset;
+
+    void           releaseWindow   ( void );
 
   public:
     vlc_stream_io_callback( stream_t *, bool );
 
     virtual ~vlc_stream_io_callback()
     {
+        releaseWindow();
         if( b_owner )
             vlc_stream_Delete( s );
     }
@@ -48,5 +58,6 @@ class vlc_stream_io_callback: public IOCallback
     virtual uint64   getFilePointer  ( void );
     virtual void     close           ( void ) { return; }
     uint64           toRead          ( void );
+    bool             prefetch        ( uint64 i_size );
+    block_t *        slice           ( uint64 i_pos, size_t i_size );
 };
-
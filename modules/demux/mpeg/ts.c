@@ -35,6 +35,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_modules.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -46,6 +47,8 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_workers.h"
+#include "ts_sync.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -111,6 +114,11 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define THREADS_TEXT N_("PES worker threads")
+#define THREADS_LONGTEXT N_("Number of threads reassembling the elementary " \
+    "streams packets, for high bitrate multiplexes with many programs. " \
+    "0 to do everything on the input thread.")
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -148,6 +156,7 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer_with_range( "ts-threads", 0, 0, 16, THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -176,11 +185,16 @@ static inline int PIDGet( block_t *p )
 static mtime_t GetPCR( const block_t * );
 
 static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int * );
-static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t );
+static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t, ts_worker_t * );
+static void GatherPESWork( demux_t *, ts_worker_t *, ts_pid_t *, block_t *, size_t );
+static void CommitWork( demux_t *, ts_work_event_t * );
 static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static uint64_t TsTell( demux_sys_t * );
+static int TsSeek( demux_sys_t *, uint64_t );
+static void TsFlushReadAhead( demux_sys_t * );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
@@ -192,6 +206,13 @@ static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
 
+/* how many TS packet we read at once when using worker threads,
+ * so that the synchronization cost stays low */
+#define TS_THREADED_READ 500
+
+/* how many TS packets we pull from the stream at once */
+#define TS_READ_AHEAD 64
+
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
     const uint8_t *p_peek;
@@ -510,6 +531,22 @@ static int Open( vlc_object_t *p_this )
     vlc_stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK,
                         &p_sys->b_canfastseek );
 
+    /* The ARIB descrambler can be inserted in front of the stream when the
+     * first PMT is parsed. Without seek, the data read ahead could then not
+     * be given back to it (see TsRewindReadAhead()). */
+    p_sys->readahead.b_held = !p_sys->b_canseek &&
+        ( p_sys->standard == TS_STANDARD_AUTO ||
+          p_sys->standard == TS_STANDARD_ARIB ) &&
+        module_exists( "aribcam" );
+
+    int i_threads = var_InheritInteger( p_demux, "ts-threads" );
+    if( i_threads > 0 )
+    {
+        p_sys->p_workers = ts_workers_New( p_demux, i_threads, GatherPESWork, CommitWork );
+        if( p_sys->p_workers )
+            p_sys->i_ts_read = TS_THREADED_READ;
+    }
+
     /* Preparse time */
     if( p_sys->b_canseek )
     {
@@ -522,6 +559,9 @@ static int Open( vlc_object_t *p_this )
     else
         p_sys->es_creation = ( p_sys->b_access_control ? CREATE_ES : DELAY_ES );
 
+    var_Create( p_demux, "demux-sliced-bytes", VLC_VAR_INTEGER );
+    var_Create( p_demux, "demux-copied-bytes", VLC_VAR_INTEGER );
+
     return VLC_SUCCESS;
 }
 
@@ -539,6 +579,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->p_workers )
+        ts_workers_Delete( p_sys->p_workers );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     vlc_mutex_lock( &p_sys->csa_lock );
@@ -571,6 +614,14 @@ static void Close( vlc_object_t *p_this )
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
+    if( p_sys->readahead.p_block )
+        block_Release( p_sys->readahead.p_block );
+
+    msg_Dbg( p_demux, "PES: %" PRIu64 " bytes shared with the stream, "
+             "%" PRIu64 " bytes copied", p_sys->i_pes_sliced_bytes,
+             p_sys->i_pes_copied_bytes );
+    var_Destroy( p_demux, "demux-copied-bytes" );
+    var_Destroy( p_demux, "demux-sliced-bytes" );
     free( p_sys );
 }
 
@@ -619,6 +670,13 @@ static int Demux( demux_t *p_demux )
         block_t     *p_pkt;
         if( !(p_pkt = ReadTSPacket( p_demux )) )
         {
+            if( p_sys->p_workers )
+                ts_workers_Sync( p_sys->p_workers );
+            /* for benchmarks, see test/vlc-demux-bench.c */
+            var_SetInteger( p_demux, "demux-sliced-bytes",
+                            p_sys->i_pes_sliced_bytes );
+            var_SetInteger( p_demux, "demux-copied-bytes",
+                            p_sys->i_pes_copied_bytes );
             return VLC_DEMUXER_EOF;
         }
 
@@ -654,7 +712,12 @@ static int Demux( demux_t *p_demux )
                 msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
             p_pid->i_flags |= FLAG_SEEN;
             if( p_pid->i_pid == 0x01 )
+            {
+                /* also read by the workers */
+                if( p_sys->p_workers )
+                    ts_workers_Sync( p_sys->p_workers );
                 p_sys->b_valid_scrambling = true;
+            }
         }
 
         /* Drop duplicates and invalid (DOES NOT drop corrupted) */
@@ -664,13 +727,21 @@ static int Demux( demux_t *p_demux )
 
         if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
         {
+            if( p_sys->p_workers )
+                ts_workers_Sync( p_sys->p_workers );
             UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
         }
 
         /* Adaptation field cannot be scrambled */
         mtime_t i_pcr = GetPCR( p_pkt );
         if( i_pcr > VLC_TS_INVALID )
-            PCRHandle( p_demux, p_pid, i_pcr );
+        {
+            /* The PES of the previous packets are still being reassembled */
+            if( p_sys->p_workers )
+                ts_workers_PushPCR( p_sys->p_workers, p_pid, i_pcr );
+            else
+                PCRHandle( p_demux, p_pid, i_pcr );
+        }
 
         /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
         if( !SEEN( GetPID( p_sys, 0 ) ) &&
@@ -696,6 +767,8 @@ static int Demux( demux_t *p_demux )
 
             if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
             {
+                if( p_sys->p_workers )
+                    ts_workers_Sync( p_sys->p_workers );
                 msg_Dbg( p_demux, "Creating delayed ES" );
                 AddAndCreateES( p_demux, p_pid, true );
                 UpdatePESFilters( p_demux, p_sys->b_es_all );
@@ -711,10 +784,16 @@ static int Demux( demux_t *p_demux )
 
             if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
             {
-                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
+                if( p_sys->p_workers )
+                    ts_workers_Push( p_sys->p_workers, p_pid, p_pkt, i_header );
+                else
+                    b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header, NULL );
             }
             else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
             {
+                /* Sections handlers can update the descriptors the workers use */
+                if( p_sys->p_workers )
+                    ts_workers_Sync( p_sys->p_workers );
                 b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
             }
             else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
@@ -747,6 +826,9 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    if( p_sys->p_workers )
+        ts_workers_Sync( p_sys->p_workers );
+
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -925,7 +1007,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TsTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -972,7 +1054,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TsSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1104,9 +1186,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        TsFlushReadAhead( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        TsFlushReadAhead( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1420,7 +1504,10 @@ static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
 /****************************************************************************
  * gathering stuff
  ****************************************************************************/
-static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
+/* Parses and strips the PES header, then gathers the payload.
+ * Only reads the pid stream setup, so that it can run on the workers. */
+static block_t * ParsePESHeaderChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes,
+                                      ts_pes_info_t *p_info )
 {
     uint8_t header[34];
     unsigned i_pes_size = 0;
@@ -1438,7 +1525,7 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
     if ( i_max < 4 )
     {
         block_ChainRelease( p_pes );
-        return;
+        return NULL;
     }
 
     if( header[0] != 0 || header[1] != 0 || header[2] != 1 )
@@ -1447,7 +1534,7 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
             msg_Warn( p_demux, "invalid header [0x%02x:%02x:%02x:%02x] (pid: %d)",
                         header[0], header[1],header[2],header[3], pid->i_pid );
         block_ChainRelease( p_pes );
-        return;
+        return NULL;
     }
     else
     {
@@ -1461,14 +1548,10 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                         &i_dts, &i_pts, &i_stream_id, &b_pes_scrambling ) == VLC_EGENERIC )
     {
         block_ChainRelease( p_pes );
-        return;
+        return NULL;
     }
     else
     {
-        if( i_pts != -1 && p_es->p_program )
-            i_pts = TimeStampWrapAround( p_es->p_program->pcr.i_first, i_pts );
-        if( i_dts != -1 && p_es->p_program )
-            i_dts = TimeStampWrapAround( p_es->p_program->pcr.i_first, i_dts );
         if( b_pes_scrambling )
             p_pes->i_flags |= BLOCK_FLAG_SCRAMBLED;
     }
@@ -1526,124 +1609,163 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
         }
     }
 
+    if( !p_pes )
+    {
+        msg_Warn( p_demux, "empty pes" );
+        return NULL;
+    }
+
+    p_info->i_dts = i_dts;
+    p_info->i_pts = i_pts;
+    p_info->i_length = i_length;
+    p_info->i_size = i_pes_size;
+    p_info->i_stream_id = i_stream_id;
+    p_info->b_gathered = p_pes->p_next != NULL;
+
+    return block_ChainGather( p_pes );
+}
+
+static void SendPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes,
+                         const ts_pes_info_t *p_info )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_es_t *p_es = pid->u.p_stream->p_es;
+    ts_pmt_t *p_pmt = p_es->p_program;
+    const unsigned i_pes_size = p_info->i_size;
+    const uint8_t i_stream_id = p_info->i_stream_id;
+    mtime_t i_dts = p_info->i_dts;
+    mtime_t i_pts = p_info->i_pts;
+
+    if( p_info->b_gathered )
+        p_sys->i_pes_copied_bytes += p_pes->i_buffer;
+    else
+        p_sys->i_pes_sliced_bytes += p_pes->i_buffer;
+
+    if( unlikely(!p_pmt) )
+    {
+        block_ChainRelease( p_pes );
+        return;
+    }
+
+    if( i_pts != -1 )
+        i_pts = TimeStampWrapAround( p_pmt->pcr.i_first, i_pts );
+    if( i_dts != -1 )
+        i_dts = TimeStampWrapAround( p_pmt->pcr.i_first, i_dts );
+
     /* ISO/IEC 13818-1 2.7.5: if no pts and no dts, then dts == pts */
     if( i_pts >= 0 && i_dts < 0 )
         i_dts = i_pts;
 
-    if( p_pes )
-    {
-        ts_pmt_t *p_pmt = p_es->p_program;
-        if( unlikely(!p_pmt) )
-        {
-            block_ChainRelease( p_pes );
-            return;
-        }
-
-        if( i_dts >= 0 )
-            p_pes->i_dts = FROM_SCALE(i_dts);
+    if( i_dts >= 0 )
+        p_pes->i_dts = FROM_SCALE(i_dts);
 
-        if( i_pts >= 0 )
-            p_pes->i_pts = FROM_SCALE(i_pts);
+    if( i_pts >= 0 )
+        p_pes->i_pts = FROM_SCALE(i_pts);
 
-        p_pes->i_length = FROM_SCALE_NZ(i_length);
+    p_pes->i_length = FROM_SCALE_NZ(p_info->i_length);
 
-        /* Can become a chain on next call due to prepcr */
-        block_t *p_chain = block_ChainGather( p_pes );
-        while ( p_chain ) {
-            block_t *p_block = p_chain;
-            p_chain = p_chain->p_next;
-            p_block->p_next = NULL;
+    /* Can become a chain on next call due to prepcr */
+    block_t *p_chain = p_pes;
+    while ( p_chain ) {
+        block_t *p_block = p_chain;
+        p_chain = p_chain->p_next;
+        p_block->p_next = NULL;
 
-            if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
-                PCRFixHandle( p_demux, p_pmt, p_block );
+        if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
+            PCRFixHandle( p_demux, p_pmt, p_block );
 
-            if( p_es->id && (p_pmt->pcr.i_current > -1 || p_pmt->pcr.b_disable) )
+        if( p_es->id && (p_pmt->pcr.i_current > -1 || p_pmt->pcr.b_disable) )
+        {
+            if( pid->u.p_stream->prepcr.p_head )
             {
-                if( pid->u.p_stream->prepcr.p_head )
-                {
-                    /* Rebuild current output chain, appending any prepcr outqueue */
-                    block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_block );
-                    if( p_chain )
-                        block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_chain );
-                    p_chain = pid->u.p_stream->prepcr.p_head;
-                    pid->u.p_stream->prepcr.p_head = NULL;
-                    pid->u.p_stream->prepcr.pp_last = &pid->u.p_stream->prepcr.p_head;
-                    /* Then now output all data */
-                    continue;
-                }
-
-                if ( p_pmt->pcr.b_disable && p_block->i_dts > VLC_TS_INVALID &&
-                     ( p_pmt->i_pid_pcr == pid->i_pid || p_pmt->i_pid_pcr == 0x1FFF ) )
-                {
-                    ProgramSetPCR( p_demux, p_pmt, TO_SCALE(p_block->i_dts) - 120000 );
-                }
+                /* Rebuild current output chain, appending any prepcr outqueue */
+                block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_block );
+                if( p_chain )
+                    block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_chain );
+                p_chain = pid->u.p_stream->prepcr.p_head;
+                pid->u.p_stream->prepcr.p_head = NULL;
+                pid->u.p_stream->prepcr.pp_last = &pid->u.p_stream->prepcr.p_head;
+                /* Then now output all data */
+                continue;
+            }
 
-                /* Compute PCR/DTS offset if any */
-                if( p_pmt->pcr.i_pcroffset == -1 && p_block->i_dts > VLC_TS_INVALID &&
-                    p_pmt->pcr.i_current > VLC_TS_INVALID &&
-                   (p_es->fmt.i_cat == VIDEO_ES || p_es->fmt.i_cat == AUDIO_ES) )
-                {
-                    int64_t i_dts27 = TO_SCALE(p_block->i_dts);
-                    i_dts27 = TimeStampWrapAround( p_pmt->pcr.i_first, i_dts27 );
-                    int64_t i_pcr = TimeStampWrapAround( p_pmt->pcr.i_first, p_pmt->pcr.i_current );
-                    if( i_dts27 < i_pcr )
-                    {
-                        p_pmt->pcr.i_pcroffset = i_pcr - i_dts27 + 80000;
-                        msg_Warn( p_demux, "Broken stream: pid %d sends packets with dts %"PRId64
-                                           "us later than pcr, applying delay",
-                                  pid->i_pid, FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset) );
-                    }
-                    else p_pmt->pcr.i_pcroffset = 0;
-                }
+            if ( p_pmt->pcr.b_disable && p_block->i_dts > VLC_TS_INVALID &&
+                 ( p_pmt->i_pid_pcr == pid->i_pid || p_pmt->i_pid_pcr == 0x1FFF ) )
+            {
+                ProgramSetPCR( p_demux, p_pmt, TO_SCALE(p_block->i_dts) - 120000 );
+            }
 
-                if( p_pmt->pcr.i_pcroffset != -1 )
+            /* Compute PCR/DTS offset if any */
+            if( p_pmt->pcr.i_pcroffset == -1 && p_block->i_dts > VLC_TS_INVALID &&
+                p_pmt->pcr.i_current > VLC_TS_INVALID &&
+               (p_es->fmt.i_cat == VIDEO_ES || p_es->fmt.i_cat == AUDIO_ES) )
+            {
+                int64_t i_dts27 = TO_SCALE(p_block->i_dts);
+                i_dts27 = TimeStampWrapAround( p_pmt->pcr.i_first, i_dts27 );
+                int64_t i_pcr = TimeStampWrapAround( p_pmt->pcr.i_first, p_pmt->pcr.i_current );
+                if( i_dts27 < i_pcr )
                 {
-                    if( p_block->i_dts > VLC_TS_INVALID )
-                        p_block->i_dts += FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset);
-                    if( p_block->i_pts > VLC_TS_INVALID )
-                        p_block->i_pts += FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset);
+                    p_pmt->pcr.i_pcroffset = i_pcr - i_dts27 + 80000;
+                    msg_Warn( p_demux, "Broken stream: pid %d sends packets with dts %"PRId64
+                                       "us later than pcr, applying delay",
+                              pid->i_pid, FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset) );
                 }
+                else p_pmt->pcr.i_pcroffset = 0;
+            }
 
-                /*** From here, block can become a chain again though conversion below ***/
+            if( p_pmt->pcr.i_pcroffset != -1 )
+            {
+                if( p_block->i_dts > VLC_TS_INVALID )
+                    p_block->i_dts += FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset);
+                if( p_block->i_pts > VLC_TS_INVALID )
+                    p_block->i_pts += FROM_SCALE_NZ(p_pmt->pcr.i_pcroffset);
+            }
 
-                if( pid->u.p_stream->p_proc )
-                {
-                    if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
-                        ts_stream_processor_Reset( pid->u.p_stream->p_proc );
-                    p_block = ts_stream_processor_Push( pid->u.p_stream->p_proc, i_stream_id, p_block );
-                }
-                else
-                /* Some codecs might need xform or AU splitting */
-                {
-                    p_block = ConvertPESBlock( p_demux, p_es, i_pes_size, i_stream_id, p_block );
-                }
+            /*** From here, block can become a chain again though conversion below ***/
 
-                SendDataChain( p_demux, p_es, p_block );
+            if( pid->u.p_stream->p_proc )
+            {
+                if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+                    ts_stream_processor_Reset( pid->u.p_stream->p_proc );
+                p_block = ts_stream_processor_Push( pid->u.p_stream->p_proc, i_stream_id, p_block );
             }
             else
+            /* Some codecs might need xform or AU splitting */
             {
-                if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
-                    PCRFixHandle( p_demux, p_pmt, p_block );
+                p_block = ConvertPESBlock( p_demux, p_es, i_pes_size, i_stream_id, p_block );
+            }
 
-                block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_block );
+            SendDataChain( p_demux, p_es, p_block );
+        }
+        else
+        {
+            if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
+                PCRFixHandle( p_demux, p_pmt, p_block );
 
-                /* PCR Seen and no es->id, cleanup current and prepcr blocks */
-                if( p_pmt->pcr.i_current > -1)
-                {
-                    block_ChainRelease( pid->u.p_stream->prepcr.p_head );
-                    pid->u.p_stream->prepcr.p_head = NULL;
-                    pid->u.p_stream->prepcr.pp_last = &pid->u.p_stream->prepcr.p_head;
-                }
+            block_ChainLastAppend( &pid->u.p_stream->prepcr.pp_last, p_block );
+
+            /* PCR Seen and no es->id, cleanup current and prepcr blocks */
+            if( p_pmt->pcr.i_current > -1)
+            {
+                block_ChainRelease( pid->u.p_stream->prepcr.p_head );
+                pid->u.p_stream->prepcr.p_head = NULL;
+                pid->u.p_stream->prepcr.pp_last = &pid->u.p_stream->prepcr.p_head;
             }
         }
     }
-    else
-    {
-        msg_Warn( p_demux, "empty pes" );
-    }
 }
 
-static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool b_unit_start )
+static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
+{
+    ts_pes_info_t info;
+
+    p_pes = ParsePESHeaderChain( p_demux, pid, p_pes, &info );
+    if( p_pes )
+        SendPESData( p_demux, pid, p_pes, &info );
+}
+
+static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool b_unit_start,
+                          ts_worker_t *p_worker )
 {
     bool b_ret = false;
     ts_stream_t *p_pes = pid->u.p_stream;
@@ -1656,7 +1778,15 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
         p_pes->gather.i_data_size = 0;
         p_pes->gather.i_gathered = 0;
         p_pes->gather.pp_last = &p_pes->gather.p_data;
-        ParsePESDataChain( p_demux, pid, p_datachain );
+        if( p_worker )
+        {
+            /* Output is done by the demux thread, in packets order */
+            ts_work_event_t event = { .type = TS_WORK_PES, .p_pid = pid };
+            event.p_data = ParsePESHeaderChain( p_demux, pid, p_datachain, &event.pes );
+            if( event.p_data )
+                ts_worker_Output( p_worker, &event );
+        }
+        else ParsePESDataChain( p_demux, pid, p_datachain );
         b_ret = true;
     }
 
@@ -1678,85 +1808,178 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     {
         /* re-enter in Flush above */
         assert(p_pes->gather.p_data);
-        return PushPESBlock( p_demux, pid, NULL, true );
+        return PushPESBlock( p_demux, pid, NULL, true, p_worker );
     }
 
     return b_ret;
 }
 
+static uint64_t TsTell( demux_sys_t *p_sys )
+{
+    /* Do not account the data we read ahead */
+    return vlc_stream_Tell( p_sys->stream ) -
+           (p_sys->readahead.i_data - p_sys->readahead.i_offset);
+}
+
+static void TsFlushReadAhead( demux_sys_t *p_sys )
+{
+    /* The packets already sliced may still be in use */
+    if( p_sys->readahead.p_block )
+    {
+        block_Release( p_sys->readahead.p_block );
+        p_sys->readahead.p_block = NULL;
+        p_sys->readahead.p_buffer = NULL;
+    }
+    p_sys->readahead.i_data = 0;
+    p_sys->readahead.i_offset = 0;
+    p_sys->readahead.i_synced = 0;
+}
+
+void TsRewindReadAhead( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->readahead.i_data > p_sys->readahead.i_offset )
+    {
+        const uint64_t i_pos = TsTell( p_sys );
+        if( vlc_stream_Seek( p_sys->stream, i_pos ) != VLC_SUCCESS )
+            msg_Warn( p_demux, "cannot rewind to %"PRIu64", %zu bytes lost",
+                      i_pos, p_sys->readahead.i_data - p_sys->readahead.i_offset );
+    }
+    TsFlushReadAhead( p_sys );
+}
+
+static int TsSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    TsFlushReadAhead( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Reads until at least i_min bytes are available, without waiting for more
+ * than what the stream has to offer. Returns the available size. */
+static size_t TsReadAhead( demux_sys_t *p_sys, size_t i_min )
+{
+    size_t i_avail = p_sys->readahead.i_data - p_sys->readahead.i_offset;
+
+    /* Packets are slices of the read-ahead block: the bytes before the
+     * offset can still be referenced, move the rest into a new block */
+    if( p_sys->readahead.p_block == NULL || p_sys->readahead.i_offset > 0 ||
+        p_sys->readahead.i_size < i_min )
+    {
+        /* While held, only what is requested is read: don't allocate more */
+        const size_t i_size = p_sys->readahead.b_held
+                            ? __MAX( i_min, i_avail )
+                            : p_sys->i_packet_size * TS_READ_AHEAD;
+        block_t *p_block = block_Alloc( i_size );
+        if( p_block )
+            p_block = block_slice_Alloc( p_block );
+        if( unlikely(p_block == NULL) )
+            return 0;
+
+        if( i_avail > 0 )
+            memcpy( p_block->p_buffer,
+                    &p_sys->readahead.p_buffer[p_sys->readahead.i_offset], i_avail );
+        if( p_sys->readahead.p_block )
+            block_Release( p_sys->readahead.p_block );
+
+        p_sys->readahead.p_block = p_block;
+        p_sys->readahead.p_buffer = p_block->p_buffer;
+        p_sys->readahead.i_size = i_size;
+        p_sys->readahead.i_data = i_avail;
+        p_sys->readahead.i_offset = 0;
+    }
+
+    uint8_t *p_buffer = p_sys->readahead.p_buffer;
+
+    size_t i_max = p_sys->readahead.b_held ? i_min : p_sys->readahead.i_size;
+
+    while( i_avail < i_min )
+    {
+        ssize_t i_ret = vlc_stream_ReadPartial( p_sys->stream, &p_buffer[i_avail],
+                                                i_max - i_avail );
+        if( i_ret <= 0 )
+            break;
+        i_avail += i_ret;
+    }
+    p_sys->readahead.i_data = i_avail;
+
+    /* Validate all the sync bytes at once */
+    p_sys->readahead.i_synced =
+        ts_sync_Count( &p_buffer[p_sys->i_packet_header_size],
+                       i_avail / p_sys->i_packet_size, p_sys->i_packet_size );
+
+    return i_avail;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_packet_size = p_sys->i_packet_size;
 
     block_t     *p_pkt;
 
-    /* Get a new TS packet */
-    if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+    /* Get new TS packets */
+    if( p_sys->readahead.i_synced == 0 &&
+        TsReadAhead( p_sys, i_packet_size ) < i_packet_size )
     {
         int64_t size = stream_Size( p_sys->stream );
         if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+            msg_Dbg( p_demux, "EOF at %"PRIu64, TsTell( p_sys ) );
         else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
-        return NULL;
-    }
-
-    if( p_pkt->i_buffer < TS_HEADER_SIZE + p_sys->i_packet_header_size )
-    {
-        block_Release( p_pkt );
+            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, TsTell( p_sys ) );
+        TsFlushReadAhead( p_sys );
         return NULL;
     }
 
-    /* Skip header (BluRay streams).
-     * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
-     * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
-     */
-    p_pkt->p_buffer += p_sys->i_packet_header_size;
-    p_pkt->i_buffer -= p_sys->i_packet_header_size;
-
     /* Check sync byte and re-sync if needed */
-    if( p_pkt->p_buffer[0] != 0x47 )
+    if( p_sys->readahead.i_synced == 0 )
     {
         msg_Warn( p_demux, "lost synchro" );
-        block_Release( p_pkt );
+        /* Drop the packet */
+        p_sys->readahead.i_offset += i_packet_size;
         for( ;; )
         {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
-
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+            size_t i_peek = TsReadAhead( p_sys, i_packet_size * 10 );
+            if( i_peek < p_sys->i_packet_header_size + i_packet_size + 1 )
             {
                 msg_Dbg( p_demux, "eof ?" );
+                TsFlushReadAhead( p_sys );
                 return NULL;
             }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
-            }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
+            const size_t i_max = i_peek - p_sys->i_packet_header_size - i_packet_size;
+            size_t i_skip = ts_sync_Find( &p_sys->readahead.p_buffer[p_sys->i_packet_header_size],
+                                          i_max, i_packet_size );
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+            p_sys->readahead.i_offset += i_skip;
 
-            if( i_skip < i_peek - p_sys->i_packet_size )
-            {
+            if( i_skip < i_max )
                 break;
-            }
         }
-        if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+
+        if( TsReadAhead( p_sys, i_packet_size ) < i_packet_size )
         {
             msg_Dbg( p_demux, "eof ?" );
+            TsFlushReadAhead( p_sys );
             return NULL;
         }
     }
+
+    p_pkt = block_Slice( p_sys->readahead.p_block, p_sys->readahead.i_offset,
+                         i_packet_size );
+    if( !p_pkt )
+        return NULL;
+    p_sys->readahead.i_offset += i_packet_size;
+    assert( p_sys->readahead.i_synced > 0 );
+    p_sys->readahead.i_synced--;
+
+    /* Skip header (BluRay streams).
+     * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
+     * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
+     */
+    p_pkt->p_buffer += p_sys->i_packet_header_size;
+    p_pkt->i_buffer -= p_sys->i_packet_header_size;
+
     return p_pkt;
 }
 
@@ -1866,13 +2089,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TsSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1888,7 +2111,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TsSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1902,7 +2125,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TsTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1957,7 +2180,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TsSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2040,7 +2263,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TsTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2068,7 +2291,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2081,7 +2304,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TsSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2090,7 +2313,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (2 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TsSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2099,7 +2322,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2112,7 +2335,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TsSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2121,7 +2344,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (6 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TsSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2172,10 +2395,10 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TsTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             p_pmt->i_last_dts = i_pcr;
-            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+            p_pmt->i_last_dts_byte = TsTell( p_sys );
         }
     }
 }
@@ -2259,7 +2482,7 @@ static void PCRCheckDTS( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr)
             {
                 msg_Warn( p_demux, "send queued data for pid %d: TS %"PRId64" <= PCR %"PRId64"\n",
                           p_pid->i_pid, i_dts > VLC_TS_INVALID ? i_dts : i_pts, i_pcr);
-                PushPESBlock( p_demux, p_pid, NULL, true ); /* Flush */
+                PushPESBlock( p_demux, p_pid, NULL, true, NULL ); /* Flush */
             }
         }
     }
@@ -2299,8 +2522,11 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
             /* Can be dedicated PCR pid (no owned then) or another pid (owner == pmt) */
             if( p_pmt->i_pid_pcr == pid->i_pid ) /* If that program references current pid as PCR */
             {
-                /* We've found a target group for update */
-                PCRCheckDTS( p_demux, p_pmt, i_pcr );
+                /* We've found a target group for update. With the workers,
+                 * the gathering state is not in sync with the PCR and PES
+                 * without length are only output on next unit start */
+                if( !p_sys->p_workers )
+                    PCRCheckDTS( p_demux, p_pmt, i_pcr );
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
             }
         }
@@ -2569,7 +2795,8 @@ static bool MayHaveStartCodeOnEnd( const uint8_t *p_buf, size_t i_buf )
     return !( *(--p_buf) > 1 || *(--p_buf) > 0 || *(--p_buf) > 0 );
 }
 
-static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size_t i_skip )
+static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size_t i_skip,
+                           ts_worker_t *p_worker )
 {
     const bool b_unit_start = p_pkt->p_buffer[1]&0x40;
     bool b_ret = false;
@@ -2595,7 +2822,7 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
     if( (p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) && p_demux->p_sys->b_valid_scrambling )
     {
         block_Release( p_pkt );
-        return PushPESBlock( p_demux, pid, NULL, true );
+        return PushPESBlock( p_demux, pid, NULL, true, p_worker );
     }
 
     /* Data discontinuity, we need to drop or output currently
@@ -2605,9 +2832,14 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
     {
         p_pes->gather.i_saved = 0;
         /* Flush/output current */
-        b_ret |= PushPESBlock( p_demux, pid, NULL, true );
+        b_ret |= PushPESBlock( p_demux, pid, NULL, true, p_worker );
         /* Propagate to output block to notify packetizers/decoders */
-        if( p_pes->p_es )
+        if( p_worker )
+        {
+            const ts_work_event_t event = { .type = TS_WORK_DISCONTINUITY, .p_pid = pid };
+            ts_worker_Output( p_worker, &event );
+        }
+        else if( p_pes->p_es )
             p_pes->p_es->i_next_block_flags |= BLOCK_FLAG_DISCONTINUITY;
     }
 
@@ -2676,7 +2908,7 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
                 /* Append whole block */
                 if( likely(p_pkt->i_buffer <= i_remain || b_single_payload) )
                 {
-                    b_ret |= PushPESBlock( p_demux, pid, p_pkt, p_pes->gather.p_data == NULL );
+                    b_ret |= PushPESBlock( p_demux, pid, p_pkt, p_pes->gather.p_data == NULL, p_worker );
                     p_pkt = NULL;
                 }
                 else /* p_pkt->i_buffer > i_remain */
@@ -2687,7 +2919,7 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
                         block_Release( p_pkt );
                         return false;
                     }
-                    b_ret |= PushPESBlock( p_demux, pid, p_pkt, p_pes->gather.p_data == NULL );
+                    b_ret |= PushPESBlock( p_demux, pid, p_pkt, p_pes->gather.p_data == NULL, p_worker );
                     p_pkt = p_split;
                     b_first_sync_done = false;
                 }
@@ -2695,7 +2927,7 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
             else /* if( p_pes->gather.i_data_size == 0 ) // see next packet */
             {
                 /* Append or finish current/start new PES depending on unit_start */
-                b_ret |= PushPESBlock( p_demux, pid, p_pkt, b_unit_start );
+                b_ret |= PushPESBlock( p_demux, pid, p_pkt, b_unit_start, p_worker );
                 p_pkt = NULL;
             }
         }
@@ -2715,6 +2947,41 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, size
     return b_ret;
 }
 
+static void GatherPESWork( demux_t *p_demux, ts_worker_t *p_worker,
+                           ts_pid_t *pid, block_t *p_pkt, size_t i_skip )
+{
+    GatherPESData( p_demux, pid, p_pkt, i_skip, p_worker );
+}
+
+static void CommitWork( demux_t *p_demux, ts_work_event_t *p_event )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_pid_t *pid = p_event->p_pid;
+
+    switch( p_event->type )
+    {
+    case TS_WORK_PCR:
+        PCRHandle( p_demux, pid, p_event->i_pcr );
+        break;
+
+    case TS_WORK_PES:
+        /* pid can have been unselected since */
+        if( pid->type != TYPE_STREAM ||
+            (!p_sys->b_access_control && !(pid->i_flags & FLAG_FILTERED)) )
+        {
+            block_ChainRelease( p_event->p_data );
+            break;
+        }
+        SendPESData( p_demux, pid, p_event->p_data, &p_event->pes );
+        break;
+
+    case TS_WORK_DISCONTINUITY:
+        if( pid->type == TYPE_STREAM && pid->u.p_stream->p_es )
+            pid->u.p_stream->p_es->i_next_block_flags |= BLOCK_FLAG_DISCONTINUITY;
+        break;
+    }
+}
+
 static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
 {
     VLC_UNUSED(i_skip); VLC_UNUSED(p_demux);
@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_workers_t ts_workers_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -60,6 +61,25 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* TS packets read from the stream but not yet demuxed */
+    struct
+    {
+        block_t *p_block;   /* shared with the packets sliced from it */
+        uint8_t *p_buffer;
+        size_t   i_size;
+        size_t   i_data;
+        size_t   i_offset;  /* of the next packet */
+        size_t   i_synced;  /* packets with a valid sync byte from i_offset */
+        bool     b_held;    /* don't read past the requested data */
+    } readahead;
+
+    /* PES payload sliced from the read-ahead buffer or copied, for statistics */
+    uint64_t    i_pes_sliced_bytes;
+    uint64_t    i_pes_copied_bytes;
+
+    /* PES reassembly threads, if any */
+    ts_workers_t *p_workers;
+
     bool        b_ignore_time_for_positions;
 
     ts_standards_e standard;
@@ -128,6 +148,7 @@ struct demux_sys_t
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
+void TsRewindReadAhead( demux_t * );
 
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
@@ -53,6 +53,7 @@
 #include "ts_psip.h"
 #include "ts_si.h"
 #include "ts_metadata.h"
+#include "ts_workers.h"
 
 #include "../access/dtv/en50221_capmt.h"
 
@@ -108,6 +109,10 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
         return;
     }
 
+    /* Programs and pids are going to change */
+    if( p_sys->p_workers )
+        ts_workers_Sync( p_sys->p_workers );
+
     msg_Dbg( p_demux, "new PAT ts_id=%d version=%d current_next=%d",
              p_dvbpsipat->i_ts_id, p_dvbpsipat->i_version, p_dvbpsipat->b_current_next );
 
@@ -1628,6 +1633,10 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
         return;
     }
 
+    /* Streams are going to change */
+    if( p_sys->p_workers )
+        ts_workers_Sync( p_sys->p_workers );
+
     /* Save old es array */
     DECL_ARRAY(ts_pid_t *) pid_to_decref;
     pid_to_decref.i_alloc = p_pmt->e_streams.i_alloc;
@@ -1848,11 +1857,15 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                 en50221_capmt_Delete( p_en );
                 if ( p_sys->standard == TS_STANDARD_ARIB && !p_sys->arib.b25stream )
                 {
+                    /* The packets read ahead must go through the descrambler */
+                    TsRewindReadAhead( p_demux );
                     p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
                     p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
                 }
             }
         }
+        /* The descrambler is decided: read ahead freely from now on */
+        p_sys->readahead.b_held = false;
     }
 
      /* Add arbitrary PID from here */
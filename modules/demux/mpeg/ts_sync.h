@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * ts_sync.h: MPEG-TS sync byte scanning helpers
+ *****************************************************************************
+ * Copyright (C) 2017 VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_SYNC_H_
+#define VLC_TS_SYNC_H_
+
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+   #include <emmintrin.h>
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+   #include <immintrin.h>
+#endif
+
+#define TS_SYNC_BYTE 0x47
+
+#if defined(HAVE_AVX2_INTRINSICS)
+
+__attribute__ ((__target__ ("avx2")))
+static inline size_t ts_sync_Count_AVX2( const uint8_t *p, size_t i_count, size_t i_stride )
+{
+    /* Gathers the headers of 8 packets at once */
+    const __m256i index = _mm256_mullo_epi32( _mm256_set1_epi32( i_stride ),
+                                              _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+    const __m256i mask = _mm256_set1_epi32( 0xFF );
+    const __m256i sync = _mm256_set1_epi32( TS_SYNC_BYTE );
+    size_t i = 0;
+
+    for( ; i + 8 <= i_count; i += 8, p += 8 * i_stride )
+    {
+        __m256i v = _mm256_i32gather_epi32( (const int *)p, index, 1 );
+        v = _mm256_cmpeq_epi32( _mm256_and_si256( v, mask ), sync );
+        unsigned match = _mm256_movemask_ps( _mm256_castsi256_ps( v ) );
+        if( match != 0xFF )
+            return i + ctz( ~match );
+    }
+
+    for( ; i < i_count; i++, p += i_stride )
+    {
+        if( *p != TS_SYNC_BYTE )
+            break;
+    }
+    return i;
+}
+
+#endif
+
+#if defined(HAVE_SSE2_INTRINSICS)
+
+__attribute__ ((__target__ ("sse2")))
+static inline size_t ts_sync_Find_SSE2( const uint8_t *p, size_t i_len, size_t i_stride )
+{
+    /* Tests 16 candidates positions at once */
+    const __m128i sync = _mm_set1_epi8( TS_SYNC_BYTE );
+    size_t i = 0;
+
+    for( ; i + 16 <= i_len; i += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&p[i] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&p[i + i_stride] );
+        a = _mm_and_si128( _mm_cmpeq_epi8( a, sync ), _mm_cmpeq_epi8( b, sync ) );
+        unsigned match = _mm_movemask_epi8( a );
+        if( match )
+            return i + ctz( match );
+    }
+
+    for( ; i < i_len; i++ )
+    {
+        if( p[i] == TS_SYNC_BYTE && p[i + i_stride] == TS_SYNC_BYTE )
+            break;
+    }
+    return i;
+}
+
+#endif
+
+/* Returns the number of consecutive packets, starting at p and spaced by
+ * i_stride bytes, having a valid sync byte. */
+static inline size_t ts_sync_Count( const uint8_t *p, size_t i_count, size_t i_stride )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        return ts_sync_Count_AVX2( p, i_count, i_stride );
+#endif
+    size_t i = 0;
+    for( ; i < i_count; i++, p += i_stride )
+    {
+        if( *p != TS_SYNC_BYTE )
+            break;
+    }
+    return i;
+}
+
+/* Returns the offset of the first sync byte, within the i_len first bytes,
+ * which is followed by another one i_stride bytes later, or i_len if none.
+ * i_len + i_stride bytes must be readable. */
+static inline size_t ts_sync_Find( const uint8_t *p, size_t i_len, size_t i_stride )
+{
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        return ts_sync_Find_SSE2( p, i_len, i_stride );
+#endif
+    for( const uint8_t *p_end = &p[i_len], *p_cur = p; ; p_cur++ )
+    {
+        p_cur = memchr( p_cur, TS_SYNC_BYTE, p_end - p_cur );
+        if( p_cur == NULL )
+            return i_len;
+        if( p_cur[i_stride] == TS_SYNC_BYTE )
+            return p_cur - p;
+    }
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*****************************************************************************
+ * ts_workers.c : TS demuxer PES reassembly worker threads
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+#include <vlc_arrays.h>
+
+#include "ts_pid.h"
+#include "ts_workers.h"
+
+#include <assert.h>
+
+/*
+ * The demux thread keeps reading packets and handling PSI and PCR, while
+ * the packets of the elementary streams are dispatched by pid to the
+ * workers. Each pid always goes to the same worker, which preserves its
+ * ordering.
+ *
+ * Every queued packet gets a sequence number. The results of the workers
+ * and the PCR are tagged with it and merged back in that order by
+ * ts_workers_Sync(), which is called at fixed points of the input, so the
+ * es_out calls never depend on the threads scheduling.
+ */
+
+typedef struct
+{
+    ts_pid_t *p_pid;
+    block_t  *p_pkt;
+    size_t    i_skip;
+    uint64_t  i_seq;
+} ts_work_item_t;
+
+struct ts_worker_t
+{
+    ts_workers_t *p_owner;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;
+    vlc_cond_t    idle;
+    bool          b_busy;
+    bool          b_exit;
+    DECL_ARRAY(ts_work_item_t)  in;   /* queued by the demux thread */
+    DECL_ARRAY(ts_work_item_t)  work; /* being processed */
+    DECL_ARRAY(ts_work_event_t) out;  /* results, read after sync */
+    uint64_t      i_seq;              /* of the packet being processed */
+};
+
+struct ts_workers_t
+{
+    demux_t              *p_demux;
+    ts_workers_gather_cb  pf_gather;
+    ts_workers_commit_cb  pf_commit;
+    unsigned              i_count;
+    ts_worker_t          *p_workers;
+    uint64_t              i_seq;
+    DECL_ARRAY(ts_work_event_t) events; /* from the demux thread */
+};
+
+static void ReleaseEvents( ts_work_event_t *p_events, int i_events )
+{
+    for( int i = 0; i < i_events; i++ )
+        if( p_events[i].p_data )
+            block_ChainRelease( p_events[i].p_data );
+}
+
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    ts_workers_t *p_owner = p_worker->p_owner;
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( p_worker->in.i_size == 0 && !p_worker->b_exit )
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+
+        if( p_worker->b_exit )
+            break;
+
+        /* Swap the queues, so the demux thread can keep pushing */
+        int i_alloc = p_worker->work.i_alloc;
+        ts_work_item_t *p_elems = p_worker->work.p_elems;
+        p_worker->work.i_alloc = p_worker->in.i_alloc;
+        p_worker->work.i_size = p_worker->in.i_size;
+        p_worker->work.p_elems = p_worker->in.p_elems;
+        p_worker->in.i_alloc = i_alloc;
+        p_worker->in.i_size = 0;
+        p_worker->in.p_elems = p_elems;
+        p_worker->b_busy = true;
+        vlc_mutex_unlock( &p_worker->lock );
+
+        for( int i = 0; i < p_worker->work.i_size; i++ )
+        {
+            ts_work_item_t *p_item = &p_worker->work.p_elems[i];
+            p_worker->i_seq = p_item->i_seq;
+            p_owner->pf_gather( p_owner->p_demux, p_worker, p_item->p_pid,
+                                p_item->p_pkt, p_item->i_skip );
+        }
+        p_worker->work.i_size = 0;
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_busy = false;
+        vlc_cond_signal( &p_worker->idle );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+
+    return NULL;
+}
+
+ts_workers_t * ts_workers_New( demux_t *p_demux, unsigned i_count,
+                               ts_workers_gather_cb pf_gather,
+                               ts_workers_commit_cb pf_commit )
+{
+    ts_workers_t *p_workers = malloc( sizeof(*p_workers) );
+    if( !p_workers )
+        return NULL;
+
+    p_workers->p_workers = calloc( i_count, sizeof(ts_worker_t) );
+    if( !p_workers->p_workers )
+    {
+        free( p_workers );
+        return NULL;
+    }
+
+    p_workers->p_demux = p_demux;
+    p_workers->pf_gather = pf_gather;
+    p_workers->pf_commit = pf_commit;
+    p_workers->i_count = 0;
+    p_workers->i_seq = 0;
+    ARRAY_INIT( p_workers->events );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+        p_worker->p_owner = p_workers;
+        vlc_mutex_init( &p_worker->lock );
+        vlc_cond_init( &p_worker->wait );
+        vlc_cond_init( &p_worker->idle );
+        p_worker->b_busy = false;
+        p_worker->b_exit = false;
+        ARRAY_INIT( p_worker->in );
+        ARRAY_INIT( p_worker->work );
+        ARRAY_INIT( p_worker->out );
+        p_worker->i_seq = 0;
+
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+        {
+            vlc_cond_destroy( &p_worker->idle );
+            vlc_cond_destroy( &p_worker->wait );
+            vlc_mutex_destroy( &p_worker->lock );
+            break;
+        }
+        p_workers->i_count++;
+    }
+
+    if( p_workers->i_count == 0 )
+    {
+        free( p_workers->p_workers );
+        free( p_workers );
+        return NULL;
+    }
+
+    msg_Dbg( p_demux, "using %u PES worker thread(s)", p_workers->i_count );
+
+    return p_workers;
+}
+
+void ts_workers_Delete( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_exit = true;
+        vlc_cond_signal( &p_worker->wait );
+        vlc_mutex_unlock( &p_worker->lock );
+        vlc_join( p_worker->thread, NULL );
+
+        for( int j = 0; j < p_worker->in.i_size; j++ )
+            block_Release( p_worker->in.p_elems[j].p_pkt );
+        ReleaseEvents( p_worker->out.p_elems, p_worker->out.i_size );
+        ARRAY_RESET( p_worker->in );
+        ARRAY_RESET( p_worker->work );
+        ARRAY_RESET( p_worker->out );
+
+        vlc_cond_destroy( &p_worker->idle );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+    }
+
+    ReleaseEvents( p_workers->events.p_elems, p_workers->events.i_size );
+    ARRAY_RESET( p_workers->events );
+    free( p_workers->p_workers );
+    free( p_workers );
+}
+
+void ts_workers_Push( ts_workers_t *p_workers, ts_pid_t *p_pid,
+                      block_t *p_pkt, size_t i_skip )
+{
+    ts_worker_t *p_worker = &p_workers->p_workers[p_pid->i_pid % p_workers->i_count];
+    const ts_work_item_t item =
+    {
+        .p_pid = p_pid,
+        .p_pkt = p_pkt,
+        .i_skip = i_skip,
+        .i_seq = p_workers->i_seq++,
+    };
+
+    vlc_mutex_lock( &p_worker->lock );
+    ARRAY_APPEND( p_worker->in, item );
+    if( p_worker->in.i_size == 1 )
+        vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+void ts_workers_PushPCR( ts_workers_t *p_workers, ts_pid_t *p_pid, mtime_t i_pcr )
+{
+    /* Same sequence as the next packet: the PCR applies before its data */
+    const ts_work_event_t event =
+    {
+        .type = TS_WORK_PCR,
+        .i_seq = p_workers->i_seq,
+        .p_pid = p_pid,
+        .p_data = NULL,
+        .i_pcr = i_pcr,
+    };
+    ARRAY_APPEND( p_workers->events, event );
+}
+
+void ts_worker_Output( ts_worker_t *p_worker, const ts_work_event_t *p_event )
+{
+    ts_work_event_t event = *p_event;
+    event.i_seq = p_worker->i_seq;
+    ARRAY_APPEND( p_worker->out, event );
+}
+
+void ts_workers_Sync( ts_workers_t *p_workers )
+{
+    int pi_pos[p_workers->i_count];
+
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        while( p_worker->in.i_size > 0 || p_worker->b_busy )
+            vlc_cond_wait( &p_worker->idle, &p_worker->lock );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        pi_pos[i] = 0;
+    }
+
+    /* Merge by sequence, each queue being already ordered. On equality,
+     * the demux thread events come first as they were seen before the
+     * packet was queued. */
+    int i_events = 0;
+    for( ;; )
+    {
+        ts_work_event_t *p_next = NULL;
+        int *pi_next = &i_events;
+
+        if( i_events < p_workers->events.i_size )
+            p_next = &p_workers->events.p_elems[i_events];
+
+        for( unsigned i = 0; i < p_workers->i_count; i++ )
+        {
+            ts_worker_t *p_worker = &p_workers->p_workers[i];
+            if( pi_pos[i] >= p_worker->out.i_size )
+                continue;
+            ts_work_event_t *p_event = &p_worker->out.p_elems[pi_pos[i]];
+            if( !p_next || p_event->i_seq < p_next->i_seq )
+            {
+                p_next = p_event;
+                pi_next = &pi_pos[i];
+            }
+        }
+
+        if( !p_next )
+            break;
+
+        (*pi_next)++;
+        /* ownership of the data goes to the commit */
+        p_workers->pf_commit( p_workers->p_demux, p_next );
+    }
+
+    p_workers->events.i_size = 0;
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        p_workers->p_workers[i].out.i_size = 0;
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * ts_workers.h : TS demuxer PES reassembly worker threads
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_WORKERS_H
+#define VLC_TS_WORKERS_H
+
+#include "ts_pid_fwd.h"
+
+typedef struct ts_workers_t ts_workers_t;
+typedef struct ts_worker_t ts_worker_t;
+
+typedef enum
+{
+    TS_WORK_PCR,           /* PCR seen by the demux thread */
+    TS_WORK_PES,           /* PES reassembled by a worker */
+    TS_WORK_DISCONTINUITY, /* flag the next block of the pid */
+} ts_work_type_t;
+
+/* Parsed PES header */
+typedef struct
+{
+    mtime_t  i_dts;        /* 90kHz, -1 if none */
+    mtime_t  i_pts;
+    mtime_t  i_length;
+    unsigned i_size;
+    uint8_t  i_stream_id;
+    bool     b_gathered;   /* payload copied from several packets */
+} ts_pes_info_t;
+
+/* Worker results, committed by the demux thread in input packet order */
+typedef struct
+{
+    ts_work_type_t type;
+    uint64_t       i_seq;
+    ts_pid_t      *p_pid;
+    block_t       *p_data;     /* TS_WORK_PES */
+    mtime_t        i_pcr;      /* TS_WORK_PCR */
+    ts_pes_info_t  pes;        /* TS_WORK_PES */
+} ts_work_event_t;
+
+/* Runs on a worker thread, must only touch the pid gathering state */
+typedef void (*ts_workers_gather_cb)( demux_t *, ts_worker_t *,
+                                      ts_pid_t *, block_t *, size_t );
+/* Runs on the demux thread */
+typedef void (*ts_workers_commit_cb)( demux_t *, ts_work_event_t * );
+
+ts_workers_t * ts_workers_New( demux_t *, unsigned i_count,
+                               ts_workers_gather_cb, ts_workers_commit_cb );
+void ts_workers_Delete( ts_workers_t * );
+
+/* Queue a packet to the worker in charge of its pid */
+void ts_workers_Push( ts_workers_t *, ts_pid_t *, block_t *, size_t i_skip );
+/* Queue a PCR, ordered against the reassembled PES */
+void ts_workers_PushPCR( ts_workers_t *, ts_pid_t *, mtime_t i_pcr );
+/* Wait for the queued packets and commit the results in order */
+void ts_workers_Sync( ts_workers_t * );
+
+/* From the gather callback */
+void ts_worker_Output( ts_worker_t *, const ts_work_event_t * );
+
+#endif
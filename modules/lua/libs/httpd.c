@@ -44,6 +44,7 @@
 static uint8_t *vlclua_todata( lua_State *L, int narg, int *i_data );
 
 static int vlclua_httpd_host_delete( lua_State * );
+static int vlclua_httpd_host_stats( lua_State * );
 static int vlclua_httpd_handler_new( lua_State * );
 static int vlclua_httpd_handler_delete( lua_State * );
 static int vlclua_httpd_file_new( lua_State * );
@@ -58,6 +59,7 @@ static const luaL_Reg vlclua_httpd_reg[] = {
     { "handler", vlclua_httpd_handler_new },
     { "file", vlclua_httpd_file_new },
     { "redirect", vlclua_httpd_redirect_new },
+    { "stats", vlclua_httpd_host_stats },
     { NULL, NULL }
 };
 
@@ -109,6 +111,25 @@ static int vlclua_httpd_host_delete( lua_State *L )
     return 0;
 }
 
+static int vlclua_httpd_host_stats( lua_State *L )
+{
+    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
+    httpd_host_stats_t stats;
+
+    httpd_HostGetStats( *pp_host, &stats );
+
+    lua_newtable( L );
+    lua_pushnumber( L, stats.i_connections );
+    lua_setfield( L, -2, "connections" );
+    lua_pushinteger( L, stats.i_clients );
+    lua_setfield( L, -2, "clients" );
+    lua_pushnumber( L, stats.i_bytes_received );
+    lua_setfield( L, -2, "bytes_received" );
+    lua_pushnumber( L, stats.i_bytes_sent );
+    lua_setfield( L, -2, "bytes_sent" );
+    return 1;
+}
+
 /*****************************************************************************
  * HTTPd Handler
  *****************************************************************************/
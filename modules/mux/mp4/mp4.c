@@ -52,6 +52,10 @@
     "Create \"Fast Start\" files. " \
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
+#define FRAGDURATION_TEXT N_("Fragment duration (ms)")
+#define FRAGDURATION_LONGTEXT N_(\
+    "Maximum duration of the fragments. Fragments are cut earlier on key " \
+    "frames. Short fragments lower the latency of live streaming.")
 
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
@@ -81,6 +85,9 @@ add_submodule ()
     add_shortcut("mp4frag", "mp4stream")
     set_capability("sout mux", 0)
     set_callbacks(OpenFrag, CloseFrag)
+    add_integer(SOUT_CFG_PREFIX "fragment-duration", 1500,
+                FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT, true)
+        change_integer_range(100, 60000)
 
 vlc_module_end ()
 
@@ -88,7 +95,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "fragment-duration", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -170,6 +177,7 @@ struct sout_mux_sys_t
     bool           b_fragmented;
     bool           b_header_sent;
     mtime_t        i_written_duration;
+    mtime_t        i_fragment_length;
     uint32_t       i_mfhd_sequence;
 };
 
@@ -787,8 +795,6 @@ static void box_send(sout_mux_t *p_mux,  bo_t *box)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  (CLOCK_FREQ * 3/2)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -1056,13 +1062,11 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
         bo_set_32be(moof, i_fixupoffset, moof->b->i_buffer + 8);
     }
 
-    /* set iframe flag, so the streaming server always starts from moof */
-    moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
-
     return moof;
 }
 
-static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size)
+static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size,
+                              mtime_t i_dts)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
 
@@ -1073,6 +1077,7 @@ static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size)
     /* force update of real size */
     assert(mdat->b->i_buffer==8);
     box_fix(mdat, mdat->b->i_buffer + i_total_size);
+    mdat->b->i_dts = i_dts;
     p_sys->i_pos += mdat->b->i_buffer;
     /* only write header */
     sout_AccessOutWrite(p_mux->p_access, mdat->b);
@@ -1210,6 +1215,10 @@ static int OpenFrag(vlc_object_t *p_this)
     p_sys->i_start_dts = VLC_TS_INVALID;
     p_sys->i_mfhd_sequence = 1;
 
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_sout_options, p_mux->p_cfg);
+    p_sys->i_fragment_length = CLOCK_FREQ / 1000 *
+        var_GetInteger(p_mux, SOUT_CFG_PREFIX "fragment-duration");
+
     return VLC_SUCCESS;
 }
 
@@ -1217,9 +1226,11 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    mtime_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    mtime_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
+    bool b_independent = true;
+    mtime_t i_dts = VLC_TS_INVALID;
 
     if(!p_sys->b_header_sent)
     {
@@ -1236,7 +1247,14 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
         const mp4_stream_t *p_stream = p_sys->pp_streams[i];
         if (p_stream->read.p_first)
         {
+            const block_t *p_first = p_stream->read.p_first->p_block;
+
             b_has_samples = true;
+            if (p_stream->b_hasiframes && !(p_first->i_flags & BLOCK_FLAG_TYPE_I))
+                b_independent = false;
+            if (p_first->i_dts > VLC_TS_INVALID &&
+                (i_dts == VLC_TS_INVALID || p_first->i_dts < i_dts))
+                i_dts = p_first->i_dts;
 
             /* set a barrier so we try to align to keyframe */
             if (p_stream->b_hasiframes &&
@@ -1263,12 +1281,18 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 
     if (moof)
     {
+        /* The streaming servers start from a moof flagged as iframe, and
+         * segmenters split on them, so only flag fragments starting with
+         * a key frame. They carry the fragment start time as dts. */
+        if (b_independent)
+            moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+        moof->b->i_dts = i_dts;
+
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += moof->b->i_buffer;
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
-        WriteFragmentMDAT(p_mux, i_mdat_size);
+        WriteFragmentMDAT(p_mux, i_mdat_size, i_dts);
 
         /* update iframe point */
         for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
@@ -1426,7 +1450,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->mux.i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->mux.i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1475,7 +1499,7 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
@@ -84,6 +84,7 @@ struct sout_stream_id_sys_t
     void *next_id;
     const char *type;
     mtime_t previous_dts,track_duration;
+    mtime_t pipeline_date;
     struct md5_s hash;
 };
 
@@ -177,6 +178,7 @@ static sout_stream_id_sys_t * Add( sout_stream_t *p_stream, const es_format_t *p
     id->segment_number = 0;
     id->previous_dts = VLC_TS_INVALID;
     id->track_duration = 0;
+    id->pipeline_date = 0;
     InitMD5( &id->hash );
 
     msg_Dbg( p_stream, "%s: Adding track type:%s id:%d", p_sys->prefix, id->type, id->id);
@@ -209,6 +211,50 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     free( id );
 }
 
+/* Gets a video pipeline statistic published by the transcode stream output
+ * for the given ES */
+static int64_t PipelineStat( vlc_object_t *p_sout, int i_id, const char *psz_stat )
+{
+    char psz_name[48];
+
+    snprintf( psz_name, sizeof (psz_name), "transcode-%d-%s", i_id, psz_stat );
+    return var_GetInteger( p_sout, psz_name );
+}
+
+/* Writes the video pipeline statistics published by the transcode stream
+ * output for the ES, if any, once per second. Latencies are in
+ * microseconds. */
+static void PipelineStats( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = (sout_stream_sys_t *)p_stream->p_sys;
+    vlc_object_t *p_sout = VLC_OBJECT(p_stream->p_sout);
+    mtime_t now = mdate();
+    char psz_name[48];
+
+    snprintf( psz_name, sizeof (psz_name), "transcode-%d-decode-latency", id->id );
+    if( now - id->pipeline_date < CLOCK_FREQ
+     || var_Type( p_sout, psz_name ) == 0 )
+        return;
+    id->pipeline_date = now;
+
+    int64_t decode_latency = PipelineStat( p_sout, id->id, "decode-latency" );
+    int64_t filter_queue = PipelineStat( p_sout, id->id, "filter-queue" );
+    int64_t filter_latency = PipelineStat( p_sout, id->id, "filter-latency" );
+    int64_t encode_queue = PipelineStat( p_sout, id->id, "encode-queue" );
+    int64_t encode_latency = PipelineStat( p_sout, id->id, "encode-latency" );
+
+    if( p_sys->output )
+    {
+        fprintf( p_sys->output, "#%s: pipeline track:%d decode_latency:%"PRId64" filter_queue:%"PRId64" filter_latency:%"PRId64" encode_queue:%"PRId64" encode_latency:%"PRId64"\n",
+               p_sys->prefix, id->id, decode_latency, filter_queue,
+               filter_latency, encode_queue, encode_latency );
+    } else {
+        msg_Dbg( p_stream, "%s: pipeline track:%d decode_latency:%"PRId64" filter_queue:%"PRId64" filter_latency:%"PRId64" encode_queue:%"PRId64" encode_latency:%"PRId64,
+               p_sys->prefix, id->id, decode_latency, filter_queue,
+               filter_latency, encode_queue, encode_latency );
+    }
+}
+
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
@@ -248,6 +294,8 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         p_block = p_block->p_next;
     }
 
+    PipelineStats( p_stream, id );
+
     if( p_stream->p_next )
         return sout_StreamIdSend( p_stream->p_next, id->next_id, p_buffer );
     else
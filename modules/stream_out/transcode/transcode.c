@@ -80,6 +80,21 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define RENDITIONS_TEXT N_("Additional renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Comma-separated list of additional encodings of the video, as " \
+    "WIDTHxHEIGHT:BITRATE (eg: 1280x720:2000,640x0:500). A dimension of 0 " \
+    "keeps the aspect ratio. The video is decoded and filtered once, then " \
+    "scaled and encoded for each rendition with the same encoder and " \
+    "options, on elementary streams whose ids are offset by 1000 each. " \
+    "All the encoders use the same fixed group of pictures, without " \
+    "scene-cut key frames, so that the key frames (and the segments) of " \
+    "the renditions line up. Only the encoders that support a fixed group " \
+    "of pictures (x264, avcodec) can be used." )
+#define RENDITIONS_GOP_TEXT N_("Renditions key frame interval")
+#define RENDITIONS_GOP_LONGTEXT N_( \
+    "Number of pictures between two key frames, for the main video and all " \
+    "its renditions. 0 is two seconds of pictures." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -130,6 +145,11 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define FILTER_QUEUE_TEXT N_("Filter queue size")
+#define FILTER_QUEUE_LONGTEXT N_( \
+    "Runs the video filters in their own thread, with up to this many " \
+    "decoded pictures waiting for them. 0 runs the filters in the " \
+    "decoding thread." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -178,6 +198,11 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
+    add_integer_with_range( SOUT_CFG_PREFIX "renditions-gop", 0, 0, 10000,
+                            RENDITIONS_GOP_TEXT, RENDITIONS_GOP_LONGTEXT,
+                            true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -213,6 +238,9 @@ vlc_module_begin ()
                  THREADS_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "pool-size", 10, POOL_TEXT, POOL_LONGTEXT, true )
         change_integer_range( 1, 1000 )
+    add_integer( SOUT_CFG_PREFIX "filter-queue", 0, FILTER_QUEUE_TEXT,
+                 FILTER_QUEUE_LONGTEXT, true )
+        change_integer_range( 0, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
 
@@ -224,6 +252,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
+    "filter-queue", "renditions", "renditions-gop",
     NULL
 };
 
@@ -234,6 +263,40 @@ static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/* Parses the "WxH:kbps,WxH:kbps" list of additional video renditions */
+static void ParseRenditions( sout_stream_t *p_stream,
+                             sout_stream_sys_t *p_sys, char *psz_list )
+{
+    char *psz_save;
+
+    for( char *psz = strtok_r( psz_list, ",", &psz_save ); psz != NULL;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+    {
+        unsigned i_width, i_height;
+        int i_bitrate;
+
+        if( sscanf( psz, "%ux%u:%d", &i_width, &i_height, &i_bitrate ) != 3
+         || (i_width == 0 && i_height == 0) || i_bitrate <= 0 )
+        {
+            msg_Warn( p_stream, "ignoring invalid rendition \"%s\"", psz );
+            continue;
+        }
+        if( i_bitrate < 16000 ) i_bitrate *= 1000;
+
+        transcode_rendition_cfg_t *p_renditions =
+            realloc( p_sys->p_renditions,
+                     (p_sys->i_renditions + 1) * sizeof( *p_renditions ) );
+        if( p_renditions == NULL )
+            break;
+        p_sys->p_renditions = p_renditions;
+        p_renditions[p_sys->i_renditions++] = (transcode_rendition_cfg_t) {
+            .i_width = i_width, .i_height = i_height, .i_bitrate = i_bitrate,
+        };
+        msg_Dbg( p_stream, "video rendition %ux%u %dkb/s",
+                 i_width, i_height, i_bitrate / 1000 );
+    }
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -348,6 +411,13 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_maxheight = var_GetInteger( p_stream, SOUT_CFG_PREFIX "maxheight" );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "renditions" );
+    if( psz_string && *psz_string )
+        ParseRenditions( p_stream, p_sys, psz_string );
+    free( psz_string );
+    p_sys->i_renditions_gop =
+        var_GetInteger( p_stream, SOUT_CFG_PREFIX "renditions-gop" );
+
     psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "vfilter" );
     if( psz_string && *psz_string )
         p_sys->psz_vf2 = strdup(psz_string );
@@ -367,6 +437,7 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
+    p_sys->filter_queue_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "filter-queue" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
 
     if( p_sys->i_vcodec )
@@ -442,6 +513,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_renditions );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -8,24 +8,74 @@
 #include <vlc_filter.h>
 #include <vlc_es.h>
 #include <vlc_codec.h>
-
-#include <vlc_picture_fifo.h>
+#include <vlc_atomic.h>
 
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+/* Bounded picture queue between two stages of the video pipeline */
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  cond;
+    struct
+    {
+        picture_t *p_pic;
+        mtime_t    i_date; /* when the picture was queued */
+    }          *p_entries;
+    unsigned    i_size;
+    unsigned    i_first;
+    unsigned    i_count;   /* queued pictures */
+    unsigned    i_pending; /* queued or being processed */
+    bool        b_abort;
+
+    /* Statistics since the last transcode_queue_GetStats() */
+    unsigned    i_max_count;
+    unsigned    i_done;
+    mtime_t     i_latency;
+} transcode_queue_t;
+
+/* Additional encoding of the video, scaled from the main encoder input */
+typedef struct
+{
+    unsigned        i_width;    /* 0 to keep the aspect ratio */
+    unsigned        i_height;   /* 0 to keep the aspect ratio */
+    int             i_bitrate;
+} transcode_rendition_cfg_t;
+
+typedef struct
+{
+    encoder_t       *p_encoder;
+    filter_chain_t  *p_f_chain; /**< Scaling from the main encoder input */
+    void            *id;        /**< Output ES */
+    block_t         *p_out;     /* output of the calling thread */
+    block_t         *p_buffers; /* pending pipeline thread output */
+    vlc_ring_t      *p_out_ring;
+    atomic_bool     b_unaligned; /**< a picture was not encoded */
+} transcode_rendition_t;
+
 struct sout_stream_sys_t
 {
+    /* Video pipeline: the decoder runs in the calling thread, the filters
+     * and the encoder in optional threads */
     sout_stream_id_sys_t *id_video;
-    block_t         *p_buffers;
-    vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
+    block_t         *p_buffers; /* pending pipeline thread output */
+    vlc_ring_t      *p_out_ring;
     bool            b_abort;
-    picture_fifo_t *pp_pics;
-    vlc_sem_t       picture_pool_has_room;
+    bool            b_filter_thread;
+    bool            b_encoder_thread;
+    transcode_queue_t filter_queue;
+    transcode_queue_t encoder_queue;
+    uint32_t        filter_queue_size;
     uint32_t        pool_size;
+    vlc_thread_t    filter_thread;
     vlc_thread_t    thread;
 
+    /* Decoding statistics since the last publication */
+    mtime_t         i_decode_time;
+    unsigned        i_decoded;
+    mtime_t         i_stats_date;
+
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
     char            *psz_aenc;
@@ -54,6 +104,10 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    transcode_rendition_cfg_t *p_renditions;
+    unsigned        i_renditions;
+    unsigned        i_renditions_gop; /* pictures, 0 for two seconds */
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -107,6 +161,8 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
+             transcode_rendition_t *p_renditions;
+             unsigned        i_renditions;
          };
          struct
          {
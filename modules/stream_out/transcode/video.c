@@ -30,6 +30,7 @@
 
 #include "transcode.h"
 
+#include <assert.h>
 #include <math.h>
 #include <vlc_meta.h>
 #include <vlc_spu.h>
@@ -37,6 +38,8 @@
 
 #define ENC_FRAMERATE (25 * 1000)
 #define ENC_FRAMERATE_BASE 1000
+/* Encoded block lists queued by the encoder thread */
+#define TRANSCODE_OUT_RING_SIZE 256
 
 static const es_format_t* video_output_format( sout_stream_id_sys_t *id )
 {
@@ -97,60 +100,377 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
-static void* EncoderThread( void *obj )
+static int transcode_queue_Init( transcode_queue_t *p_queue, unsigned i_size )
+{
+    p_queue->p_entries = vlc_alloc( i_size, sizeof(*p_queue->p_entries) );
+    if( unlikely(p_queue->p_entries == NULL) )
+        return VLC_ENOMEM;
+
+    vlc_mutex_init( &p_queue->lock );
+    vlc_cond_init( &p_queue->cond );
+    p_queue->i_size = i_size;
+    p_queue->i_first = 0;
+    p_queue->i_count = 0;
+    p_queue->i_pending = 0;
+    p_queue->b_abort = false;
+    p_queue->i_max_count = 0;
+    p_queue->i_done = 0;
+    p_queue->i_latency = 0;
+    return VLC_SUCCESS;
+}
+
+static void transcode_queue_Clean( transcode_queue_t *p_queue )
+{
+    for( unsigned i = 0; i < p_queue->i_count; i++ )
+        picture_Release( p_queue->p_entries[(p_queue->i_first + i)
+                                            % p_queue->i_size].p_pic );
+    vlc_cond_destroy( &p_queue->cond );
+    vlc_mutex_destroy( &p_queue->lock );
+    free( p_queue->p_entries );
+}
+
+/* Queues a picture, waiting for room if the next stage is late */
+static void transcode_queue_Push( transcode_queue_t *p_queue, picture_t *p_pic )
+{
+    vlc_mutex_lock( &p_queue->lock );
+    while( p_queue->i_count == p_queue->i_size )
+        vlc_cond_wait( &p_queue->cond, &p_queue->lock );
+
+    unsigned i_last = (p_queue->i_first + p_queue->i_count) % p_queue->i_size;
+    p_queue->p_entries[i_last].p_pic = p_pic;
+    p_queue->p_entries[i_last].i_date = mdate();
+    p_queue->i_count++;
+    p_queue->i_pending++;
+    if( p_queue->i_count > p_queue->i_max_count )
+        p_queue->i_max_count = p_queue->i_count;
+    vlc_cond_broadcast( &p_queue->cond );
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+/* Dequeues a picture, or returns NULL once aborted and empty. The picture
+ * must then be acknowledged with transcode_queue_Done(). */
+static picture_t *transcode_queue_Pop( transcode_queue_t *p_queue,
+                                       mtime_t *pi_date )
 {
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
-    sout_stream_id_sys_t *id = p_sys->id_video;
     picture_t *p_pic = NULL;
-    int canc = vlc_savecancel ();
-    block_t *p_block = NULL;
 
-    vlc_mutex_lock( &p_sys->lock_out );
+    vlc_mutex_lock( &p_queue->lock );
+    while( p_queue->i_count == 0 && !p_queue->b_abort )
+        vlc_cond_wait( &p_queue->cond, &p_queue->lock );
 
-    for( ;; )
+    if( p_queue->i_count > 0 )
     {
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
-            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
-        vlc_sem_post( &p_sys->picture_pool_has_room );
+        p_pic = p_queue->p_entries[p_queue->i_first].p_pic;
+        *pi_date = p_queue->p_entries[p_queue->i_first].i_date;
+        p_queue->i_first = (p_queue->i_first + 1) % p_queue->i_size;
+        p_queue->i_count--;
+        vlc_cond_broadcast( &p_queue->cond );
+    }
+    vlc_mutex_unlock( &p_queue->lock );
+    return p_pic;
+}
 
-        if( p_pic )
-        {
-            /* release lock while encoding */
-            vlc_mutex_unlock( &p_sys->lock_out );
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-            picture_Release( p_pic );
-            vlc_mutex_lock( &p_sys->lock_out );
+static void transcode_queue_Done( transcode_queue_t *p_queue, mtime_t i_date )
+{
+    mtime_t i_latency = mdate() - i_date;
+
+    vlc_mutex_lock( &p_queue->lock );
+    assert( p_queue->i_pending > 0 );
+    p_queue->i_pending--;
+    p_queue->i_done++;
+    p_queue->i_latency += i_latency;
+    if( p_queue->i_pending == 0 )
+        vlc_cond_broadcast( &p_queue->cond );
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+/* Waits until every queued picture has been processed */
+static void transcode_queue_Drain( transcode_queue_t *p_queue )
+{
+    vlc_mutex_lock( &p_queue->lock );
+    while( p_queue->i_pending > 0 )
+        vlc_cond_wait( &p_queue->cond, &p_queue->lock );
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+/* Lets the consumer process the queued pictures, then stop */
+static void transcode_queue_Abort( transcode_queue_t *p_queue )
+{
+    vlc_mutex_lock( &p_queue->lock );
+    p_queue->b_abort = true;
+    vlc_cond_broadcast( &p_queue->cond );
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+/* Returns the highest depth and the average latency, and resets them */
+static void transcode_queue_GetStats( transcode_queue_t *p_queue,
+                                      unsigned *pi_depth, mtime_t *pi_latency )
+{
+    vlc_mutex_lock( &p_queue->lock );
+    *pi_depth = p_queue->i_max_count;
+    *pi_latency = p_queue->i_done ? p_queue->i_latency / p_queue->i_done : 0;
+    p_queue->i_max_count = p_queue->i_count;
+    p_queue->i_done = 0;
+    p_queue->i_latency = 0;
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+/* Hands encoded blocks over to the stream output thread, without locking.
+ * Only one pipeline thread, the last one, calls this. */
+static void PipelineOutput( vlc_ring_t *p_ring, block_t **pp_buffers,
+                            block_t *p_block )
+{
+    block_ChainAppend( pp_buffers, p_block );
+
+    /* If the ring is full, keep the blocks until the next try */
+    if( *pp_buffers != NULL && vlc_ring_Push( p_ring, *pp_buffers ) )
+        *pp_buffers = NULL;
+}
 
-            block_ChainAppend( &p_sys->p_buffers, p_block );
+static block_t *PipelineGetOutput( vlc_ring_t *p_ring )
+{
+    block_t *p_out = NULL, **pp_last = &p_out, *p_block;
+
+    while( (p_block = vlc_ring_Pop( p_ring )) != NULL )
+        block_ChainLastAppend( &pp_last, p_block );
+    return p_out;
+}
+
+/* Scales and encodes a picture for each rendition, then encodes it for the
+ * main output and releases it. Called from a pipeline thread if out is
+ * NULL. */
+static void transcode_video_encode( sout_stream_sys_t *p_sys,
+                                    sout_stream_id_sys_t *id,
+                                    picture_t *p_pic, block_t **out )
+{
+    block_t *p_block;
+
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_r = &id->p_renditions[i];
+        /* Without its scaler, the rendition would get the wrong size */
+        if( p_r->p_f_chain == NULL || atomic_load( &p_r->b_unaligned ) )
+            continue;
+
+        picture_t *p_scaled = filter_chain_VideoFilter( p_r->p_f_chain,
+                                                        picture_Hold( p_pic ) );
+        if( p_scaled == NULL )
+        {   /* Its key frames would not line up with the others anymore */
+            atomic_store( &p_r->b_unaligned, true );
+            continue;
         }
 
-        if( p_sys->b_abort )
-            break;
+        p_block = p_r->p_encoder->pf_encode_video( p_r->p_encoder, p_scaled );
+        picture_Release( p_scaled );
+        if( out == NULL )
+            PipelineOutput( p_r->p_out_ring, &p_r->p_buffers, p_block );
+        else
+            block_ChainAppend( &p_r->p_out, p_block );
+    }
+
+    p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+    picture_Release( p_pic );
+    if( out == NULL )
+        PipelineOutput( p_sys->p_out_ring, &p_sys->p_buffers, p_block );
+    else
+        block_ChainAppend( out, p_block );
+}
+
+/* Drains the encoders, if they were ever opened */
+static void transcode_video_flush( sout_stream_sys_t *p_sys,
+                                   sout_stream_id_sys_t *id, block_t **out )
+{
+    block_t *p_block;
+
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_r = &id->p_renditions[i];
+
+        do {
+            p_block = p_r->p_encoder->pf_encode_video( p_r->p_encoder, NULL );
+            if( out == NULL )
+                PipelineOutput( p_r->p_out_ring, &p_r->p_buffers, p_block );
+            else
+                block_ChainAppend( &p_r->p_out, p_block );
+        } while( p_block );
     }
 
-    /*Encode what we have in the buffer on closing*/
-    while( (p_pic = picture_fifo_Pop( p_sys->pp_pics )) != NULL )
+    if( id->p_encoder->p_module )
     {
-        vlc_sem_post( &p_sys->picture_pool_has_room );
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        picture_Release( p_pic );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
+        do {
+            p_block = id->p_encoder->pf_encode_video( id->p_encoder, NULL );
+            if( out == NULL )
+                PipelineOutput( p_sys->p_out_ring, &p_sys->p_buffers, p_block );
+            else
+                block_ChainAppend( out, p_block );
+        } while( p_block );
     }
+}
+
+static void* EncoderThread( void *obj )
+{
+    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
+    sout_stream_id_sys_t *id = p_sys->id_video;
+    picture_t *p_pic;
+    mtime_t i_date;
+    int canc = vlc_savecancel ();
+
+    /* Encode until aborted, including what is queued on closing */
+    while( (p_pic = transcode_queue_Pop( &p_sys->encoder_queue,
+                                         &i_date )) != NULL )
+    {
+        transcode_video_encode( p_sys, id, p_pic, NULL );
+        transcode_queue_Done( &p_sys->encoder_queue, i_date );
+    }
+
+    transcode_video_flush( p_sys, id, NULL );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+static void transcode_video_filter_process( sout_stream_t *,
+                                            sout_stream_id_sys_t *,
+                                            picture_t *, block_t ** );
 
-    /*Now flush encoder*/
-    do {
-        p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    } while( p_block );
+static void* FilterThread( void *obj )
+{
+    sout_stream_t *p_stream = obj;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = p_sys->id_video;
+    picture_t *p_pic;
+    mtime_t i_date;
+    int canc = vlc_savecancel ();
 
-    vlc_mutex_unlock( &p_sys->lock_out );
+    while( (p_pic = transcode_queue_Pop( &p_sys->filter_queue,
+                                         &i_date )) != NULL )
+    {
+        transcode_video_filter_process( p_stream, id, p_pic, NULL );
+        transcode_queue_Done( &p_sys->filter_queue, i_date );
+    }
 
     vlc_restorecancel (canc);
 
     return NULL;
 }
 
+/* Processes the pictures left in the pipeline and joins its threads */
+static void transcode_video_pipeline_stop( sout_stream_sys_t *p_sys )
+{
+    if( p_sys->b_abort )
+        return;
+    p_sys->b_abort = true;
+
+    /* The filter thread feeds the encoder thread, stop it first */
+    if( p_sys->b_filter_thread )
+    {
+        transcode_queue_Abort( &p_sys->filter_queue );
+        vlc_join( p_sys->filter_thread, NULL );
+    }
+    if( p_sys->b_encoder_thread )
+    {
+        transcode_queue_Abort( &p_sys->encoder_queue );
+        vlc_join( p_sys->thread, NULL );
+    }
+}
+
+/* Waits for the pipeline threads to be idle */
+static void transcode_video_pipeline_drain( sout_stream_sys_t *p_sys )
+{
+    if( p_sys->b_filter_thread )
+        transcode_queue_Drain( &p_sys->filter_queue );
+    if( p_sys->b_encoder_thread )
+        transcode_queue_Drain( &p_sys->encoder_queue );
+}
+
+static const char *const ppsz_stats_vars[] = {
+    "decode-latency",
+    "filter-queue", "filter-latency",
+    "encode-queue", "encode-latency",
+};
+
+/* The statistics variables live on the stream output instance, shared by
+ * all the streams of the chain: they are named after the output ES id,
+ * "transcode-<id>-<statistic>" */
+#define STATS_VAR_NAME_SIZE 48
+
+static void transcode_video_stats_name( char *psz_name,
+                                        const sout_stream_id_sys_t *id,
+                                        const char *psz_stat )
+{
+    snprintf( psz_name, STATS_VAR_NAME_SIZE, "transcode-%d-%s",
+              id->p_encoder->fmt_out.i_id, psz_stat );
+}
+
+static void transcode_video_stats_create( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id )
+{
+    char psz_name[STATS_VAR_NAME_SIZE];
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_stats_vars); i++ )
+    {
+        transcode_video_stats_name( psz_name, id, ppsz_stats_vars[i] );
+        var_Create( p_stream->p_sout, psz_name, VLC_VAR_INTEGER );
+    }
+}
+
+static void transcode_video_stats_destroy( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id )
+{
+    char psz_name[STATS_VAR_NAME_SIZE];
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_stats_vars); i++ )
+    {
+        transcode_video_stats_name( psz_name, id, ppsz_stats_vars[i] );
+        var_Destroy( p_stream->p_sout, psz_name );
+    }
+}
+
+static void transcode_video_stats_set( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id,
+                                       const char *psz_stat, int64_t i_value )
+{
+    char psz_name[STATS_VAR_NAME_SIZE];
+
+    transcode_video_stats_name( psz_name, id, psz_stat );
+    var_SetInteger( p_stream->p_sout, psz_name, i_value );
+}
+
+/* Publishes the stage statistics for the stats stream output, at most once
+ * per second */
+static void transcode_video_stats_publish( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    mtime_t i_now = mdate();
+    unsigned i_depth;
+    mtime_t i_latency;
+
+    if( i_now - p_sys->i_stats_date < CLOCK_FREQ )
+        return;
+    p_sys->i_stats_date = i_now;
+
+    transcode_video_stats_set( p_stream, id, "decode-latency",
+                    p_sys->i_decoded ? p_sys->i_decode_time / p_sys->i_decoded
+                                     : 0 );
+    p_sys->i_decode_time = 0;
+    p_sys->i_decoded = 0;
+
+    if( p_sys->b_filter_thread )
+    {
+        transcode_queue_GetStats( &p_sys->filter_queue, &i_depth, &i_latency );
+        transcode_video_stats_set( p_stream, id, "filter-queue", i_depth );
+        transcode_video_stats_set( p_stream, id, "filter-latency", i_latency );
+    }
+    if( p_sys->b_encoder_thread )
+    {
+        transcode_queue_GetStats( &p_sys->encoder_queue, &i_depth, &i_latency );
+        transcode_video_stats_set( p_stream, id, "encode-queue", i_depth );
+        transcode_video_stats_set( p_stream, id, "encode-latency", i_latency );
+    }
+}
+
 static int decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
 {
     sout_stream_id_sys_t *id = p_dec->p_queue_ctx;
@@ -265,37 +585,68 @@ static int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *i
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
+    p_sys->id_video = id;
+    p_sys->b_abort = false;
+    p_sys->b_filter_thread = p_sys->filter_queue_size > 0;
+    p_sys->b_encoder_thread = p_sys->i_threads > 0;
+    p_sys->i_decode_time = 0;
+    p_sys->i_decoded = 0;
+    p_sys->i_stats_date = mdate();
+    transcode_video_stats_create( p_stream, id );
+
+    if( !p_sys->b_filter_thread && !p_sys->b_encoder_thread )
         return VLC_SUCCESS;
 
-    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                       VLC_THREAD_PRIORITY_VIDEO;
-    p_sys->id_video = id;
-    p_sys->pp_pics = picture_fifo_New();
-    if( p_sys->pp_pics == NULL )
+    p_sys->p_buffers = NULL;
+    p_sys->p_out_ring = vlc_ring_New( TRANSCODE_OUT_RING_SIZE );
+    if( p_sys->p_out_ring == NULL )
+        goto error;
+
+    if( p_sys->b_encoder_thread )
     {
-        msg_Err( p_stream, "cannot create picture fifo" );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        return VLC_ENOMEM;
+        int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                           VLC_THREAD_PRIORITY_VIDEO;
+
+        if( transcode_queue_Init( &p_sys->encoder_queue, p_sys->pool_size ) )
+            goto error_ring;
+        if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
+        {
+            msg_Err( p_stream, "cannot spawn encoder thread" );
+            transcode_queue_Clean( &p_sys->encoder_queue );
+            goto error_ring;
+        }
     }
 
-    vlc_sem_init( &p_sys->picture_pool_has_room, p_sys->pool_size );
-    vlc_mutex_init( &p_sys->lock_out );
-    vlc_cond_init( &p_sys->cond );
-    p_sys->p_buffers = NULL;
-    p_sys->b_abort = false;
-    if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
+    if( p_sys->b_filter_thread )
     {
-        msg_Err( p_stream, "cannot spawn encoder thread" );
-        vlc_mutex_destroy( &p_sys->lock_out );
-        vlc_cond_destroy( &p_sys->cond );
-        picture_fifo_Delete( p_sys->pp_pics );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        return VLC_EGENERIC;
+        if( transcode_queue_Init( &p_sys->filter_queue,
+                                  p_sys->filter_queue_size ) )
+            goto error_encoder;
+        if( vlc_clone( &p_sys->filter_thread, FilterThread, p_stream,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Err( p_stream, "cannot spawn filter thread" );
+            transcode_queue_Clean( &p_sys->filter_queue );
+            goto error_encoder;
+        }
     }
     return VLC_SUCCESS;
+
+error_encoder:
+    p_sys->b_filter_thread = false;
+    if( p_sys->b_encoder_thread )
+    {
+        transcode_video_pipeline_stop( p_sys );
+        transcode_queue_Clean( &p_sys->encoder_queue );
+    }
+error_ring:
+    vlc_ring_Delete( p_sys->p_out_ring );
+error:
+    transcode_video_stats_destroy( p_stream, id );
+    p_sys->b_filter_thread = p_sys->b_encoder_thread = false;
+    module_unneed( id->p_decoder, id->p_decoder->p_module );
+    id->p_decoder->p_module = NULL;
+    return VLC_EGENERIC;
 }
 
 static void transcode_video_filter_init( sout_stream_t *p_stream,
@@ -609,6 +960,254 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
 
 }
 
+/* (Re)builds the scaling from the main encoder input to a rendition */
+static int transcode_rendition_chain_init( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id,
+                                           transcode_rendition_t *p_r )
+{
+    filter_owner_t owner = {
+        .sys = p_stream->p_sys,
+        .video = {
+            .buffer_new = transcode_video_filter_buffer_new,
+        },
+    };
+    const es_format_t *p_fmt_in = &id->p_encoder->fmt_in;
+    const es_format_t *p_fmt_out = &p_r->p_encoder->fmt_in;
+
+    if( p_r->p_f_chain )
+        filter_chain_Delete( p_r->p_f_chain );
+    p_r->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
+    if( p_r->p_f_chain == NULL )
+        return VLC_ENOMEM;
+    filter_chain_Reset( p_r->p_f_chain, p_fmt_in, p_fmt_out );
+
+    if( ( ( p_fmt_in->video.i_chroma != p_fmt_out->video.i_chroma ) ||
+          ( p_fmt_in->video.i_width != p_fmt_out->video.i_width ) ||
+          ( p_fmt_in->video.i_height != p_fmt_out->video.i_height ) ) &&
+        filter_chain_AppendConverter( p_r->p_f_chain, p_fmt_in,
+                                      p_fmt_out ) != VLC_SUCCESS )
+    {
+        msg_Warn( p_stream, "cannot scale to the %ux%u rendition",
+                  p_fmt_out->video.i_width, p_fmt_out->video.i_height );
+        filter_chain_Delete( p_r->p_f_chain );
+        p_r->p_f_chain = NULL;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void transcode_rendition_clean( sout_stream_t *p_stream,
+                                       transcode_rendition_t *p_r )
+{
+    if( p_r->id )
+        sout_StreamIdDel( p_stream->p_next, p_r->id );
+    if( p_r->p_f_chain )
+        filter_chain_Delete( p_r->p_f_chain );
+    if( p_r->p_out_ring )
+        vlc_ring_Delete( p_r->p_out_ring );
+    block_ChainRelease( p_r->p_buffers );
+    block_ChainRelease( p_r->p_out );
+
+    if( p_r->p_encoder->p_module )
+        module_unneed( p_r->p_encoder, p_r->p_encoder->p_module );
+    es_format_Clean( &p_r->p_encoder->fmt_in );
+    es_format_Clean( &p_r->p_encoder->fmt_out );
+    vlc_object_release( p_r->p_encoder );
+}
+
+/* Encoders which place key frames every encoder_t.i_iframes pictures, and
+ * nowhere else */
+static bool transcode_encoder_has_fixed_gop( const encoder_t *p_enc )
+{
+    static const char *const ppsz_names[] = {
+        "x264", "x26410b", "x262", "avcodec",
+    };
+    const char *psz_name = module_get_object( p_enc->p_module );
+
+    for( size_t i = 0; i < ARRAY_SIZE( ppsz_names ); i++ )
+        if( !strcmp( psz_name, ppsz_names[i] ) )
+            return true;
+    return false;
+}
+
+/* Opens the additional encoders, with the same module, options and group of
+ * pictures as the main one, each one on its own ES. A rendition that cannot
+ * be opened is skipped. */
+static void transcode_renditions_open( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const video_format_t *p_main = &id->p_encoder->fmt_out.video;
+
+    if( p_sys->i_renditions == 0 )
+        return;
+    if( !transcode_encoder_has_fixed_gop( id->p_encoder ) )
+    {
+        msg_Err( p_stream, "the %s encoder cannot align the key frames of "
+                 "the renditions, they are disabled",
+                 module_get_object( id->p_encoder->p_module ) );
+        return;
+    }
+    id->p_renditions = calloc( p_sys->i_renditions,
+                               sizeof( *id->p_renditions ) );
+    if( id->p_renditions == NULL )
+        return;
+
+    unsigned i_main_width = p_main->i_visible_width ? p_main->i_visible_width
+                                                    : p_main->i_width;
+    unsigned i_main_height = p_main->i_visible_height ? p_main->i_visible_height
+                                                      : p_main->i_height;
+
+    for( unsigned i = 0; i < p_sys->i_renditions; i++ )
+    {
+        const transcode_rendition_cfg_t *p_cfg = &p_sys->p_renditions[i];
+        transcode_rendition_t *p_r = &id->p_renditions[id->i_renditions];
+        unsigned i_width = p_cfg->i_width, i_height = p_cfg->i_height;
+
+        /* Keep the main picture aspect for the missing dimension */
+        if( i_width == 0 )
+            i_width = (uint64_t)i_height * i_main_width / i_main_height;
+        if( i_height == 0 )
+            i_height = (uint64_t)i_width * i_main_height / i_main_width;
+        i_width = (i_width + 1) & ~1;
+        i_height = (i_height + 1) & ~1;
+
+        encoder_t *p_enc = sout_EncoderCreate( p_stream );
+        if( p_enc == NULL )
+            break;
+        p_r->p_encoder = p_enc;
+        atomic_init( &p_r->b_unaligned, false );
+
+        es_format_Copy( &p_enc->fmt_in, &id->p_encoder->fmt_in );
+        es_format_Copy( &p_enc->fmt_out, &id->p_encoder->fmt_out );
+        free( p_enc->fmt_out.p_extra );
+        p_enc->fmt_out.p_extra = NULL;
+        p_enc->fmt_out.i_extra = 0;
+
+        p_enc->fmt_in.video.i_width = p_enc->fmt_in.video.i_visible_width =
+        p_enc->fmt_out.video.i_width = p_enc->fmt_out.video.i_visible_width =
+            i_width;
+        p_enc->fmt_in.video.i_height = p_enc->fmt_in.video.i_visible_height =
+        p_enc->fmt_out.video.i_height = p_enc->fmt_out.video.i_visible_height =
+            i_height;
+        p_enc->fmt_in.video.i_x_offset = p_enc->fmt_out.video.i_x_offset = 0;
+        p_enc->fmt_in.video.i_y_offset = p_enc->fmt_out.video.i_y_offset = 0;
+
+        /* Same display aspect ratio as the main output */
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     (uint64_t)p_main->i_sar_num * i_main_width * i_height,
+                     (uint64_t)p_main->i_sar_den * i_main_height * i_width,
+                     0 );
+        p_enc->fmt_in.video.i_sar_num = p_enc->fmt_out.video.i_sar_num;
+        p_enc->fmt_in.video.i_sar_den = p_enc->fmt_out.video.i_sar_den;
+
+        p_enc->fmt_out.i_bitrate = p_cfg->i_bitrate;
+        p_enc->fmt_out.i_id += 1000 * (i + 1);
+        p_enc->i_threads = p_sys->i_threads;
+        p_enc->i_iframes = id->p_encoder->i_iframes;
+        p_enc->p_cfg = p_sys->p_video_cfg;
+
+        p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+        if( p_enc->p_module == NULL ||
+            !transcode_encoder_has_fixed_gop( p_enc ) )
+        {
+            msg_Warn( p_stream, "cannot open the %ux%u rendition encoder",
+                      i_width, i_height );
+            transcode_rendition_clean( p_stream, p_r );
+            memset( p_r, 0, sizeof( *p_r ) );
+            continue;
+        }
+        p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+        p_enc->fmt_out.i_codec =
+            vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+
+        if( p_sys->b_filter_thread || p_sys->b_encoder_thread )
+        {
+            p_r->p_out_ring = vlc_ring_New( TRANSCODE_OUT_RING_SIZE );
+            if( p_r->p_out_ring == NULL )
+            {
+                transcode_rendition_clean( p_stream, p_r );
+                memset( p_r, 0, sizeof( *p_r ) );
+                continue;
+            }
+        }
+
+        /* Only announce the ES once it can be fed: muxers wait for data on
+         * every ES */
+        if( transcode_rendition_chain_init( p_stream, id, p_r ) )
+        {
+            transcode_rendition_clean( p_stream, p_r );
+            memset( p_r, 0, sizeof( *p_r ) );
+            continue;
+        }
+
+        p_r->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+        if( p_r->id == NULL )
+        {
+            msg_Warn( p_stream, "cannot add the %ux%u rendition stream",
+                      i_width, i_height );
+            transcode_rendition_clean( p_stream, p_r );
+            memset( p_r, 0, sizeof( *p_r ) );
+            continue;
+        }
+
+        msg_Dbg( p_stream, "rendition %ux%u %dkb/s on es %d", i_width,
+                 i_height, p_cfg->i_bitrate / 1000, p_enc->fmt_out.i_id );
+        id->i_renditions++;
+    }
+}
+
+static void transcode_renditions_close( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+        transcode_rendition_clean( p_stream, &id->p_renditions[i] );
+    free( id->p_renditions );
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+}
+
+/* Sends what the renditions encoded, from the calling thread, and what the
+ * pipeline threads handed over. Once the pipeline is stopped, this includes
+ * the blocks that did not fit in the rings. */
+static void transcode_renditions_send( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id,
+                                       bool b_stopped )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_r = &id->p_renditions[i];
+        block_t *p_out = NULL;
+
+        if( p_r->p_out_ring )
+        {
+            p_out = PipelineGetOutput( p_r->p_out_ring );
+            if( b_stopped )
+            {
+                block_ChainAppend( &p_out, p_r->p_buffers );
+                p_r->p_buffers = NULL;
+            }
+        }
+        block_ChainAppend( &p_out, p_r->p_out );
+        p_r->p_out = NULL;
+
+        if( p_r->id != NULL && atomic_load( &p_r->b_unaligned ) )
+        {
+            msg_Warn( p_stream, "rendition %ux%u lost a picture, removing it",
+                      p_r->p_encoder->fmt_out.video.i_width,
+                      p_r->p_encoder->fmt_out.video.i_height );
+            sout_StreamIdDel( p_stream->p_next, p_r->id );
+            p_r->id = NULL;
+        }
+
+        if( p_r->id == NULL ) /* removed from the mux */
+            block_ChainRelease( p_out );
+        else if( p_out != NULL )
+            sout_StreamIdSend( p_stream->p_next, p_r->id, p_out );
+    }
+}
+
 static int transcode_video_encoder_open( sout_stream_t *p_stream,
                                          sout_stream_id_sys_t *id )
 {
@@ -619,6 +1218,21 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
              id->p_encoder->fmt_in.video.i_width,
              id->p_encoder->fmt_in.video.i_height );
 
+    /* The key frames of the renditions only line up with a common fixed
+     * group of pictures */
+    if( p_sys->i_renditions > 0 )
+    {
+        const video_format_t *p_vid = &id->p_encoder->fmt_out.video;
+        unsigned i_gop = p_sys->i_renditions_gop;
+
+        if( i_gop == 0 )
+            i_gop = ( 2 * p_vid->i_frame_rate + p_vid->i_frame_rate_base / 2 )
+                    / p_vid->i_frame_rate_base;
+        id->p_encoder->i_iframes = __MAX( i_gop, 1 );
+        msg_Dbg( p_stream, "key frame every %d pictures",
+                 id->p_encoder->i_iframes );
+    }
+
     id->p_encoder->p_module =
         module_need( id->p_encoder, "encoder", p_sys->psz_venc, true );
     if( !id->p_encoder->p_module )
@@ -642,30 +1256,33 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
         return VLC_EGENERIC;
     }
 
+    transcode_renditions_open( p_stream, id );
+
     return VLC_SUCCESS;
 }
 
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
-    {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
 
-        vlc_join( p_stream->p_sys->thread, NULL );
+    if( p_sys->b_filter_thread || p_sys->b_encoder_thread )
+    {
+        transcode_video_pipeline_stop( p_sys );
 
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        block_ChainRelease( p_stream->p_sys->p_buffers );
+        block_ChainRelease( p_sys->p_buffers );
+        p_sys->p_buffers = NULL;
+        vlc_ring_Delete( p_sys->p_out_ring );
+        if( p_sys->b_filter_thread )
+            transcode_queue_Clean( &p_sys->filter_queue );
+        if( p_sys->b_encoder_thread )
+            transcode_queue_Clean( &p_sys->encoder_queue );
+        p_sys->b_filter_thread = p_sys->b_encoder_thread = false;
     }
 
-    if( p_stream->p_sys->i_threads >= 1 )
-    {
-        vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-        vlc_cond_destroy( &p_stream->p_sys->cond );
-    }
+    transcode_renditions_close( p_stream, id );
+
+    transcode_video_stats_destroy( p_stream, id );
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -730,25 +1347,48 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         }
     }
 
-    if( p_sys->i_threads == 0 )
+    if( p_sys->b_encoder_thread )
     {
-        block_t *p_block;
-
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        block_ChainAppend( out, p_block );
+        transcode_queue_Push( &p_sys->encoder_queue, p_pic );
+        return;
     }
 
-    if( p_sys->i_threads )
-    {
-        vlc_sem_wait( &p_sys->picture_pool_has_room );
-        vlc_mutex_lock( &p_sys->lock_out );
-        picture_fifo_Push( p_sys->pp_pics, p_pic );
-        vlc_cond_signal( &p_sys->cond );
-        vlc_mutex_unlock( &p_sys->lock_out );
-    }
+    /* Without encoder thread, the filter thread ends the pipeline */
+    transcode_video_encode( p_sys, id, p_pic, out );
+}
+
+/* Runs the filter and output chains; first with the picture, and then with
+ * NULL as many times as we need until they stop outputting frames.
+ * Called from the filter thread with a NULL out, if any. */
+static void transcode_video_filter_process( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id,
+                                            picture_t *p_pic, block_t **out )
+{
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
+
+        for ( ;; ) {
+            picture_t *p_user_filtered_pic = p_filtered_pic;
+
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
+                break;
 
-    if ( p_sys->i_threads == 0 )
-        picture_Release( p_pic );
+            OutputFrame( p_stream, p_user_filtered_pic, id, out );
+
+            p_filtered_pic = NULL;
+        }
+
+        p_pic = NULL;
+    }
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -758,9 +1398,12 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     *out = NULL;
     bool b_error = false;
 
+    mtime_t i_start = mdate();
     int ret = id->p_decoder->pf_decode( id->p_decoder, in );
     if( ret != VLCDEC_SUCCESS )
         return VLC_EGENERIC;
+    p_sys->i_decode_time += mdate() - i_start;
+    p_sys->i_decoded++;
 
     picture_t *p_pics = transcode_dequeue_all_pics( id );
     if( p_pics == NULL )
@@ -788,6 +1431,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                         id->fmt_input_video.i_sar_num, id->p_decoder->fmt_out.video.i_sar_num,
                         id->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
+            /* The pipeline threads must not use the chains meanwhile */
+            transcode_video_pipeline_drain( p_sys );
             /* Close filters */
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
@@ -804,6 +1449,18 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             transcode_video_encoder_init( p_stream, id );
             transcode_video_filter_init( p_stream, id );
             conversion_video_filter_append( id );
+            for( unsigned i = 0; i < id->i_renditions; i++ )
+            {
+                transcode_rendition_t *p_r = &id->p_renditions[i];
+
+                /* A rendition that cannot be fed anymore leaves the mux */
+                if( transcode_rendition_chain_init( p_stream, id, p_r ) &&
+                    p_r->id != NULL )
+                {
+                    sout_StreamIdDel( p_stream->p_next, p_r->id );
+                    p_r->id = NULL;
+                }
+            }
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
@@ -831,79 +1488,42 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             }
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
-
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
-                break;
-
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
-            }
-
-            p_pic = NULL;
-        }
+        if( p_sys->b_filter_thread )
+            transcode_queue_Push( &p_sys->filter_queue, p_pic );
+        else
+            transcode_video_filter_process( p_stream, id, p_pic, out );
     } while( p_pics );
 
-    if( p_sys->i_threads >= 1 )
+end:
+    if( b_error )
+        return VLC_EGENERIC;
+
+    if( p_sys->b_filter_thread || p_sys->b_encoder_thread )
     {
-        /* Pick up any return data the encoder thread wants to output. */
-        vlc_mutex_lock( &p_sys->lock_out );
-        *out = p_sys->p_buffers;
-        p_sys->p_buffers = NULL;
-        vlc_mutex_unlock( &p_sys->lock_out );
+        /* Pick up any return data the pipeline threads want to output. */
+        block_ChainAppend( out, PipelineGetOutput( p_sys->p_out_ring ) );
     }
 
-end:
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
-        {
-            if( id->p_encoder->p_module )
-            {
-                block_t *p_block;
-                do {
-                    p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-                    block_ChainAppend( out, p_block );
-                } while( p_block );
-            }
-        }
-        else
+        if( p_sys->b_filter_thread || p_sys->b_encoder_thread )
         {
             msg_Dbg( p_stream, "Flushing thread and waiting that");
-            vlc_mutex_lock( &p_stream->p_sys->lock_out );
-            p_stream->p_sys->b_abort = true;
-            vlc_cond_signal( &p_stream->p_sys->cond );
-            vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-            vlc_join( p_stream->p_sys->thread, NULL );
-            vlc_mutex_lock( &p_sys->lock_out );
-            *out = p_sys->p_buffers;
+            transcode_video_pipeline_stop( p_sys );
+            block_ChainAppend( out, PipelineGetOutput( p_sys->p_out_ring ) );
+            block_ChainAppend( out, p_sys->p_buffers );
             p_sys->p_buffers = NULL;
-            vlc_mutex_unlock( &p_sys->lock_out );
-
             msg_Dbg( p_stream, "Flushing done");
         }
+
+        /* The encoder thread, if any, has flushed the encoders */
+        if( !p_sys->b_encoder_thread )
+            transcode_video_flush( p_sys, id, out );
     }
 
-    return b_error ? VLC_EGENERIC : VLC_SUCCESS;
+    transcode_renditions_send( p_stream, id, in == NULL );
+    transcode_video_stats_publish( p_stream, id );
+    return VLC_SUCCESS;
 }
 
 bool transcode_video_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
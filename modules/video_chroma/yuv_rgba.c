@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * yuv_rgba.c: YUV 8 to 16-bit to RGBA/BGRA conversions
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include "../video_filter/filter_picture.h"
+#include "yuv_rgba_conv.h"
+
+/*****************************************************************************
+ * Local and extern prototypes.
+ *****************************************************************************/
+static int  Create( vlc_object_t * );
+static void Convert( filter_t *, picture_t *, picture_t * );
+static picture_t *Convert_Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("YUV to RGBA/BGRA conversions") )
+    set_capability( "video converter", 160 )
+    set_callbacks( Create, NULL )
+vlc_module_end ()
+
+struct filter_sys_t
+{
+    yuv_rgba_conv_t  conv;
+    yuv_rgba_line_cb pf_line;
+};
+
+/*****************************************************************************
+ * Create: allocate a chroma function
+ *****************************************************************************
+ * This function allocates and initializes a chroma function
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_fmt_in = &p_filter->fmt_in.video;
+    const video_format_t *p_fmt_out = &p_filter->fmt_out.video;
+
+    /* resizing not supported */
+    if( p_fmt_in->i_x_offset + p_fmt_in->i_visible_width !=
+            p_fmt_out->i_x_offset + p_fmt_out->i_visible_width
+     || p_fmt_in->i_y_offset + p_fmt_in->i_visible_height !=
+            p_fmt_out->i_y_offset + p_fmt_out->i_visible_height
+     || p_fmt_in->orientation != p_fmt_out->orientation )
+        return VLC_EGENERIC;
+
+    video_color_space_t space = p_fmt_in->space;
+    if( space == COLOR_SPACE_UNDEF )
+        space = p_fmt_in->i_visible_height > 576 ? COLOR_SPACE_BT709
+                                                 : COLOR_SPACE_BT601;
+
+    yuv_rgba_conv_t conv;
+    if( yuv_rgba_Init( &conv, p_fmt_in->i_chroma, p_fmt_out->i_chroma,
+                       space, p_fmt_in->b_color_range_full ) )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = vlc_obj_alloc( p_this, 1, sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    p_sys->conv = conv;
+    p_sys->pf_line = yuv_rgba_GetLine( &p_sys->conv );
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = Convert_Filter;
+
+    msg_Dbg( p_filter, "%4.4s to %4.4s conversion",
+             (const char *)&p_fmt_in->i_chroma,
+             (const char *)&p_fmt_out->i_chroma );
+    return VLC_SUCCESS;
+}
+
+/* Following functions are local */
+VIDEO_FILTER_WRAPPER( Convert )
+
+struct convert_slices
+{
+    picture_t *p_src;
+    picture_t *p_dst;
+};
+
+static void ConvertSlice( filter_t *p_filter, void *opaque,
+                          unsigned i_index, unsigned i_count )
+{
+    const filter_sys_t *p_sys = p_filter->p_sys;
+    const yuv_rgba_conv_t *p_conv = &p_sys->conv;
+    const struct convert_slices *p_slices = opaque;
+    const picture_t *p_src = p_slices->p_src;
+    picture_t *p_dst = p_slices->p_dst;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+    const unsigned i_width = p_fmt->i_x_offset + p_fmt->i_visible_width;
+    const plane_t *p_u = &p_src->p[p_conv->b_swap_uv ? V_PLANE : U_PLANE];
+    const plane_t *p_v = p_conv->i_layout >= YUV_RGBA_SEMIPLANAR ? NULL
+                       : &p_src->p[p_conv->b_swap_uv ? U_PLANE : V_PLANE];
+    filter_slice_t slice;
+
+    filter_GetSlice( &slice, i_index, i_count,
+                     p_fmt->i_y_offset + p_fmt->i_visible_height,
+                     1 << p_conv->i_chroma_shift_y, 0 );
+
+    for( int y = slice.i_start; y < slice.i_end; y++ )
+    {
+        const int cy = y >> p_conv->i_chroma_shift_y;
+
+        p_sys->pf_line( p_conv,
+                        &p_dst->p[0].p_pixels[y * p_dst->p[0].i_pitch],
+                        &p_src->p[Y_PLANE].p_pixels[y * p_src->p[Y_PLANE].i_pitch],
+                        &p_u->p_pixels[cy * p_u->i_pitch],
+                        p_v ? &p_v->p_pixels[cy * p_v->i_pitch] : NULL,
+                        i_width );
+    }
+}
+
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dst )
+{
+    struct convert_slices slices = {
+        .p_src = p_src,
+        .p_dst = p_dst,
+    };
+
+    filter_ExecuteSlices( p_filter, ConvertSlice, &slices );
+}
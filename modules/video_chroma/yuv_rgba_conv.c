@@ -0,0 +1,367 @@
+/*****************************************************************************
+ * yuv_rgba_conv.c: YUV to RGBA/BGRA line converters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_cpu.h>
+
+#include "yuv_rgba_conv.h"
+
+static const struct
+{
+    vlc_fourcc_t i_chroma;
+    uint8_t      i_depth;
+    bool         b_semiplanar;
+    uint8_t      i_shift_x;
+    uint8_t      i_shift_y;
+    bool         b_swap_uv;
+    bool         b_full_range;
+} formats[] = {
+    { VLC_CODEC_I420,     8, false, 1, 1, false, false },
+    { VLC_CODEC_YV12,     8, false, 1, 1, true,  false },
+    { VLC_CODEC_J420,     8, false, 1, 1, false, true  },
+    { VLC_CODEC_I422,     8, false, 1, 0, false, false },
+    { VLC_CODEC_J422,     8, false, 1, 0, false, true  },
+    { VLC_CODEC_I440,     8, false, 0, 1, false, false },
+    { VLC_CODEC_J440,     8, false, 0, 1, false, true  },
+    { VLC_CODEC_I444,     8, false, 0, 0, false, false },
+    { VLC_CODEC_J444,     8, false, 0, 0, false, true  },
+    { VLC_CODEC_I420_9L,  9, false, 1, 1, false, false },
+    { VLC_CODEC_I420_10L, 10, false, 1, 1, false, false },
+    { VLC_CODEC_I420_12L, 12, false, 1, 1, false, false },
+    { VLC_CODEC_I420_16L, 16, false, 1, 1, false, false },
+    { VLC_CODEC_I422_9L,  9, false, 1, 0, false, false },
+    { VLC_CODEC_I422_10L, 10, false, 1, 0, false, false },
+    { VLC_CODEC_I422_12L, 12, false, 1, 0, false, false },
+    { VLC_CODEC_I444_9L,  9, false, 0, 0, false, false },
+    { VLC_CODEC_I444_10L, 10, false, 0, 0, false, false },
+    { VLC_CODEC_I444_12L, 12, false, 0, 0, false, false },
+    { VLC_CODEC_I444_16L, 16, false, 0, 0, false, false },
+    { VLC_CODEC_NV12,     8, true,  1, 1, false, false },
+    { VLC_CODEC_NV16,     8, true,  1, 0, false, false },
+    { VLC_CODEC_NV24,     8, true,  0, 0, false, false },
+    /* 10 bits in the MSB, ie. 16 bits with a coarser step */
+    { VLC_CODEC_P010,     16, true, 1, 1, false, false },
+};
+
+int yuv_rgba_Init( yuv_rgba_conv_t *p_conv, vlc_fourcc_t i_in,
+                   vlc_fourcc_t i_out, video_color_space_t space,
+                   bool b_full_range )
+{
+    if( i_out != VLC_CODEC_RGBA && i_out != VLC_CODEC_BGRA )
+        return VLC_EGENERIC;
+
+    size_t i;
+    for( i = 0; i < ARRAY_SIZE(formats); i++ )
+        if( formats[i].i_chroma == i_in )
+            break;
+    if( i == ARRAY_SIZE(formats) )
+        return VLC_EGENERIC;
+
+    const unsigned i_depth = formats[i].i_depth;
+    b_full_range |= formats[i].b_full_range;
+
+    double kr, kb;
+    switch( space )
+    {
+        case COLOR_SPACE_BT709:
+            kr = 0.2126; kb = 0.0722;
+            break;
+        case COLOR_SPACE_BT2020:
+            kr = 0.2627; kb = 0.0593;
+            break;
+        default:
+            kr = 0.299; kb = 0.114;
+            break;
+    }
+    const double kg = 1. - kr - kb;
+
+    /* Limited range: luma spans 219 steps and chroma 224 */
+    const double y_scale = b_full_range ? 1. : 255. / 219.;
+    const double c_scale = b_full_range ? 1. : 255. / 224.;
+    const double one = 1 << YUV_RGBA_FRAC_BITS;
+
+    const int32_t r_v = lround( 2. * (1. - kr) * c_scale * one );
+    const int32_t g_u = lround( -2. * kb * (1. - kb) / kg * c_scale * one );
+    const int32_t g_v = lround( -2. * kr * (1. - kr) / kg * c_scale * one );
+    const int32_t b_u = lround( 2. * (1. - kb) * c_scale * one );
+    const int r = i_out == VLC_CODEC_RGBA ? 0 : 2;
+
+    p_conv->i_y = lround( y_scale * one );
+    p_conv->i_u[r] = 0;
+    p_conv->i_v[r] = r_v;
+    p_conv->i_u[1] = g_u;
+    p_conv->i_v[1] = g_v;
+    p_conv->i_u[2 - r] = b_u;
+    p_conv->i_v[2 - r] = 0;
+    p_conv->i_y_offset = b_full_range ? 0 : 16 << (i_depth - 8);
+    p_conv->i_c_offset = 128 << (i_depth - 8);
+    p_conv->i_shift = YUV_RGBA_FRAC_BITS + i_depth - 8;
+    p_conv->i_round = 1 << (p_conv->i_shift - 1);
+
+    p_conv->i_sample_size = i_depth > 8 ? 2 : 1;
+    p_conv->i_layout = (formats[i].b_semiplanar ? YUV_RGBA_SEMIPLANAR
+                                                : YUV_RGBA_PLANAR)
+                     + (formats[i].i_shift_x ? 1 : 0);
+    p_conv->i_chroma_shift_x = formats[i].i_shift_x;
+    p_conv->i_chroma_shift_y = formats[i].i_shift_y;
+    p_conv->b_swap_uv = formats[i].b_swap_uv;
+    return VLC_SUCCESS;
+}
+
+static inline unsigned GetSample( const uint8_t *p, unsigned i, unsigned i_size )
+{
+    return i_size == 1 ? p[i] : GetWLE( &p[2 * i] );
+}
+
+/* Reference implementation, used for the end of the lines by the SIMD
+ * ones */
+static void ConvertLineC( const yuv_rgba_conv_t *p_conv, uint8_t *p_dst,
+                          const uint8_t *p_y, const uint8_t *p_u,
+                          const uint8_t *p_v, unsigned i_width )
+{
+    const unsigned i_size = p_conv->i_sample_size;
+    const bool b_sub = p_conv->i_layout == YUV_RGBA_PLANAR_SUB
+                    || p_conv->i_layout == YUV_RGBA_SEMIPLANAR_SUB;
+    const bool b_semi = p_conv->i_layout >= YUV_RGBA_SEMIPLANAR;
+
+    for( unsigned x = 0; x < i_width; x++ )
+    {
+        const unsigned i_chroma = b_sub ? x / 2 : x;
+        int32_t y, u, v;
+
+        y = GetSample( p_y, x, i_size ) - p_conv->i_y_offset;
+        if( b_semi )
+        {
+            u = GetSample( p_u, 2 * i_chroma, i_size );
+            v = GetSample( p_u, 2 * i_chroma + 1, i_size );
+        }
+        else
+        {
+            u = GetSample( p_u, i_chroma, i_size );
+            v = GetSample( p_v, i_chroma, i_size );
+        }
+        u -= p_conv->i_c_offset;
+        v -= p_conv->i_c_offset;
+
+        y = y * p_conv->i_y + p_conv->i_round;
+        for( int i = 0; i < 3; i++ )
+        {
+            int32_t c = (y + u * p_conv->i_u[i] + v * p_conv->i_v[i])
+                        >> p_conv->i_shift;
+            p_dst[4 * x + i] = VLC_CLIP( c, 0, 255 );
+        }
+        p_dst[4 * x + 3] = 255;
+    }
+}
+
+#if defined(HAVE_SSE4_1_INTRINSICS)
+#include <smmintrin.h>
+
+#define VLC_TARGET __attribute__ ((__target__ ("sse4.1")))
+#define RENAME(a) a ## _SSE4_1
+#define vec_t __m128i
+#define STEP 4
+#define OP(op) _mm_ ## op
+#define VAND _mm_and_si128
+#define VOR _mm_or_si128
+#define VSTORE(p, v) _mm_storeu_si128( (__m128i *)(p), v )
+
+VLC_TARGET static inline __m128i Load_SSE4_1( const uint8_t *p,
+                                              unsigned i_size )
+{
+    if( i_size == 1 )
+    {
+        uint32_t i;
+        memcpy( &i, p, sizeof(i) );
+        return _mm_cvtepu8_epi32( _mm_cvtsi32_si128( i ) );
+    }
+    return _mm_cvtepu16_epi32( _mm_loadl_epi64( (const __m128i *)p ) );
+}
+
+VLC_TARGET static inline __m128i LoadDup_SSE4_1( const uint8_t *p,
+                                                 unsigned i_size )
+{
+    __m128i c;
+    if( i_size == 1 )
+    {
+        uint16_t i;
+        memcpy( &i, p, sizeof(i) );
+        c = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( i ) );
+    }
+    else
+    {
+        uint32_t i;
+        memcpy( &i, p, sizeof(i) );
+        c = _mm_cvtepu16_epi32( _mm_cvtsi32_si128( i ) );
+    }
+    return _mm_unpacklo_epi32( c, c );
+}
+
+VLC_TARGET static inline void Deinterleave_SSE4_1( __m128i a, __m128i b,
+                                                   __m128i *u, __m128i *v )
+{
+    *u = _mm_castps_si128( _mm_shuffle_ps( _mm_castsi128_ps( a ),
+                                           _mm_castsi128_ps( b ),
+                                           _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+    *v = _mm_castps_si128( _mm_shuffle_ps( _mm_castsi128_ps( a ),
+                                           _mm_castsi128_ps( b ),
+                                           _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+}
+
+VLC_TARGET static inline void DeinterleaveDup_SSE4_1( __m128i a,
+                                                      __m128i *u, __m128i *v )
+{
+    *u = _mm_shuffle_epi32( a, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+    *v = _mm_shuffle_epi32( a, _MM_SHUFFLE( 3, 3, 1, 1 ) );
+}
+
+#include "yuv_rgba_simd.h"
+
+#undef VLC_TARGET
+#undef RENAME
+#undef vec_t
+#undef STEP
+#undef OP
+#undef VAND
+#undef VOR
+#undef VSTORE
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+#include <immintrin.h>
+
+#define VLC_TARGET __attribute__ ((__target__ ("avx2")))
+#define RENAME(a) a ## _AVX2
+#define vec_t __m256i
+#define STEP 8
+#define OP(op) _mm256_ ## op
+#define VAND _mm256_and_si256
+#define VOR _mm256_or_si256
+#define VSTORE(p, v) _mm256_storeu_si256( (__m256i *)(p), v )
+
+VLC_TARGET static inline __m256i Load_AVX2( const uint8_t *p,
+                                            unsigned i_size )
+{
+    if( i_size == 1 )
+        return _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i *)p ) );
+    return _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i *)p ) );
+}
+
+VLC_TARGET static inline __m256i LoadDup_AVX2( const uint8_t *p,
+                                               unsigned i_size )
+{
+    __m256i c;
+    if( i_size == 1 )
+    {
+        uint32_t i;
+        memcpy( &i, p, sizeof(i) );
+        c = _mm256_cvtepu8_epi32( _mm_cvtsi32_si128( i ) );
+    }
+    else
+        c = _mm256_cvtepu16_epi32( _mm_loadl_epi64( (const __m128i *)p ) );
+    return _mm256_permutevar8x32_epi32( c, _mm256_setr_epi32( 0, 0, 1, 1,
+                                                              2, 2, 3, 3 ) );
+}
+
+VLC_TARGET static inline void Deinterleave_AVX2( __m256i a, __m256i b,
+                                                 __m256i *u, __m256i *v )
+{
+    const __m256i even = _mm256_setr_epi32( 0, 2, 4, 6, 0, 2, 4, 6 );
+    const __m256i odd = _mm256_setr_epi32( 1, 3, 5, 7, 1, 3, 5, 7 );
+
+    *u = _mm256_blend_epi32( _mm256_permutevar8x32_epi32( a, even ),
+                             _mm256_permutevar8x32_epi32( b, even ), 0xF0 );
+    *v = _mm256_blend_epi32( _mm256_permutevar8x32_epi32( a, odd ),
+                             _mm256_permutevar8x32_epi32( b, odd ), 0xF0 );
+}
+
+VLC_TARGET static inline void DeinterleaveDup_AVX2( __m256i a,
+                                                    __m256i *u, __m256i *v )
+{
+    *u = _mm256_permutevar8x32_epi32( a, _mm256_setr_epi32( 0, 0, 2, 2,
+                                                            4, 4, 6, 6 ) );
+    *v = _mm256_permutevar8x32_epi32( a, _mm256_setr_epi32( 1, 1, 3, 3,
+                                                            5, 5, 7, 7 ) );
+}
+
+#include "yuv_rgba_simd.h"
+
+#undef VLC_TARGET
+#undef RENAME
+#undef vec_t
+#undef STEP
+#undef OP
+#undef VAND
+#undef VOR
+#undef VSTORE
+#endif
+
+/* Best first */
+static const struct
+{
+    const char *psz_name;
+    unsigned i_cpu;
+    const yuv_rgba_line_cb (*lines)[YUV_RGBA_LAYOUTS];
+} impls[] = {
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "AVX2", VLC_CPU_AVX2, lines_AVX2 },
+#endif
+#if defined(HAVE_SSE4_1_INTRINSICS)
+    { "SSE4.1", VLC_CPU_SSE4_1, lines_SSE4_1 },
+#endif
+    { "C", 0, NULL },
+};
+
+unsigned yuv_rgba_CountImpl( void )
+{
+    return ARRAY_SIZE(impls);
+}
+
+const char *yuv_rgba_ImplName( unsigned i_impl )
+{
+    return impls[i_impl].psz_name;
+}
+
+yuv_rgba_line_cb yuv_rgba_GetImpl( const yuv_rgba_conv_t *p_conv,
+                                   unsigned i_impl )
+{
+    if( (vlc_CPU() & impls[i_impl].i_cpu) != impls[i_impl].i_cpu )
+        return NULL;
+    if( impls[i_impl].lines == NULL )
+        return ConvertLineC;
+    return impls[i_impl].lines[p_conv->i_sample_size - 1][p_conv->i_layout];
+}
+
+yuv_rgba_line_cb yuv_rgba_GetLine( const yuv_rgba_conv_t *p_conv )
+{
+    for( unsigned i = 0; ; i++ )
+    {
+        yuv_rgba_line_cb pf_line = yuv_rgba_GetImpl( p_conv, i );
+        if( pf_line )
+            return pf_line;
+    }
+}
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ * yuv_rgba_conv.h: YUV to RGBA/BGRA line converters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEOCHROMA_YUV_RGBA_CONV_H_
+#define VLC_VIDEOCHROMA_YUV_RGBA_CONV_H_
+
+/**
+ * Fractional bits of the coefficients, for 8-bit samples. Each extra bit of
+ * depth adds one, so that the products of 16-bit samples still fit in 32
+ * bits.
+ */
+#define YUV_RGBA_FRAC_BITS 13
+
+/* Input sample layouts, each with its own set of line converters */
+enum
+{
+    YUV_RGBA_PLANAR,          /* Y, U and V planes, 4:4:4 */
+    YUV_RGBA_PLANAR_SUB,      /* Y, U and V planes, horizontal 4:2:x */
+    YUV_RGBA_SEMIPLANAR,      /* Y and UV planes, 4:4:4 */
+    YUV_RGBA_SEMIPLANAR_SUB,  /* Y and UV planes, horizontal 4:2:x */
+    YUV_RGBA_LAYOUTS,
+};
+
+typedef struct
+{
+    /* Fixed point coefficients, one set per output byte. The fourth byte
+     * is the opaque alpha. */
+    int32_t  i_y;
+    int32_t  i_u[3];
+    int32_t  i_v[3];
+    int32_t  i_y_offset;
+    int32_t  i_c_offset;
+    int32_t  i_round;
+    unsigned i_shift;
+
+    /* Input description */
+    unsigned i_sample_size; /* in bytes: 1, or 2 for 9 to 16 bits */
+    unsigned i_layout;
+    unsigned i_chroma_shift_x;
+    unsigned i_chroma_shift_y;
+    bool     b_swap_uv;
+} yuv_rgba_conv_t;
+
+/**
+ * Converts one line of i_width pixels.
+ *
+ * For semi-planar layouts, p_u points to the interleaved chroma line and
+ * p_v is unused.
+ */
+typedef void (*yuv_rgba_line_cb)( const yuv_rgba_conv_t *, uint8_t *p_dst,
+                                  const uint8_t *p_y, const uint8_t *p_u,
+                                  const uint8_t *p_v, unsigned i_width );
+
+/**
+ * Sets up the conversion from i_in to i_out (VLC_CODEC_RGBA or
+ * VLC_CODEC_BGRA).
+ *
+ * @return VLC_SUCCESS, or VLC_EGENERIC if the chromas are not handled.
+ */
+int yuv_rgba_Init( yuv_rgba_conv_t *, vlc_fourcc_t i_in, vlc_fourcc_t i_out,
+                   video_color_space_t, bool b_full_range );
+
+/** Number of line converter implementations, the last one is plain C */
+unsigned yuv_rgba_CountImpl( void );
+
+/** Name of an implementation, for logging and benchmarking */
+const char *yuv_rgba_ImplName( unsigned i_impl );
+
+/**
+ * Returns the line converter of the given implementation, or NULL if the
+ * CPU does not support it.
+ */
+yuv_rgba_line_cb yuv_rgba_GetImpl( const yuv_rgba_conv_t *, unsigned i_impl );
+
+/** Returns the fastest line converter supported by the CPU */
+yuv_rgba_line_cb yuv_rgba_GetLine( const yuv_rgba_conv_t * );
+
+#endif
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * yuv_rgba_simd.h: SIMD YUV to RGBA/BGRA line converters template
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Included by yuv_rgba_conv.c, which defines:
+ *  - VLC_TARGET: the function attributes,
+ *  - RENAME(a): the function names,
+ *  - vec_t, STEP and OP(op): the vector type, its number of 32-bit lanes,
+ *    and the intrinsic prefix,
+ *  - VAND, VOR and VSTORE: the operations named after the vector size,
+ *  - and the layout specific helpers:
+ *    RENAME(Load)(p, size): STEP samples, zero extended to 32 bits,
+ *    RENAME(LoadDup)(p, size): STEP / 2 samples, each duplicated,
+ *    RENAME(Deinterleave)(a, b, &u, &v): STEP samples of U and V from
+ *    2 * STEP interleaved ones,
+ *    RENAME(DeinterleaveDup)(a, &u, &v): the same from STEP interleaved
+ *    samples, each duplicated.
+ *
+ * Each pixel is computed exactly as in ConvertLineC(): the luma term with
+ * a 32-bit multiplication, and the chroma terms with a multiply-add of the
+ * (U, V) pairs, which fit in 16 bits once centered. */
+
+VLC_TARGET static inline
+void RENAME(Store)( uint8_t *p_dst, vec_t c0, vec_t c1, vec_t c2 )
+{
+    /* Per 128-bit lane: 4x c0, 4x c1, 4x c2, 4x alpha, then transposed */
+    const vec_t alpha = OP(set1_epi32)( 255 );
+    const vec_t order = OP(setr_epi8)( 0, 4, 8, 12, 1, 5, 9, 13,
+                                       2, 6, 10, 14, 3, 7, 11, 15
+#if STEP == 8
+                                     , 0, 4, 8, 12, 1, 5, 9, 13,
+                                       2, 6, 10, 14, 3, 7, 11, 15
+#endif
+                                     );
+    vec_t v = OP(packus_epi16)( OP(packs_epi32)( c0, c1 ),
+                                OP(packs_epi32)( c2, alpha ) );
+
+    VSTORE( p_dst, OP(shuffle_epi8)( v, order ) );
+}
+
+VLC_TARGET static inline
+void RENAME(ConvertLine)( const yuv_rgba_conv_t *p_conv, uint8_t *p_dst,
+                          const uint8_t *p_y, const uint8_t *p_u,
+                          const uint8_t *p_v, unsigned i_width,
+                          const unsigned i_size, const unsigned i_layout )
+{
+    const vec_t y_offset = OP(set1_epi32)( p_conv->i_y_offset );
+    const vec_t c_offset = OP(set1_epi32)( p_conv->i_c_offset );
+    const vec_t round = OP(set1_epi32)( p_conv->i_round );
+    const vec_t coef_y = OP(set1_epi32)( p_conv->i_y );
+    const vec_t mask = OP(set1_epi32)( 0xFFFF );
+    vec_t coef_uv[3];
+    unsigned x = 0;
+
+    for( int i = 0; i < 3; i++ )
+        coef_uv[i] = OP(set1_epi32)( ((uint32_t)p_conv->i_v[i] << 16)
+                                   | (uint16_t)p_conv->i_u[i] );
+
+    for( ; x + STEP <= i_width; x += STEP )
+    {
+        vec_t y = RENAME(Load)( &p_y[x * i_size], i_size );
+        vec_t u, v;
+
+        switch( i_layout )
+        {
+            case YUV_RGBA_PLANAR:
+                u = RENAME(Load)( &p_u[x * i_size], i_size );
+                v = RENAME(Load)( &p_v[x * i_size], i_size );
+                break;
+            case YUV_RGBA_PLANAR_SUB:
+                u = RENAME(LoadDup)( &p_u[x / 2 * i_size], i_size );
+                v = RENAME(LoadDup)( &p_v[x / 2 * i_size], i_size );
+                break;
+            case YUV_RGBA_SEMIPLANAR:
+                RENAME(Deinterleave)(
+                    RENAME(Load)( &p_u[2 * x * i_size], i_size ),
+                    RENAME(Load)( &p_u[(2 * x + STEP) * i_size], i_size ),
+                    &u, &v );
+                break;
+            default:
+                RENAME(DeinterleaveDup)(
+                    RENAME(Load)( &p_u[x * i_size], i_size ), &u, &v );
+                break;
+        }
+
+        y = OP(add_epi32)( OP(mullo_epi32)( OP(sub_epi32)( y, y_offset ),
+                                            coef_y ), round );
+        u = OP(sub_epi32)( u, c_offset );
+        v = OP(sub_epi32)( v, c_offset );
+
+        vec_t uv = VOR( VAND( u, mask ), OP(slli_epi32)( v, 16 ) );
+        vec_t c[3];
+        for( int i = 0; i < 3; i++ )
+            c[i] = OP(srai_epi32)( OP(add_epi32)( y, OP(madd_epi16)( uv, coef_uv[i] ) ),
+                                   p_conv->i_shift );
+
+        RENAME(Store)( &p_dst[4 * x], c[0], c[1], c[2] );
+    }
+
+    if( x < i_width )
+    {
+        const unsigned i_chroma = i_layout == YUV_RGBA_PLANAR_SUB
+                               || i_layout == YUV_RGBA_SEMIPLANAR_SUB
+                                ? x / 2 : x;
+        const unsigned i_step = i_layout >= YUV_RGBA_SEMIPLANAR ? 2 : 1;
+
+        ConvertLineC( p_conv, &p_dst[4 * x], &p_y[x * i_size],
+                      &p_u[i_chroma * i_step * i_size],
+                      p_v ? &p_v[i_chroma * i_size] : NULL, i_width - x );
+    }
+}
+
+#define YUV_RGBA_LINE(size, layout) \
+VLC_TARGET static void RENAME(ConvertLine##size##_##layout)( \
+        const yuv_rgba_conv_t *p_conv, uint8_t *p_dst, const uint8_t *p_y, \
+        const uint8_t *p_u, const uint8_t *p_v, unsigned i_width ) \
+{ \
+    RENAME(ConvertLine)( p_conv, p_dst, p_y, p_u, p_v, i_width, \
+                         size, YUV_RGBA_##layout ); \
+}
+
+YUV_RGBA_LINE(1, PLANAR)
+YUV_RGBA_LINE(1, PLANAR_SUB)
+YUV_RGBA_LINE(1, SEMIPLANAR)
+YUV_RGBA_LINE(1, SEMIPLANAR_SUB)
+YUV_RGBA_LINE(2, PLANAR)
+YUV_RGBA_LINE(2, PLANAR_SUB)
+YUV_RGBA_LINE(2, SEMIPLANAR)
+YUV_RGBA_LINE(2, SEMIPLANAR_SUB)
+#undef YUV_RGBA_LINE
+
+static const yuv_rgba_line_cb RENAME(lines)[2][YUV_RGBA_LAYOUTS] = {
+    { RENAME(ConvertLine1_PLANAR), RENAME(ConvertLine1_PLANAR_SUB),
+      RENAME(ConvertLine1_SEMIPLANAR), RENAME(ConvertLine1_SEMIPLANAR_SUB) },
+    { RENAME(ConvertLine2_PLANAR), RENAME(ConvertLine2_PLANAR_SUB),
+      RENAME(ConvertLine2_SEMIPLANAR), RENAME(ConvertLine2_SEMIPLANAR_SUB) },
+};
@@ -225,6 +225,133 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
+struct adjust_slices
+{
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    bool b_16bit;
+    const int *pi_luma;
+    int (*pf_process_sat_hue)( picture_t *, picture_t *, int, int, int,
+                               int, int );
+    int i_sin, i_cos, i_sat, i_x, i_y;
+};
+
+/* Makes a picture referencing the lines of a slice of each plane */
+static void SlicePicture( picture_t *p_slice, const picture_t *p_pic,
+                          unsigned i_index, unsigned i_count )
+{
+    memset( p_slice, 0, sizeof(*p_slice) );
+    p_slice->format = p_pic->format;
+    p_slice->i_planes = p_pic->i_planes;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p_plane = &p_slice->p[i];
+        filter_slice_t slice;
+
+        *p_plane = p_pic->p[i];
+        filter_GetSlice( &slice, i_index, i_count,
+                         p_plane->i_visible_lines, 1, 0 );
+        p_plane->p_pixels += slice.i_start * p_plane->i_pitch;
+        p_plane->i_lines = slice.i_end - slice.i_start;
+        p_plane->i_visible_lines = slice.i_end - slice.i_start;
+    }
+}
+
+static void FilterPlanarSlice( filter_t *p_filter, void *opaque,
+                               unsigned i_index, unsigned i_count )
+{
+    VLC_UNUSED(p_filter);
+    const struct adjust_slices *p = opaque;
+    const int *pi_luma = p->pi_luma;
+    picture_t in, out;
+    picture_t *p_in_pic = &in, *p_out_pic = &out;
+
+    SlicePicture( &in, p->p_pic, i_index, i_count );
+    SlicePicture( &out, p->p_outpic, i_index, i_count );
+
+    /*
+     * Do the Y plane
+     */
+    if ( p->b_16bit )
+    {
+        uint16_t *p_in, *p_in_end, *p_line_end;
+        uint16_t *p_out;
+        p_in = (uint16_t *) p_in_pic->p[Y_PLANE].p_pixels;
+        p_in_end = p_in + p_in_pic->p[Y_PLANE].i_visible_lines
+            * (p_in_pic->p[Y_PLANE].i_pitch >> 1) - 8;
+
+        p_out = (uint16_t *) p_out_pic->p[Y_PLANE].p_pixels;
+
+        for( ; p_in < p_in_end ; )
+        {
+            p_line_end = p_in + (p_in_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                /* Do 8 pixels at a time */
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_line_end += 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_in += (p_in_pic->p[Y_PLANE].i_pitch >> 1)
+                - (p_in_pic->p[Y_PLANE].i_visible_pitch >> 1);
+            p_out += (p_out_pic->p[Y_PLANE].i_pitch >> 1)
+                - (p_out_pic->p[Y_PLANE].i_visible_pitch >> 1);
+        }
+    }
+    else
+    {
+        uint8_t *p_in, *p_in_end, *p_line_end;
+        uint8_t *p_out;
+        p_in = p_in_pic->p[Y_PLANE].p_pixels;
+        p_in_end = p_in + p_in_pic->p[Y_PLANE].i_visible_lines
+                 * p_in_pic->p[Y_PLANE].i_pitch - 8;
+
+        p_out = p_out_pic->p[Y_PLANE].p_pixels;
+
+        for( ; p_in < p_in_end ; )
+        {
+            p_line_end = p_in + p_in_pic->p[Y_PLANE].i_visible_pitch - 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                /* Do 8 pixels at a time */
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_line_end += 8;
+
+            for( ; p_in < p_line_end ; )
+            {
+                *p_out++ = pi_luma[ *p_in++ ];
+            }
+
+            p_in += p_in_pic->p[Y_PLANE].i_pitch
+                  - p_in_pic->p[Y_PLANE].i_visible_pitch;
+            p_out += p_out_pic->p[Y_PLANE].i_pitch
+                   - p_out_pic->p[Y_PLANE].i_visible_pitch;
+        }
+    }
+
+    /* Currently no errors are implemented in the function, if any are added
+     * check them here */
+    p->pf_process_sat_hue( p_in_pic, p_out_pic, p->i_sin, p->i_cos, p->i_sat,
+                           p->i_x, p->i_y );
+}
+
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
@@ -317,106 +444,30 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     }
 
     /*
-     * Do the Y plane
+     * Do the planes, by slices
      */
-    if ( b_16bit )
-    {
-        uint16_t *p_in, *p_in_end, *p_line_end;
-        uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
-
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
-        }
-    }
-    else
-    {
-        uint8_t *p_in, *p_in_end, *p_line_end;
-        uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
-
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
 
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
+    struct adjust_slices slices = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .b_16bit = b_16bit,
+        .pi_luma = pi_luma,
+        .i_sat = i_sat,
+    };
 
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
-        }
-    }
-
-    /*
-     * Do the U and V planes
-     */
-
-    int i_sin = sinf(f_hue) * f_max;
-    int i_cos = cosf(f_hue) * f_max;
+    slices.i_sin = sinf(f_hue) * f_max;
+    slices.i_cos = cosf(f_hue) * f_max;
 
     /* pow(2, (bpp * 2) - 1) */
-    int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
-    int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
+    slices.i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
+    slices.i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
     if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
+        slices.pf_process_sat_hue = p_sys->pf_process_sat_hue_clip;
     else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
+        slices.pf_process_sat_hue = p_sys->pf_process_sat_hue;
+
+    filter_ExecuteSlices( p_filter, FilterPlanarSlice, &slices );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -38,6 +38,7 @@
 #include <vlc_picture.h>
 #include <vlc_filter.h>
 
+#include "../filter_picture.h"
 #include "deinterlace.h" /* filter_sys_t */
 #include "helpers.h"     /* ComposeFrame() */
 
@@ -66,12 +67,15 @@
  * @param p_dst Input/output picture. Will be modified in-place.
  * @param i_field Darken which field? 0 = top, 1 = bottom.
  * @param i_strength Strength of effect: 1, 2 or 3 (division by 2, 4 or 8).
+ * @param i_index Slice to process.
+ * @param i_count Number of slices.
  * @see RenderPhosphor()
  * @see ComposeFrame()
  */
 static void DarkenField( picture_t *p_dst,
                          const int i_field, const int i_strength,
-                         bool process_chroma )
+                         bool process_chroma,
+                         unsigned i_index, unsigned i_count )
 {
     assert( p_dst != NULL );
     assert( i_field == 0 || i_field == 1 );
@@ -93,9 +97,13 @@ static void DarkenField( picture_t *p_dst,
     int i_plane = Y_PLANE;
     uint8_t *p_out, *p_out_end;
     int w = p_dst->p[i_plane].i_visible_pitch;
-    p_out = p_dst->p[i_plane].p_pixels;
-    p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                      * p_dst->p[i_plane].i_visible_lines;
+    filter_slice_t slice;
+    filter_GetSlice( &slice, i_index, i_count,
+                     p_dst->p[i_plane].i_visible_lines, 2, 0 );
+    p_out = p_dst->p[i_plane].p_pixels
+          + p_dst->p[i_plane].i_pitch * slice.i_start;
+    p_out_end = p_dst->p[i_plane].p_pixels + p_dst->p[i_plane].i_pitch
+                                            * slice.i_end;
 
     /* skip first line for bottom field */
     if( i_field == 1 )
@@ -130,9 +138,12 @@ static void DarkenField( picture_t *p_dst,
              i_plane++ )
         {
             int w = p_dst->p[i_plane].i_visible_pitch;
-            p_out = p_dst->p[i_plane].p_pixels;
-            p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                              * p_dst->p[i_plane].i_visible_lines;
+            filter_GetSlice( &slice, i_index, i_count,
+                             p_dst->p[i_plane].i_visible_lines, 2, 0 );
+            p_out = p_dst->p[i_plane].p_pixels
+                  + p_dst->p[i_plane].i_pitch * slice.i_start;
+            p_out_end = p_dst->p[i_plane].p_pixels
+                      + p_dst->p[i_plane].i_pitch * slice.i_end;
 
             /* skip first line for bottom field */
             if( i_field == 1 )
@@ -153,7 +164,8 @@ static void DarkenField( picture_t *p_dst,
 VLC_MMX
 static void DarkenFieldMMX( picture_t *p_dst,
                             const int i_field, const int i_strength,
-                            bool process_chroma )
+                            bool process_chroma,
+                            unsigned i_index, unsigned i_count )
 {
     assert( p_dst != NULL );
     assert( i_field == 0 || i_field == 1 );
@@ -167,9 +179,13 @@ static void DarkenFieldMMX( picture_t *p_dst,
     int i_plane = Y_PLANE;
     uint8_t *p_out, *p_out_end;
     int w = p_dst->p[i_plane].i_visible_pitch;
-    p_out = p_dst->p[i_plane].p_pixels;
-    p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                      * p_dst->p[i_plane].i_visible_lines;
+    filter_slice_t slice;
+    filter_GetSlice( &slice, i_index, i_count,
+                     p_dst->p[i_plane].i_visible_lines, 2, 0 );
+    p_out = p_dst->p[i_plane].p_pixels
+          + p_dst->p[i_plane].i_pitch * slice.i_start;
+    p_out_end = p_dst->p[i_plane].p_pixels + p_dst->p[i_plane].i_pitch
+                                            * slice.i_end;
 
     /* skip first line for bottom field */
     if( i_field == 1 )
@@ -216,9 +232,12 @@ static void DarkenFieldMMX( picture_t *p_dst,
             int wm8 = w % 8;   /* remainder */
             int w8  = w - wm8; /* part of width that is divisible by 8 */
 
-            p_out = p_dst->p[i_plane].p_pixels;
-            p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                              * p_dst->p[i_plane].i_visible_lines;
+            filter_GetSlice( &slice, i_index, i_count,
+                             p_dst->p[i_plane].i_visible_lines, 2, 0 );
+            p_out = p_dst->p[i_plane].p_pixels
+                  + p_dst->p[i_plane].i_pitch * slice.i_start;
+            p_out_end = p_dst->p[i_plane].p_pixels
+                      + p_dst->p[i_plane].i_pitch * slice.i_end;
 
             /* skip first line for bottom field */
             if( i_field == 1 )
@@ -272,6 +291,32 @@ static void DarkenFieldMMX( picture_t *p_dst,
 }
 #endif
 
+struct darken_slices
+{
+    picture_t *p_dst;
+    int i_field;
+    int i_strength;
+    bool process_chroma;
+};
+
+/* The slices start on even lines, so that the field lines are the same
+ * as in the whole picture */
+static void DarkenFieldSlice( filter_t *p_filter, void *opaque,
+                              unsigned i_index, unsigned i_count )
+{
+    VLC_UNUSED(p_filter);
+    const struct darken_slices *p = opaque;
+
+#ifdef CAN_COMPILE_MMXEXT
+    if( vlc_CPU_MMXEXT() )
+        DarkenFieldMMX( p->p_dst, p->i_field, p->i_strength,
+                        p->process_chroma, i_index, i_count );
+    else
+#endif
+        DarkenField( p->p_dst, p->i_field, p->i_strength,
+                     p->process_chroma, i_index, i_count );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -358,16 +403,16 @@ int RenderPhosphor( filter_t *p_filter,
     */
     if( p_sys->phosphor.i_dimmer_strength > 0 )
     {
-#ifdef CAN_COMPILE_MMXEXT
-        if( vlc_CPU_MMXEXT() )
-            DarkenFieldMMX( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
+        struct darken_slices slices = {
+            .p_dst = p_dst,
+            .i_field = !i_field,
+            .i_strength = p_sys->phosphor.i_dimmer_strength,
+            .process_chroma =
                 p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
-                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
-        else
-#endif
-            DarkenField( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
-                p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
-                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
+                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den,
+        };
+
+        filter_ExecuteSlices( p_filter, DarkenFieldSlice, &slices );
     }
     return VLC_SUCCESS;
 }
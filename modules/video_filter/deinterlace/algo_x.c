@@ -34,7 +34,9 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
+#include "../filter_picture.h"
 #include "deinterlace.h" /* filter_sys_t */
 
 #include "algo_x.h"
@@ -512,9 +514,21 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+struct x_slices
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+};
+
+/* The slices are made of whole 8x8 block rows, the last slice also handles
+ * the remaining lines */
+static void RenderXSlice( filter_t *p_filter, void *opaque,
+                          unsigned i_index, unsigned i_count )
 {
     VLC_UNUSED(p_filter);
+    const struct x_slices *p = opaque;
+    picture_t *p_outpic = p->p_outpic;
+    picture_t *p_pic = p->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -532,9 +546,12 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
+        filter_slice_t slice;
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        filter_GetSlice( &slice, i_index, i_count, i_mby, 1, 0 );
+
+        for( y = slice.i_start; y < slice.i_end; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -548,7 +565,7 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && i_index == i_count - 1 )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -570,5 +587,15 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    struct x_slices slices = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+    };
+
+    filter_ExecuteSlices( p_filter, RenderXSlice, &slices );
     return VLC_SUCCESS;
 }
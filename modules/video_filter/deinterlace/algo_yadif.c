@@ -34,6 +34,7 @@
 #include <vlc_picture.h>
 #include <vlc_filter.h>
 
+#include "../filter_picture.h"
 #include "deinterlace.h" /* filter_sys_t  */
 #include "common.h"      /* FFMIN3 et al. */
 
@@ -47,6 +48,81 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+/* The 16-bit variants take uint16_t lines: they are cast to this type */
+typedef void (*yadif_filter_line_fn)(uint8_t *dst, uint8_t *prev,
+                                     uint8_t *cur, uint8_t *next, int w,
+                                     int prefs, int mrefs, int parity,
+                                     int mode);
+
+struct yadif_slices
+{
+    picture_t *p_dst;
+    const picture_t *p_prev, *p_cur, *p_next;
+    yadif_filter_line_fn filter;
+    int i_pixel_size;
+    int i_field;
+    int i_parity;
+};
+
+/* Each line only depends on the input pictures, so the slices need no
+ * overlap */
+static void RenderYadifSlice( filter_t *p_filter, void *opaque,
+                              unsigned i_index, unsigned i_count )
+{
+    VLC_UNUSED(p_filter);
+    const struct yadif_slices *p = opaque;
+    picture_t *p_dst = p->p_dst;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &p->p_prev->p[n];
+        const plane_t *curp  = &p->p_cur->p[n];
+        const plane_t *nextp = &p->p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+        filter_slice_t slice;
+
+        filter_GetSlice( &slice, i_index, i_count,
+                         dstp->i_visible_lines, 1, 0 );
+
+        for( int y = __MAX( slice.i_start, 1 );
+             y < __MIN( slice.i_end, dstp->i_visible_lines - 1 ); y++ )
+        {
+            if( (y % 2) == p->i_field  ||  p->i_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                p->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                           &prevp->p_pixels[y * prevp->i_pitch],
+                           &curp->p_pixels[y * curp->i_pitch],
+                           &nextp->p_pixels[y * nextp->i_pitch],
+                           dstp->i_visible_pitch / p->i_pixel_size,
+                           y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                           y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                           p->i_parity,
+                           mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -109,74 +185,50 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
+        struct yadif_slices slices = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .i_pixel_size = p_sys->chroma->pixel_size,
+            .i_field = i_field,
+            .i_parity = yadif_parity,
+        };
+
+#if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU_AVX2() )
+            slices.filter = yadif_filter_line_avx2;
+        else
+#endif
 #if defined(HAVE_YADIF_SSSE3)
         if( vlc_CPU_SSSE3() )
-            filter = yadif_filter_line_ssse3;
+            slices.filter = yadif_filter_line_ssse3;
         else
 #endif
 #if defined(HAVE_YADIF_SSE2)
         if( vlc_CPU_SSE2() )
-            filter = yadif_filter_line_sse2;
+            slices.filter = yadif_filter_line_sse2;
         else
 #endif
 #if defined(HAVE_YADIF_MMX)
         if( vlc_CPU_MMX() )
-            filter = yadif_filter_line_mmx;
+            slices.filter = yadif_filter_line_mmx;
         else
 #endif
-            filter = yadif_filter_line_c;
+            slices.filter = yadif_filter_line_c;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
-        for( int n = 0; n < p_dst->i_planes; n++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+#if defined(HAVE_YADIF_AVX2)
+            if( vlc_CPU_AVX2() )
+                slices.filter = (yadif_filter_line_fn)yadif_filter_line_avx2_16bit;
+            else
+#endif
+                slices.filter = (yadif_filter_line_fn)yadif_filter_line_c_16bit;
         }
 
+        filter_ExecuteSlices( p_filter, RenderYadifSlice, &slices );
+
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
         return VLC_SUCCESS;
@@ -0,0 +1,271 @@
+/*****************************************************************************
+ * bench.c : benchmark and test of the deinterlacer line routines
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "common.h"
+#include "merge.h"
+#include "yadif.h"
+
+/* Runs every merge and Yadif line routine usable on this CPU on the same
+ * random lines, checks their output against the generic C routine and
+ * prints the time they took.
+ *
+ * Usage: deinterlace_bench [iterations]
+ */
+
+#define WIDTH 1917 /* not a multiple of the SIMD widths, to test the tails */
+#define PITCH 4096 /* in bytes, enough for WIDTH 16-bit pixels */
+#define LINES 5    /* Yadif reads two lines above and below */
+#define MARGIN 64  /* Yadif reads a few pixels before and after the line */
+
+typedef void (*merge_fn)( void *, const void *, const void *, size_t );
+typedef void (*yadif_fn)( uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                          int, int, int, int, int );
+
+static unsigned i_loops = 2000;
+static uint8_t *p_buffers[3], *p_ref, *p_out;
+
+static uint8_t *Line( uint8_t *p_buffer, int i_line )
+{
+    return &p_buffer[MARGIN + i_line * PITCH];
+}
+
+static void Fill( unsigned i_seed )
+{
+    srand( i_seed );
+    for( int i = 0; i < 3; i++ )
+        for( int j = 0; j < MARGIN + LINES * PITCH + MARGIN; j++ )
+            p_buffers[i][j] = rand();
+}
+
+/* The SIMD routines using pavgb/pavgw round up */
+static bool Compare( const uint8_t *p_a, const uint8_t *p_b, size_t i_bytes,
+                     int i_pixel_size, int i_tolerance )
+{
+    for( size_t i = 0; i < i_bytes; i += i_pixel_size )
+    {
+        int a = i_pixel_size == 1 ? p_a[i] : *(const uint16_t *)&p_a[i];
+        int b = i_pixel_size == 1 ? p_b[i] : *(const uint16_t *)&p_b[i];
+        if( abs( a - b ) > i_tolerance )
+        {
+            fprintf( stderr, "mismatch at pixel %zu: %d instead of %d\n",
+                     i / i_pixel_size, a, b );
+            return false;
+        }
+    }
+    return true;
+}
+
+static int BenchMerge( const char *psz_name, merge_fn pf_merge,
+                       void (*pf_end)( void ), int i_pixel_size,
+                       int i_tolerance )
+{
+    const size_t i_bytes = WIDTH * i_pixel_size;
+    merge_fn pf_ref = i_pixel_size == 1 ? Merge8BitGeneric
+                                        : Merge16BitGeneric;
+    int ret = 0;
+
+    /* Also test unaligned lines */
+    for( int i_offset = 0; i_offset < 2 * i_pixel_size; i_offset += i_pixel_size )
+    {
+        uint8_t *p_s1 = Line( p_buffers[0], 0 ) + i_offset;
+        uint8_t *p_s2 = Line( p_buffers[1], 0 );
+
+        pf_ref( p_ref, p_s1, p_s2, i_bytes );
+        memset( p_out, 0, PITCH );
+        pf_merge( p_out, p_s1, p_s2, i_bytes );
+        if( pf_end )
+            pf_end();
+        if( !Compare( p_out, p_ref, i_bytes, i_pixel_size, i_tolerance ) )
+            ret = 1;
+    }
+
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < i_loops; i++ )
+        pf_merge( p_out, Line( p_buffers[0], i % LINES ),
+                  Line( p_buffers[1], i % LINES ), i_bytes );
+    if( pf_end )
+        pf_end();
+    mtime_t i_time = mdate() - i_start;
+
+    printf( "merge %2d-bit %-8s %8"PRId64" us %s\n", 8 * i_pixel_size,
+            psz_name, i_time, ret ? "FAILED" : "ok" );
+    return ret;
+}
+
+static int BenchYadif( const char *psz_name, yadif_fn pf_filter,
+                       int i_pixel_size )
+{
+    yadif_fn pf_ref = i_pixel_size == 1 ? yadif_filter_line_c
+                                        : (yadif_fn)yadif_filter_line_c_16bit;
+    int ret = 0;
+
+    for( int i_parity = 0; i_parity < 2; i_parity++ )
+    {
+        for( int i_mode = 0; i_mode <= 2; i_mode += 2 )
+        {
+            uint8_t *pp_line[3];
+            for( int i = 0; i < 3; i++ )
+                pp_line[i] = Line( p_buffers[i], 2 );
+
+            pf_ref( p_ref, pp_line[0], pp_line[1], pp_line[2], WIDTH,
+                    PITCH, -PITCH, i_parity, i_mode );
+            memset( p_out, 0, PITCH );
+            pf_filter( p_out, pp_line[0], pp_line[1], pp_line[2], WIDTH,
+                       PITCH, -PITCH, i_parity, i_mode );
+#if defined(CAN_COMPILE_MMX)
+            if( vlc_CPU_MMX() )
+                __asm__ __volatile__ ( "emms" );
+#endif
+            if( !Compare( p_out, p_ref, WIDTH * i_pixel_size,
+                          i_pixel_size, 0 ) )
+                ret = 1;
+        }
+    }
+
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < i_loops; i++ )
+        pf_filter( p_out, Line( p_buffers[0], 2 ), Line( p_buffers[1], 2 ),
+                   Line( p_buffers[2], 2 ), WIDTH, PITCH, -PITCH, i & 1, 0 );
+#if defined(CAN_COMPILE_MMX)
+    if( vlc_CPU_MMX() )
+        __asm__ __volatile__ ( "emms" );
+#endif
+    mtime_t i_time = mdate() - i_start;
+
+    printf( "yadif %2d-bit %-8s %8"PRId64" us %s\n", 8 * i_pixel_size,
+            psz_name, i_time, ret ? "FAILED" : "ok" );
+    return ret;
+}
+
+static int BenchMerge8( void )
+{
+    int ret = BenchMerge( "C", Merge8BitGeneric, NULL, 1, 0 );
+
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        ret |= BenchMerge( "AVX2", Merge8BitAVX2, NULL, 1, 1 );
+#endif
+#if defined(CAN_COMPILE_SSE2)
+    if( vlc_CPU_SSE2() )
+        ret |= BenchMerge( "SSE2", Merge8BitSSE2, EndMMX, 1, 1 );
+#endif
+#if defined(CAN_COMPILE_MMXEXT)
+    if( vlc_CPU_MMXEXT() )
+        ret |= BenchMerge( "MMXEXT", MergeMMXEXT, EndMMX, 1, 1 );
+#endif
+#if defined(CAN_COMPILE_3DNOW)
+    if( vlc_CPU_3dNOW() )
+        ret |= BenchMerge( "3DNow", Merge3DNow, End3DNow, 1, 1 );
+#endif
+#if defined(CAN_COMPILE_C_ALTIVEC)
+    if( vlc_CPU_ALTIVEC() )
+        ret |= BenchMerge( "Altivec", MergeAltivec, NULL, 1, 1 );
+#endif
+    return ret;
+}
+
+static int BenchMerge16( void )
+{
+    int ret = BenchMerge( "C", Merge16BitGeneric, NULL, 2, 0 );
+
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        ret |= BenchMerge( "AVX2", Merge16BitAVX2, NULL, 2, 1 );
+#endif
+#if defined(CAN_COMPILE_SSE2)
+    if( vlc_CPU_SSE2() )
+        ret |= BenchMerge( "SSE2", Merge16BitSSE2, EndMMX, 2, 1 );
+#endif
+    return ret;
+}
+
+static int BenchYadif8( void )
+{
+    int ret = BenchYadif( "C", yadif_filter_line_c, 1 );
+
+#if defined(HAVE_YADIF_AVX2)
+    if( vlc_CPU_AVX2() )
+        ret |= BenchYadif( "AVX2", yadif_filter_line_avx2, 1 );
+#endif
+#if defined(HAVE_YADIF_SSSE3)
+    if( vlc_CPU_SSSE3() )
+        ret |= BenchYadif( "SSSE3", yadif_filter_line_ssse3, 1 );
+#endif
+#if defined(HAVE_YADIF_SSE2)
+    if( vlc_CPU_SSE2() )
+        ret |= BenchYadif( "SSE2", yadif_filter_line_sse2, 1 );
+#endif
+#if defined(HAVE_YADIF_MMX)
+    if( vlc_CPU_MMX() )
+        ret |= BenchYadif( "MMX", yadif_filter_line_mmx, 1 );
+#endif
+    return ret;
+}
+
+static int BenchYadif16( void )
+{
+    int ret = BenchYadif( "C", (yadif_fn)yadif_filter_line_c_16bit, 2 );
+
+#if defined(HAVE_YADIF_AVX2)
+    if( vlc_CPU_AVX2() )
+        ret |= BenchYadif( "AVX2", (yadif_fn)yadif_filter_line_avx2_16bit, 2 );
+#endif
+    return ret;
+}
+
+int main( int argc, char *argv[] )
+{
+    if( argc > 1 )
+        i_loops = strtoul( argv[1], NULL, 0 );
+
+    for( int i = 0; i < 3; i++ )
+        p_buffers[i] = malloc( MARGIN + LINES * PITCH + MARGIN );
+    p_ref = malloc( PITCH );
+    p_out = malloc( PITCH );
+    if( !p_buffers[0] || !p_buffers[1] || !p_buffers[2] || !p_ref || !p_out )
+        abort();
+
+    int ret = 0;
+    for( unsigned i_seed = 0; i_seed < 2; i_seed++ )
+    {
+        Fill( i_seed );
+        ret |= BenchMerge8();
+        ret |= BenchMerge16();
+        ret |= BenchYadif8();
+        ret |= BenchYadif16();
+    }
+
+    for( int i = 0; i < 3; i++ )
+        free( p_buffers[i] );
+    free( p_ref );
+    free( p_out );
+    return ret;
+}
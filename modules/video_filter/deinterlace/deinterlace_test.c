@@ -0,0 +1,122 @@
+/*****************************************************************************
+ * deinterlace_test.c: AVX2 deinterlacer line routines test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "common.h"
+#include "merge.h"
+#include "yadif.h"
+
+#define WIDTH 1917 /* not a multiple of the SIMD widths, to test the tails */
+#define PITCH 4096 /* in bytes, enough for WIDTH 16-bit pixels */
+#define MARGIN 64  /* Yadif reads a few pixels before and after the line */
+
+typedef void (*merge_fn)( void *, const void *, const void *, size_t );
+typedef void (*yadif_fn)( uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                          int, int, int, int, int );
+
+/* Five lines: Yadif reads two lines above and below the current one */
+static uint8_t src[3][MARGIN + 5 * PITCH + MARGIN];
+static uint8_t ref[PITCH], out[PITCH];
+
+static uint8_t *Line( int i_buffer, int i_line )
+{
+    return &src[i_buffer][MARGIN + i_line * PITCH];
+}
+
+/* The AVX2 merge rounds up (vpavgb/vpavgw), the C one down */
+static void CheckLine( int i_pixel_size, int i_tolerance )
+{
+    for( size_t i = 0; i < WIDTH * (size_t)i_pixel_size; i += i_pixel_size )
+    {
+        int a = i_pixel_size == 1 ? out[i] : *(const uint16_t *)&out[i];
+        int b = i_pixel_size == 1 ? ref[i] : *(const uint16_t *)&ref[i];
+        assert( abs( a - b ) <= i_tolerance );
+    }
+}
+
+#if defined(HAVE_AVX2_INTRINSICS)
+static void TestMerge( merge_fn pf_merge, merge_fn pf_ref,
+                       int i_pixel_size )
+{
+    /* Also test unaligned lines */
+    for( int i_offset = 0; i_offset < 2 * i_pixel_size; i_offset += i_pixel_size )
+    {
+        pf_ref( ref, Line( 0, 0 ) + i_offset, Line( 1, 0 ), WIDTH * i_pixel_size );
+        memset( out, 0, sizeof (out) );
+        pf_merge( out, Line( 0, 0 ) + i_offset, Line( 1, 0 ), WIDTH * i_pixel_size );
+        CheckLine( i_pixel_size, 1 );
+    }
+}
+#endif
+
+#if defined(HAVE_YADIF_AVX2)
+static void TestYadif( yadif_fn pf_filter, yadif_fn pf_ref, int i_pixel_size )
+{
+    for( int i_parity = 0; i_parity < 2; i_parity++ )
+        for( int i_mode = 0; i_mode <= 2; i_mode += 2 )
+        {
+            pf_ref( ref, Line( 0, 2 ), Line( 1, 2 ), Line( 2, 2 ), WIDTH,
+                    PITCH, -PITCH, i_parity, i_mode );
+            memset( out, 0, sizeof (out) );
+            pf_filter( out, Line( 0, 2 ), Line( 1, 2 ), Line( 2, 2 ), WIDTH,
+                       PITCH, -PITCH, i_parity, i_mode );
+            CheckLine( i_pixel_size, 0 );
+        }
+}
+#endif
+
+int main( void )
+{
+#if !defined(HAVE_AVX2_INTRINSICS) && !defined(HAVE_YADIF_AVX2)
+    return 77;
+#endif
+    if( !vlc_CPU_AVX2() )
+        return 77;
+
+    for( unsigned i_seed = 0; i_seed < 4; i_seed++ )
+    {
+        srand( i_seed );
+        for( int i = 0; i < 3; i++ )
+            for( size_t j = 0; j < sizeof (src[i]); j++ )
+                src[i][j] = rand();
+
+#if defined(HAVE_AVX2_INTRINSICS)
+        TestMerge( Merge8BitAVX2, Merge8BitGeneric, 1 );
+        TestMerge( Merge16BitAVX2, Merge16BitGeneric, 2 );
+#endif
+#if defined(HAVE_YADIF_AVX2)
+        TestYadif( yadif_filter_line_avx2, yadif_filter_line_c, 1 );
+        TestYadif( (yadif_fn)yadif_filter_line_avx2_16bit,
+                   (yadif_fn)yadif_filter_line_c_16bit, 2 );
+#endif
+    }
+    return 0;
+}
@@ -147,3 +147,45 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#if defined(HAVE_AVX2_INTRINSICS)
+// ================ AVX2 =================
+#include <immintrin.h>
+#define HAVE_YADIF_AVX2
+
+/* 8-bit: 16 pixels per iteration, in 16-bit lanes */
+#define pixel_t uint8_t
+#define RENAME(a) a ## _avx2
+#define AVX2_STEP 16
+#define AVX2_LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define AVX2_STORE(p,v) _mm_storeu_si128((__m128i *)(p), \
+    _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define AVX2_OP(op) _mm256_ ## op ## _epi16
+#define AVX2_TAIL yadif_filter_line_c
+#include "yadif_avx2.h"
+#undef pixel_t
+#undef RENAME
+#undef AVX2_STEP
+#undef AVX2_LOAD
+#undef AVX2_STORE
+#undef AVX2_OP
+#undef AVX2_TAIL
+
+/* 16-bit: 8 pixels per iteration, in 32-bit lanes */
+#define pixel_t uint16_t
+#define RENAME(a) a ## _avx2_16bit
+#define AVX2_STEP 8
+#define AVX2_LOAD(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define AVX2_STORE(p,v) _mm_storeu_si128((__m128i *)(p), \
+    _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define AVX2_OP(op) _mm256_ ## op ## _epi32
+#define AVX2_TAIL yadif_filter_line_c_16bit
+#include "yadif_avx2.h"
+#undef pixel_t
+#undef RENAME
+#undef AVX2_STEP
+#undef AVX2_LOAD
+#undef AVX2_STORE
+#undef AVX2_OP
+#undef AVX2_TAIL
+#endif
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * yadif_avx2.h : AVX2 version of the Yadif line filter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *****************************************************************************/
+
+/* Template included by yadif.h, which defines:
+ *  - RENAME(a): the function name,
+ *  - pixel_t: the sample type,
+ *  - AVX2_STEP: the number of pixels per iteration,
+ *  - AVX2_LOAD(p)/AVX2_STORE(p,v): to widen the samples to signed lanes
+ *    and back,
+ *  - AVX2_OP(op): the lane operation, ie. _mm256_<op>_epi16 or _epi32,
+ *  - AVX2_TAIL: the C function for the remaining pixels.
+ *
+ * It computes the exact same thing as the FILTER macro. The lanes are
+ * wide enough for all intermediate values, and the result always lies
+ * within the input range so that the narrowing never saturates. */
+
+#define VADD(a,b)   AVX2_OP(add)(a, b)
+#define VSUB(a,b)   AVX2_OP(sub)(a, b)
+#define VMIN(a,b)   AVX2_OP(min)(a, b)
+#define VMAX(a,b)   AVX2_OP(max)(a, b)
+#define VABS(a)     AVX2_OP(abs)(a)
+#define VAVG(a,b)   AVX2_OP(srai)(VADD(a, b), 1)
+#define VABSDIFF(a,b) VABS(VSUB(AVX2_LOAD(a), AVX2_LOAD(b)))
+#define VSCORE(j) \
+    VADD(VADD(VABSDIFF(&cur[x+mrefs-1+(j)], &cur[x+prefs-1-(j)]), \
+            VABSDIFF(&cur[x+mrefs  +(j)], &cur[x+prefs  -(j)])), \
+            VABSDIFF(&cur[x+mrefs+1+(j)], &cur[x+prefs+1-(j)]))
+#define VPRED(j) \
+    VAVG(AVX2_LOAD(&cur[x+mrefs+(j)]), AVX2_LOAD(&cur[x+prefs-(j)]))
+/* Lanes where the new score is better, and where the previous check of
+ * the same side passed, as the C version nests them */
+#define VCHECK(j, cond) \
+    do { \
+        __m256i score = VSCORE(j); \
+        mask = _mm256_and_si256(cond, AVX2_OP(cmpgt)(spatial_score, score)); \
+        spatial_score = _mm256_blendv_epi8(spatial_score, score, mask); \
+        spatial_pred = _mm256_blendv_epi8(spatial_pred, VPRED(j), mask); \
+    } while(0)
+
+__attribute__ ((__target__ ("avx2")))
+static void RENAME(yadif_filter_line)(pixel_t *dst, pixel_t *prev, pixel_t *cur, pixel_t *next, int w, int prefs, int mrefs, int parity, int mode)
+{
+    pixel_t *prev2 = parity ? prev : cur ;
+    pixel_t *next2 = parity ? cur  : next;
+    const int prefs_bytes = prefs, mrefs_bytes = mrefs;
+    const __m256i ones = _mm256_set1_epi8(-1);
+    int x = 0;
+
+    prefs /= (int)sizeof(pixel_t);
+    mrefs /= (int)sizeof(pixel_t);
+
+    for (; x + AVX2_STEP <= w; x += AVX2_STEP) {
+        __m256i c  = AVX2_LOAD(&cur[x+mrefs]);
+        __m256i e  = AVX2_LOAD(&cur[x+prefs]);
+        __m256i p2 = AVX2_LOAD(&prev2[x]);
+        __m256i n2 = AVX2_LOAD(&next2[x]);
+        __m256i d  = VAVG(p2, n2);
+        __m256i temporal_diff0 = VABS(VSUB(p2, n2));
+        __m256i temporal_diff1 = AVX2_OP(srai)(
+                VADD(VABS(VSUB(AVX2_LOAD(&prev[x+mrefs]), c)),
+                    VABS(VSUB(AVX2_LOAD(&prev[x+prefs]), e))), 1);
+        __m256i temporal_diff2 = AVX2_OP(srai)(
+                VADD(VABS(VSUB(AVX2_LOAD(&next[x+mrefs]), c)),
+                    VABS(VSUB(AVX2_LOAD(&next[x+prefs]), e))), 1);
+        __m256i diff = VMAX(VMAX(AVX2_OP(srai)(temporal_diff0, 1),
+                               temporal_diff1), temporal_diff2);
+        __m256i spatial_pred = VAVG(c, e);
+        __m256i spatial_score =
+            VADD(VADD(VABSDIFF(&cur[x+mrefs-1], &cur[x+prefs-1]), VABS(VSUB(c, e))),
+                VABSDIFF(&cur[x+mrefs+1], &cur[x+prefs+1]));
+        __m256i mask;
+
+        spatial_score = VADD(spatial_score, ones); /* - 1 */
+
+        VCHECK(-1, ones);
+        VCHECK(-2, mask);
+        VCHECK( 1, ones);
+        VCHECK( 2, mask);
+
+        if (mode < 2) {
+            __m256i b = VAVG(AVX2_LOAD(&prev2[x+2*mrefs]), AVX2_LOAD(&next2[x+2*mrefs]));
+            __m256i f = VAVG(AVX2_LOAD(&prev2[x+2*prefs]), AVX2_LOAD(&next2[x+2*prefs]));
+            __m256i de = VSUB(d, e), dc = VSUB(d, c);
+            __m256i bc = VSUB(b, c), fe = VSUB(f, e);
+            __m256i max = VMAX(VMAX(de, dc), VMIN(bc, fe));
+            __m256i min = VMIN(VMIN(de, dc), VMAX(bc, fe));
+
+            diff = VMAX(VMAX(diff, min), VSUB(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative */
+        spatial_pred = VMIN(VMAX(spatial_pred, VSUB(d, diff)), VADD(d, diff));
+
+        AVX2_STORE(&dst[x], spatial_pred);
+    }
+
+    if (x < w)
+        AVX2_TAIL(&dst[x], &prev[x], &cur[x], &next[x], w - x,
+                  prefs_bytes, mrefs_bytes, parity, mode);
+}
+
+#undef VADD
+#undef VSUB
+#undef VMIN
+#undef VMAX
+#undef VABS
+#undef VAVG
+#undef VABSDIFF
+#undef VSCORE
+#undef VPRED
+#undef VCHECK
@@ -163,3 +163,32 @@ static inline picture_t *CopyInfoAndRelease( picture_t *p_outpic, picture_t *p_i
 
     return p_outpic;
 }
+
+/*****************************************************************************
+ * Slices: horizontal band of a picture plane, processed by one slice callback
+ * of filter_ExecuteSlices()
+ *****************************************************************************/
+typedef struct
+{
+    int i_start; /* First line written by the slice */
+    int i_end;   /* Line following the last one written by the slice */
+    int i_first; /* First line read by the slice, including the overlap */
+    int i_last;  /* Line following the last one read by the slice */
+} filter_slice_t;
+
+/* Computes the band of a plane handled by a slice. The lines are split
+ * evenly, the boundaries between slices being multiple of i_align. The lines
+ * that can be read are extended by i_overlap lines on each side, within the
+ * plane. */
+static inline void filter_GetSlice( filter_slice_t *p_slice,
+                                    unsigned i_index, unsigned i_count,
+                                    int i_lines, int i_align, int i_overlap )
+{
+    int i_start = (int64_t)i_lines * i_index / i_count;
+    int i_end = (int64_t)i_lines * (i_index + 1) / i_count;
+
+    p_slice->i_start = i_start - i_start % i_align;
+    p_slice->i_end = i_index + 1 < i_count ? i_end - i_end % i_align : i_lines;
+    p_slice->i_first = __MAX( p_slice->i_start - i_overlap, 0 );
+    p_slice->i_last = __MIN( p_slice->i_end + i_overlap, i_lines );
+}
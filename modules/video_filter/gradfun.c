@@ -108,6 +108,7 @@ struct filter_sys_t {
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    uint16_t         *buf[PICTURE_PLANE_MAX]; /* one per plane */
 };
 
 static int Open(vlc_object_t *object)
@@ -131,7 +132,8 @@ static int Open(vlc_object_t *object)
     sys->radius   = var_CreateGetIntegerCommand(filter, CFG_PREFIX "radius");
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
-    sys->cfg.buf = NULL;
+    for (int i = 0; i < PICTURE_PLANE_MAX; i++)
+        sys->buf[i] = NULL;
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
@@ -168,11 +170,44 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
-    aligned_free(sys->cfg.buf);
+    for (int i = 0; i < PICTURE_PLANE_MAX; i++)
+        aligned_free(sys->buf[i]);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+/* The blur is computed by a sliding window over the whole plane, so the
+ * slices are made of planes rather than bands of lines */
+static void FilterSlice(filter_t *filter, void *opaque,
+                        unsigned index, unsigned count)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const picture_t *src = ((picture_t **)opaque)[0];
+    picture_t *dst = ((picture_t **)opaque)[1];
+    const video_format_t *fmt = &filter->fmt_in.video;
+
+    for (int i = index; i < dst->i_planes; i += count) {
+        const plane_t *srcp = &src->p[i];
+        plane_t       *dstp = &dst->p[i];
+        struct vf_priv_s cfg = sys->cfg;
+
+        cfg.buf = sys->buf[i];
+
+        const vlc_chroma_description_t *chroma = sys->chroma;
+        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg.radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg.radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+        if (__MIN(w, h) > 2 * r && cfg.buf) {
+            filter_plane(&cfg, dstp->p_pixels, srcp->p_pixels,
+                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+        } else {
+            plane_CopyPixels(dstp, srcp);
+        }
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -194,28 +229,16 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
         cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
-    }
-
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
-
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
+        for (int i = 0; i < dst->i_planes; i++) {
+            aligned_free(sys->buf[i]);
+            sys->buf[i] = aligned_alloc(16,
+                                       (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*sys->buf[i]));
         }
     }
 
+    picture_t *pics[2] = { src, dst };
+    filter_ExecuteSlices(filter, FilterSlice, pics);
+
     picture_CopyProperties(dst, src);
     picture_Release(src);
     return dst;
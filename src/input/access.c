@@ -206,6 +206,19 @@ static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
                      block->i_buffer, &total);
         stats_Update(input_priv(input)->counters.p_input_bitrate, total, NULL);
         stats_Update(input_priv(input)->counters.p_read_packets, 1, NULL);
+
+        /* Discontinuities are (rarely) flagged by accesses that can lose
+         * packets, such as UDP; ask how many went missing. */
+        uint64_t lost;
+        if ((block->i_flags & BLOCK_FLAG_DISCONTINUITY)
+         && vlc_stream_Control(access, STREAM_GET_LOST, &lost) == VLC_SUCCESS)
+        {
+            stats_Update(input_priv(input)->counters.p_lost_packets, 0,
+                         &total);
+            if (lost > total)
+                stats_Update(input_priv(input)->counters.p_lost_packets,
+                             lost - total, NULL);
+        }
         vlc_mutex_unlock(&input_priv(input)->counters.counters_lock);
     }
 
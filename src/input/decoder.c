@@ -96,6 +96,11 @@ struct decoder_owner_sys_t
 
     /* fifo */
     block_fifo_t *p_fifo;
+    /* Lock-free fast path for the fifo (the fifo takes over when it is full,
+     * until the fifo is empty again) */
+    vlc_ring_t *p_ring;
+    bool b_ring_full; /* only used by the owner */
+    atomic_bool ring_waiting; /* the decoder thread waits on the fifo */
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -151,6 +156,9 @@ struct decoder_owner_sys_t
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
 
+/* Number of blocks (or block lists) queued without locking the decoder FIFO */
+#define DECODER_RING_SIZE 256
+
 /**
  * Load a decoder module
  */
@@ -1583,14 +1591,20 @@ static void *DecoderThread( void *p_data )
         vlc_cond_signal( &p_owner->wait_fifo );
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        /* Blocks in the ring are always older than blocks in the FIFO */
+        block_t *p_block = vlc_ring_Pop( p_owner->p_ring );
+        if( p_block == NULL )
+            p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
                 p_owner->b_idle = true;
                 vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
+                atomic_store( &p_owner->ring_waiting, true );
+                if( vlc_ring_IsEmpty( p_owner->p_ring ) )
+                    vlc_fifo_Wait( p_owner->p_fifo );
+                atomic_store( &p_owner->ring_waiting, false );
                 p_owner->b_idle = false;
                 continue;
             }
@@ -1697,6 +1711,17 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     }
 
+    p_owner->p_ring = vlc_ring_New( DECODER_RING_SIZE );
+    if( unlikely(p_owner->p_ring == NULL) )
+    {
+        block_FifoRelease( p_owner->p_fifo );
+        free( p_owner );
+        vlc_object_release( p_dec );
+        return NULL;
+    }
+    p_owner->b_ring_full = false;
+    atomic_init( &p_owner->ring_waiting, false );
+
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -1803,6 +1828,7 @@ static void DeleteDecoder( decoder_t * p_dec )
     UnloadDecoder( p_dec );
 
     /* Free all packets still in the decoder fifo. */
+    vlc_ring_Delete( p_owner->p_ring );
     block_FifoRelease( p_owner->p_fifo );
 
     /* Cleanup */
@@ -2016,17 +2042,38 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    /* Fast path: no need to lock the FIFO if it is not in use (i.e. the ring
+     * is not full), and the ring is below the pacing/resetting limits. */
+    if( !p_owner->b_ring_full
+     && ( b_do_pace ? p_owner->b_waiting
+                      || vlc_ring_GetCount( p_owner->p_ring ) < 10
+                    : vlc_ring_GetBytes( p_owner->p_ring ) <= 400*1024*1024 )
+     && vlc_ring_Push( p_owner->p_ring, p_block ) )
+    {
+        /* Wake the decoder thread up if it sleeps on the FIFO. See also
+         * DecoderThread(). */
+        if( atomic_load( &p_owner->ring_waiting ) )
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            vlc_fifo_Signal( p_owner->p_fifo );
+            vlc_fifo_Unlock( p_owner->p_fifo );
+        }
+        return;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        if( vlc_fifo_GetBytes( p_owner->p_fifo )
+          + vlc_ring_GetBytes( p_owner->p_ring ) > 400*1024*1024 )
         {
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
             block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            vlc_ring_Discard( p_owner->p_ring );
         }
     }
     else
@@ -2034,11 +2081,23 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        while( vlc_fifo_GetCount( p_owner->p_fifo )
+             + vlc_ring_GetCount( p_owner->p_ring ) >= 10 )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    /* Keep the FIFO in use until it is empty, so that blocks are decoded in
+     * order. */
+    if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        p_owner->b_ring_full = false;
+
+    if( !p_owner->b_ring_full && vlc_ring_Push( p_owner->p_ring, p_block ) )
+        vlc_fifo_Signal( p_owner->p_fifo );
+    else
+    {
+        p_owner->b_ring_full = true;
+        vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    }
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2049,7 +2108,8 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_dec->p_owner->p_fifo ) || p_owner->b_draining )
+    if( !vlc_fifo_IsEmpty( p_dec->p_owner->p_fifo )
+     || !vlc_ring_IsEmpty( p_owner->p_ring ) || p_owner->b_draining )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2105,6 +2165,8 @@ void input_DecoderFlush( decoder_t *p_dec )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    vlc_ring_Discard( p_owner->p_ring );
+    p_owner->b_ring_full = false;
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2289,7 +2351,8 @@ void input_DecoderWait( decoder_t *p_dec )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && vlc_ring_IsEmpty( p_owner->p_ring ) )
         {
             msg_Err( p_dec, "buffer deadlock prevented" );
             vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2354,7 +2417,8 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    return block_FifoSize( p_owner->p_fifo );
+    return block_FifoSize( p_owner->p_fifo )
+         + vlc_ring_GetBytes( p_owner->p_ring );
 }
 
 void input_DecoderGetObjects( decoder_t *p_dec,
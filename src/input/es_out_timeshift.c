@@ -37,9 +37,13 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 #ifdef _WIN32
 #  include <vlc_charset.h>
 #endif
@@ -161,6 +165,44 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Block record in the temporary files:
+ * - the header (TS_RECORD_HEADER bytes), also used as block headroom,
+ * - the payload,
+ * - at least TS_RECORD_PADDING bytes of zeroes, also used as block tailroom.
+ * Records are aligned on TS_RECORD_ALIGN bytes. */
+#define TS_RECORD_HEADER  64
+#define TS_RECORD_PADDING 64
+#define TS_RECORD_ALIGN   32
+
+typedef struct
+{
+    mtime_t  i_pts;
+    mtime_t  i_dts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    uint32_t i_nb_samples;
+    uint32_t i_buffer;
+} ts_record_t;
+
+static_assert( sizeof(ts_record_t) <= TS_RECORD_HEADER,
+               "TS_RECORD_HEADER is too small" );
+
+#ifdef HAVE_MMAP
+/* Mapping of a temporary file, shared by the blocks read from it */
+typedef struct
+{
+    atomic_uint refs;
+    void        *p_addr;
+    size_t      i_length;
+} ts_map_t;
+
+typedef struct
+{
+    block_t  self;
+    ts_map_t *p_map;
+} ts_block_t;
+#endif
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -172,8 +214,12 @@ struct ts_storage_t
 #endif
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
+    int64_t i_file_flushed; /* Size in bytes visible to the reader */
     FILE    *p_filew;   /* FILE handle for data writing */
     FILE    *p_filer;   /* FILE handle for data reading */
+#ifdef HAVE_MMAP
+    ts_map_t *p_map;    /* Mapping for zero-copy reading (or NULL) */
+#endif
 
     /* */
     int      i_cmd_r;
@@ -188,6 +234,7 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_tmp_total_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -210,6 +257,7 @@ typedef struct
     /* */
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_storage_size; /* Size in bytes of all temporary files */
 
     mtime_t        i_cmd_delay;
 
@@ -227,6 +275,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_tmp_total_max;   /* Maximal size of all files in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -271,8 +320,10 @@ static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStorageDrop( ts_storage_t *p_storage, int i_cmd );
+static bool         TsStorageIsDropped( ts_storage_t *p_storage );
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
@@ -344,6 +395,18 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int64_t i_tmp_total_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    if( i_tmp_total_max > 0 )
+    {   /* Keep at least two files: the one being read and the one being
+         * written */
+        p_sys->i_tmp_total_max = __MAX( i_tmp_total_max,
+                                        2 * p_sys->i_tmp_size_max );
+        msg_Dbg( p_input, "using timeshift maximum size of %"PRId64" MiB",
+                 p_sys->i_tmp_total_max/(1024*1024) );
+    }
+    else
+        p_sys->i_tmp_total_max = 0;
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -787,6 +850,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_tmp_total_max = p_sys->i_tmp_total_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -802,6 +866,7 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_storage_size = 0;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -879,7 +944,43 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    const int64_t i_file_size = p_ts->p_storage_w->i_file_size;
+    TsStoragePushCmd( p_ts->p_storage_w, p_cmd );
+    p_ts->i_storage_size += p_ts->p_storage_w->i_file_size - i_file_size;
+
+    /* Bound the timeshift window: drop the data of the oldest files, and skip
+     * the time span they covered */
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+    while( p_ts->i_tmp_total_max > 0
+        && p_ts->i_storage_size > p_ts->i_tmp_total_max
+        && p_storage != p_ts->p_storage_w )
+    {
+        ts_storage_t *p_next = p_storage->p_next;
+
+        if( !TsStorageIsDropped( p_storage ) )
+        {
+            const int i_cmd = p_storage == p_ts->p_storage_r ? p_storage->i_cmd_r : 0;
+
+            if( i_cmd < p_storage->i_cmd_w )
+            {
+                assert( p_next->i_cmd_w > 0 );
+                p_ts->i_cmd_delay -= p_next->p_cmd[0].i_date
+                                   - p_storage->p_cmd[i_cmd].i_date;
+            }
+
+            msg_Warn( p_ts->p_input, "es out timeshift: maximum size reached, "
+                      "dropping the oldest data" );
+            p_ts->i_storage_size -= p_storage->i_file_size;
+            TsStorageDrop( p_storage, i_cmd );
+        }
+
+        if( p_storage == p_ts->p_storage_r && TsStorageIsEmpty( p_storage ) )
+        {
+            p_ts->p_storage_r = p_next;
+            TsStorageDelete( p_storage );
+        }
+        p_storage = p_next;
+    }
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -900,6 +1001,7 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
         if( !p_next )
             break;
 
+        p_ts->i_storage_size -= p_ts->p_storage_r->i_file_size;
         TsStorageDelete( p_ts->p_storage_r );
         p_ts->p_storage_r = p_next;
     }
@@ -1100,6 +1202,78 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
+static size_t TsRecordSize( size_t i_buffer )
+{
+    return TS_RECORD_HEADER + ((i_buffer + TS_RECORD_PADDING + TS_RECORD_ALIGN - 1)
+                               & ~(size_t)(TS_RECORD_ALIGN - 1));
+}
+
+#ifdef HAVE_MMAP
+static ts_map_t *TsMapNew( int fd, size_t i_length )
+{
+    ts_map_t *p_map = malloc( sizeof(*p_map) );
+    if( unlikely(p_map == NULL) )
+        return NULL;
+
+    /* The file is mapped beyond its current end: only the parts already
+     * written (and flushed) are ever accessed. */
+    p_map->p_addr = mmap( NULL, i_length, PROT_READ|PROT_WRITE, MAP_SHARED,
+                          fd, 0 );
+    if( p_map->p_addr == MAP_FAILED )
+    {
+        free( p_map );
+        return NULL;
+    }
+    p_map->i_length = i_length;
+    atomic_init( &p_map->refs, 1 );
+    return p_map;
+}
+
+static void TsMapRelease( ts_map_t *p_map )
+{
+    if( atomic_fetch_sub( &p_map->refs, 1 ) != 1 )
+        return;
+
+    munmap( p_map->p_addr, p_map->i_length );
+    free( p_map );
+}
+
+static void TsBlockRelease( block_t *p_block )
+{
+    ts_block_t *p_ts_block = container_of( p_block, ts_block_t, self );
+
+    TsMapRelease( p_ts_block->p_map );
+    free( p_ts_block );
+}
+
+/* Creates a block pointing directly to a record in the mapped file */
+static block_t *TsMapBlock( ts_map_t *p_map, size_t i_offset )
+{
+    ts_block_t *p_ts_block = malloc( sizeof(*p_ts_block) );
+    if( unlikely(p_ts_block == NULL) )
+        return NULL;
+
+    uint8_t *p_record = (uint8_t *)p_map->p_addr + i_offset;
+    ts_record_t record;
+    block_t *p_block = &p_ts_block->self;
+
+    memcpy( &record, p_record, sizeof(record) );
+    block_Init( p_block, p_record, TsRecordSize( record.i_buffer ) );
+    p_block->p_buffer += TS_RECORD_HEADER;
+    p_block->i_buffer = record.i_buffer;
+    p_block->i_dts = record.i_dts;
+    p_block->i_pts = record.i_pts;
+    p_block->i_flags = record.i_flags;
+    p_block->i_length = record.i_length;
+    p_block->i_nb_samples = record.i_nb_samples;
+    p_block->pf_release = TsBlockRelease;
+
+    atomic_fetch_add( &p_map->refs, 1 );
+    p_ts_block->p_map = p_map;
+    return p_block;
+}
+#endif
+
 static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
 {
     ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
@@ -1114,6 +1288,11 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
 
+#ifdef HAVE_MMAP
+    /* Records which do not fit in the mapping are read with stdio */
+    p_storage->p_map = TsMapNew( fd, i_tmp_size_max );
+#endif
+
     p_storage->p_filew = fdopen( fd, "w+b" );
     if( p_storage->p_filew == NULL )
     {
@@ -1141,6 +1320,7 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     /* */
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
+    p_storage->i_file_flushed = 0;
 
     /* */
     p_storage->i_cmd_w = 0;
@@ -1156,11 +1336,34 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     }
     return p_storage;
 error:
+#ifdef HAVE_MMAP
+    if( p_storage->p_map != NULL )
+        TsMapRelease( p_storage->p_map );
+#endif
     free( psz_file );
     free( p_storage );
     return NULL;
 }
 
+static void TsStorageClose( ts_storage_t *p_storage )
+{
+    if( p_storage->p_filew == NULL )
+        return;
+
+#ifdef HAVE_MMAP
+    /* The mapping lives on until all blocks read from it are released */
+    if( p_storage->p_map != NULL )
+        TsMapRelease( p_storage->p_map );
+    p_storage->p_map = NULL;
+#endif
+    fclose( p_storage->p_filer );
+    fclose( p_storage->p_filew );
+    p_storage->p_filer = p_storage->p_filew = NULL;
+#ifdef _WIN32
+    vlc_unlink( p_storage->psz_file );
+#endif
+}
+
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
     while( p_storage->i_cmd_r < p_storage->i_cmd_w )
@@ -1173,17 +1376,28 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+    TsStorageClose( p_storage );
 #ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
 #endif
     free( p_storage );
 }
 
+static void TsStorageFlush( ts_storage_t *p_storage )
+{
+    /* After a write error (disk full...), the file can be shorter than the
+     * offsets of the records: nothing more is then visible to the reader,
+     * as touching the mapping beyond the end of the file raises SIGBUS */
+    if( fflush( p_storage->p_filew ) == 0 && !ferror( p_storage->p_filew ) )
+        p_storage->i_file_flushed = p_storage->i_file_size;
+}
+
 static void TsStoragePack( ts_storage_t *p_storage )
 {
+    /* No more data will be written */
+    if( p_storage->p_filew != NULL )
+        TsStorageFlush( p_storage );
+
     /* Try to release a bit of memory */
     if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
         return;
@@ -1194,11 +1408,33 @@ static void TsStoragePack( ts_storage_t *p_storage )
     if( p_new )
         p_storage->p_cmd = p_new;
 }
+
+/* Drops the data of a (packed) storage, from the i_cmd-th command.
+ * Commands without data are kept. */
+static void TsStorageDrop( ts_storage_t *p_storage, int i_cmd )
+{
+    int i_cmd_w = i_cmd;
+
+    assert( i_cmd >= p_storage->i_cmd_r );
+    for( int i = i_cmd; i < p_storage->i_cmd_w; i++ )
+    {
+        if( p_storage->p_cmd[i].i_type != C_SEND )
+            p_storage->p_cmd[i_cmd_w++] = p_storage->p_cmd[i];
+    }
+    p_storage->i_cmd_w = i_cmd_w;
+
+    TsStorageClose( p_storage );
+    p_storage->i_file_size = p_storage->i_file_flushed = 0;
+}
+static bool TsStorageIsDropped( ts_storage_t *p_storage )
+{
+    return p_storage->p_filew == NULL;
+}
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = TsRecordSize( p_cmd->u.send.p_block->i_buffer );
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1209,8 +1445,9 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
+    static const uint8_t zero[TS_RECORD_HEADER + TS_RECORD_PADDING + TS_RECORD_ALIGN];
     ts_cmd_t cmd = *p_cmd;
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
@@ -1218,29 +1455,35 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const size_t i_size = TsRecordSize( p_block->i_buffer );
+        const ts_record_t record = {
+            .i_pts = p_block->i_pts,
+            .i_dts = p_block->i_dts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_buffer = p_block->i_buffer,
+        };
 
         cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        cmd.u.send.i_offset = p_storage->i_file_size;
+
+        if( fwrite( &record, sizeof(record), 1, p_storage->p_filew ) != 1
+         || fwrite( zero, TS_RECORD_HEADER - sizeof(record), 1,
+                    p_storage->p_filew ) != 1
+         || ( p_block->i_buffer > 0
+           && fwrite( p_block->p_buffer, p_block->i_buffer, 1,
+                      p_storage->p_filew ) != 1 )
+         || fwrite( zero, i_size - TS_RECORD_HEADER - p_block->i_buffer, 1,
+                    p_storage->p_filew ) != 1 )
         {
+            /* Keep the offsets of the next records in sync with the file */
+            p_storage->i_file_size = ftell( p_storage->p_filew );
             block_Release( p_block );
             return;
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
-        }
-        p_storage->i_file_size += p_block->i_buffer;
+        p_storage->i_file_size += i_size;
         block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
@@ -1249,31 +1492,57 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     assert( !TsStorageIsEmpty( p_storage ) );
 
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
+    if( p_cmd->i_type != C_SEND )
+        return;
+
+    p_cmd->u.send.p_block = NULL;
+    if( b_flush )
+        return;
+
+    const size_t i_offset = p_cmd->u.send.i_offset;
+
+    if( i_offset + TS_RECORD_HEADER > (uint64_t)p_storage->i_file_flushed )
+    {   /* The record is still in the stdio buffer */
+        TsStorageFlush( p_storage );
+    }
+
+#ifdef HAVE_MMAP
+    /* Only the flushed part of the file is mapped safely, the rest (if the
+     * flush failed) is read with stdio */
+    const uint64_t i_mapped = __MIN( (uint64_t)p_storage->i_file_flushed,
+                                     p_storage->p_map != NULL
+                                     ? p_storage->p_map->i_length : 0 );
+    if( i_offset + TS_RECORD_HEADER <= i_mapped )
     {
-        block_t block;
+        ts_record_t record;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+        memcpy( &record, (uint8_t *)p_storage->p_map->p_addr + i_offset,
+                sizeof(record) );
+        if( i_offset + TsRecordSize( record.i_buffer ) <= i_mapped )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
+            p_cmd->u.send.p_block = TsMapBlock( p_storage->p_map, i_offset );
+            return;
         }
-        else
+    }
+#endif
+
+    ts_record_t record;
+
+    if( !fseek( p_storage->p_filer, i_offset, SEEK_SET ) &&
+        fread( &record, sizeof(record), 1, p_storage->p_filer ) == 1 &&
+        !fseek( p_storage->p_filer, i_offset + TS_RECORD_HEADER, SEEK_SET ) )
+    {
+        block_t *p_block = block_Alloc( record.i_buffer );
+        if( p_block )
         {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            p_block->i_dts      = record.i_dts;
+            p_block->i_pts      = record.i_pts;
+            p_block->i_flags    = record.i_flags;
+            p_block->i_length   = record.i_length;
+            p_block->i_nb_samples = record.i_nb_samples;
+            p_block->i_buffer = fread( p_block->p_buffer, 1, record.i_buffer, p_storage->p_filer );
         }
+        p_cmd->u.send.p_block = p_block;
     }
 }
 
@@ -108,7 +108,7 @@ void stream_CommonDelete(stream_t *s)
     if (priv->peek != NULL)
         block_Release(priv->peek);
     if (priv->block != NULL)
-        block_Release(priv->block);
+        block_ChainRelease(priv->block);
 
     free(s->psz_url);
     vlc_object_release(s);
@@ -366,6 +366,15 @@ static ssize_t vlc_stream_CopyBlock(block_t **restrict pp,
 {
     block_t *block = *pp;
 
+    /* Skip empty blocks, the rest of the chain may still hold data */
+    while (block != NULL && block->i_buffer == 0)
+    {
+        *pp = block->p_next;
+        block->p_next = NULL;
+        block_Release(block);
+        block = *pp;
+    }
+
     if (block == NULL)
         return -1;
 
@@ -380,8 +389,9 @@ static ssize_t vlc_stream_CopyBlock(block_t **restrict pp,
 
     if (block->i_buffer == 0)
     {
+        *pp = block->p_next;
+        block->p_next = NULL;
         block_Release(block);
-        *pp = NULL;
     }
 
     return likely(len > 0) ? (ssize_t)len : -1;
@@ -417,7 +427,8 @@ static ssize_t vlc_stream_ReadRaw(stream_t *s, void *buf, size_t len)
     if (ret >= 0)
         return ret;
 
-    if (s->pf_block != NULL)
+    /* Only ask for more data once the queued blocks are exhausted */
+    if (s->pf_block != NULL && priv->block == NULL)
     {
         bool eof = false;
 
@@ -486,6 +497,12 @@ ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
         peek = priv->block;
         priv->peek = peek;
         priv->block = NULL;
+
+        if (peek != NULL)
+        {   /* Only peek into the first block of a chain */
+            priv->block = peek->p_next;
+            peek->p_next = NULL;
+        }
     }
 
     if (peek == NULL)
@@ -574,7 +591,20 @@ block_t *vlc_stream_ReadBlock(stream_t *s)
     }
 
     if (block != NULL)
+    {
+        /* Block access modules may return a chain of blocks: hand them out
+         * one at a time and keep the rest for later. */
+        if (block->p_next != NULL)
+        {
+            block_t **pp = &priv->block;
+
+            while (*pp != NULL)
+                pp = &(*pp)->p_next;
+            *pp = block->p_next;
+            block->p_next = NULL;
+        }
         priv->offset += block->i_buffer;
+    }
 
     return block;
 }
@@ -643,7 +673,7 @@ int vlc_stream_Seek(stream_t *s, uint64_t offset)
 
     if (priv->block != NULL)
     {
-        block_Release(priv->block);
+        block_ChainRelease(priv->block);
         priv->block = NULL;
     }
 
@@ -678,7 +708,7 @@ int vlc_stream_vaControl(stream_t *s, int cmd, va_list args)
 
             if (priv->block != NULL)
             {
-                block_Release(priv->block);
+                block_ChainRelease(priv->block);
                 priv->block = NULL;
             }
 
@@ -93,6 +93,8 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
     priv->p_vlm = NULL;
+    priv->b_block_pool = false;
+    priv->slice_pool = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -230,6 +232,8 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    priv->b_block_pool = var_InheritBool( p_libvlc, "block-pool" )
+                      && block_pool_Init() == VLC_SUCCESS;
 
     /*
      * Initialize hotkey handling
@@ -416,8 +420,21 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if( priv->slice_pool != NULL )
+        vlc_slice_pool_Delete( priv->slice_pool );
+
     libvlc_InternalActionsClean( p_libvlc );
 
+    if( priv->b_block_pool )
+    {
+        struct block_pool_stats stats;
+
+        block_pool_GetStats( &stats );
+        msg_Dbg( p_libvlc, "block pool: %"PRIu64" hits, %"PRIu64" misses, "
+                 "%zu bytes cached", stats.hits, stats.misses, stats.bytes );
+        block_pool_Deinit();
+    }
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
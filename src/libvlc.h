@@ -72,6 +72,19 @@ int vlc_LogPreinit(libvlc_int_t *);
 int vlc_LogInit(libvlc_int_t *);
 void vlc_LogDeinit(libvlc_int_t *);
 
+/*
+ * Block pool
+ */
+int block_pool_Init(void);
+void block_pool_Deinit(void);
+
+/*
+ * Video filter slice threads
+ */
+typedef struct vlc_slice_pool vlc_slice_pool_t;
+
+void vlc_slice_pool_Delete(vlc_slice_pool_t *);
+
 /*
  * LibVLC exit event handling
  */
@@ -180,6 +193,7 @@ typedef struct libvlc_priv_t
 
     /* Logging */
     bool               b_stats;     ///< Whether to collect stats
+    bool               b_block_pool; ///< Whether the block pool is used
 
     /* Singleton objects */
     vlc_logger_t      *logger;
@@ -189,6 +203,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     vlc_actions_t *actions; ///< Hotkeys handler
+    vlc_slice_pool_t *slice_pool; ///< Video filter threads (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
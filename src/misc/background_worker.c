@@ -31,7 +31,18 @@
 struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
-    int timeout; /**< timeout duration in microseconds */
+    int timeout; /**< timeout duration in milliseconds */
+    mtime_t date; /**< date at which the entity was queued */
+};
+
+struct bg_thread {
+    struct background_worker* owner;
+    struct bg_queued_item* item; /**< item being processed, if any (only
+                                   * dereferenced by the thread itself) */
+    void* id; /**< id of the item being processed */
+    mtime_t deadline; /**< deadline of the current task */
+    bool probe_request; /**< true if a probe is requested */
+    bool cancel; /**< true if the current task shall be stopped */
 };
 
 struct background_worker {
@@ -40,95 +51,129 @@ struct background_worker {
 
     vlc_mutex_t lock; /**< acquire to inspect members that follow */
     struct {
-        bool probe_request; /**< true if a probe is requested */
         vlc_cond_t wait; /**< wait for update in terms of head */
         vlc_cond_t worker_wait; /**< wait for probe request or cancelation */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
+        vlc_array_t threads; /**< running threads */
+        unsigned idle; /**< threads waiting for an entity */
+        bool flush; /**< true if idle threads shall terminate */
     } head;
 
     struct {
         vlc_cond_t wait; /**< wait for update in terms of tail */
-        vlc_array_t data; /**< queue of pending entities to process */
+        /** queues of pending entities to process, by priority */
+        vlc_array_t data[BACKGROUND_WORKER_PRIORITY_COUNT];
     } tail;
+
+    struct {
+        uint64_t completed;
+        uint64_t timeouts;
+        uint64_t started;
+        mtime_t wait_total;
+        mtime_t wait_max;
+        mtime_t run_total;
+    } stats;
 };
 
-static void* Thread( void* data )
+static size_t CountPending( struct background_worker* worker )
 {
-    struct background_worker* worker = data;
+    size_t count = 0;
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
+        count += vlc_array_count( &worker->tail.data[i] );
+    return count;
+}
 
-    for( ;; )
+static struct bg_queued_item* PopItem( struct background_worker* worker )
+{
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
-
-        vlc_mutex_lock( &worker->lock );
-        for( ;; )
+        if( vlc_array_count( &worker->tail.data[i] ) )
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+            struct bg_queued_item* item =
+                vlc_array_item_at_index( &worker->tail.data[i], 0 );
+            vlc_array_remove( &worker->tail.data[i], 0 );
+            return item;
+        }
+    }
+    return NULL;
+}
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+static void ThreadExit( struct bg_thread* thread )
+{
+    struct background_worker* worker = thread->owner;
 
-            if( worker->head.deadline == VLC_TS_0 && item == NULL )
-                worker->head.active = false;
-            worker->head.id = item ? item->id : NULL;
-            vlc_cond_broadcast( &worker->head.wait );
+    vlc_array_remove( &worker->head.threads,
+                      vlc_array_index_of_item( &worker->head.threads, thread ) );
+    vlc_cond_broadcast( &worker->head.wait );
+    free( thread );
+}
 
-            if( item )
-            {
-                if( item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-                else
-                    worker->head.deadline = INT64_MAX;
-            }
-            else if( worker->head.deadline != VLC_TS_0 )
-            {
-                /* Wait 1 seconds for new inputs before terminating */
-                mtime_t deadline = mdate() + INT64_C(1000000);
-                int ret = vlc_cond_timedwait( &worker->tail.wait,
-                                              &worker->lock, deadline );
-                if( ret != 0 )
-                {
-                    /* Timeout: if there is still no items, the thread will be
-                     * terminated at next loop iteration (active = false). */
-                    worker->head.deadline = VLC_TS_0;
-                }
-                continue;
-            }
-            break;
-        }
+static void* Thread( void* data )
+{
+    struct bg_thread* thread = data;
+    struct background_worker* worker = thread->owner;
 
-        if( !worker->head.active )
+    vlc_mutex_lock( &worker->lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = PopItem( worker );
+        void* handle = NULL;
+
+        if( item == NULL )
         {
-            vlc_mutex_unlock( &worker->lock );
-            break;
+            if( worker->head.flush )
+                break;
+
+            /* Wait 1 seconds for new inputs before terminating */
+            mtime_t deadline = mdate() + INT64_C(1000000);
+            worker->head.idle++;
+            int ret = vlc_cond_timedwait( &worker->tail.wait,
+                                          &worker->lock, deadline );
+            worker->head.idle--;
+            if( ret != 0 && CountPending( worker ) == 0 )
+                break;
+            continue;
         }
-        vlc_mutex_unlock( &worker->lock );
 
-        assert( item != NULL );
+        mtime_t now = mdate();
+        thread->item = item;
+        thread->id = item->id;
+        thread->cancel = false;
+        thread->probe_request = false;
+        if( item->timeout > 0 )
+            thread->deadline = now + item->timeout * 1000;
+        else
+            thread->deadline = INT64_MAX;
+
+        worker->stats.started++;
+        worker->stats.wait_total += now - item->date;
+        if( now - item->date > worker->stats.wait_max )
+            worker->stats.wait_max = now - item->date;
+        vlc_cond_broadcast( &worker->head.wait );
+        vlc_mutex_unlock( &worker->lock );
 
         if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
         {
             worker->conf.pf_release( item->entity );
             free( item );
+
+            vlc_mutex_lock( &worker->lock );
+            thread->item = NULL;
+            vlc_cond_broadcast( &worker->head.wait );
             continue;
         }
 
+        bool b_timeout;
         for( ;; )
         {
             vlc_mutex_lock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            b_timeout = thread->deadline <= mdate();
+            bool const b_cancel = thread->cancel;
+            thread->probe_request = false;
 
             vlc_mutex_unlock( &worker->lock );
 
-            if( b_timeout ||
+            if( b_timeout || b_cancel ||
                 worker->conf.pf_probe( worker->owner, handle ) )
             {
                 worker->conf.pf_stop( worker->owner, handle );
@@ -138,46 +183,89 @@ static void* Thread( void* data )
             }
 
             vlc_mutex_lock( &worker->lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
+            if( thread->probe_request == false && thread->cancel == false &&
+                thread->deadline > mdate() )
             {
                 vlc_cond_timedwait( &worker->head.worker_wait, &worker->lock,
-                                     worker->head.deadline );
+                                     thread->deadline );
             }
             vlc_mutex_unlock( &worker->lock );
         }
+
+        vlc_mutex_lock( &worker->lock );
+        thread->item = NULL;
+        worker->stats.completed++;
+        if( b_timeout )
+            worker->stats.timeouts++;
+        worker->stats.run_total += mdate() - now;
+        vlc_cond_broadcast( &worker->head.wait );
     }
 
+    ThreadExit( thread );
+    vlc_mutex_unlock( &worker->lock );
+
     return NULL;
 }
 
+/* Requests the tasks matching id to stop, returns true if there are any */
+static bool CancelRunning( struct background_worker* worker, void* id )
+{
+    bool b_running = false;
+
+    for( size_t i = 0; i < vlc_array_count( &worker->head.threads ); i++ )
+    {
+        struct bg_thread* thread =
+            vlc_array_item_at_index( &worker->head.threads, i );
+
+        if( thread->item && ( id == NULL || thread->id == id ) )
+        {
+            thread->cancel = true;
+            b_running = true;
+        }
+    }
+    return b_running;
+}
+
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
     vlc_mutex_lock( &worker->lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    for( int p = 0; p < BACKGROUND_WORKER_PRIORITY_COUNT; p++ )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        vlc_array_t* data = &worker->tail.data[p];
 
-        if( id == NULL || item->id == id )
+        for( size_t i = 0; i < vlc_array_count( data ); )
         {
-            vlc_array_remove( &worker->tail.data, i );
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
-        }
+            struct bg_queued_item* item = vlc_array_item_at_index( data, i );
 
-        ++i;
+            if( id == NULL || item->id == id )
+            {
+                vlc_array_remove( data, i );
+                worker->conf.pf_release( item->entity );
+                free( item );
+                continue;
+            }
+
+            ++i;
+        }
     }
 
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    while( CancelRunning( worker, id ) )
     {
-        worker->head.deadline = VLC_TS_0;
-        vlc_cond_signal( &worker->head.worker_wait );
-        vlc_cond_signal( &worker->tail.wait );
+        vlc_cond_broadcast( &worker->head.worker_wait );
         vlc_cond_wait( &worker->head.wait, &worker->lock );
     }
+
+    if( id == NULL )
+    {
+        /* Wait for all the threads to terminate */
+        worker->head.flush = true;
+        while( vlc_array_count( &worker->head.threads ) )
+        {
+            vlc_cond_broadcast( &worker->tail.wait );
+            vlc_cond_wait( &worker->head.wait, &worker->lock );
+        }
+        worker->head.flush = false;
+    }
     vlc_mutex_unlock( &worker->lock );
 }
 
@@ -190,56 +278,92 @@ struct background_worker* background_worker_New( void* owner,
         return NULL;
 
     worker->conf = *conf;
+    if( worker->conf.max_threads < 1 )
+        worker->conf.max_threads = 1;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
+    worker->head.idle = 0;
+    worker->head.flush = false;
+    memset( &worker->stats, 0, sizeof( worker->stats ) );
 
     vlc_mutex_init( &worker->lock );
     vlc_cond_init( &worker->head.wait );
     vlc_cond_init( &worker->head.worker_wait );
+    vlc_array_init( &worker->head.threads );
 
-    vlc_array_init( &worker->tail.data );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
+        vlc_array_init( &worker->tail.data[i] );
     vlc_cond_init( &worker->tail.wait );
 
     return worker;
 }
 
+static int SpawnThread( struct background_worker* worker )
+{
+    struct bg_thread* thread = malloc( sizeof( *thread ) );
+    if( unlikely( !thread ) )
+        return VLC_ENOMEM;
+
+    thread->owner = worker;
+    thread->item = NULL;
+    thread->id = NULL;
+    thread->deadline = VLC_TS_INVALID;
+    thread->probe_request = false;
+    thread->cancel = false;
+
+    if( vlc_array_append( &worker->head.threads, thread ) )
+    {
+        free( thread );
+        return VLC_ENOMEM;
+    }
+
+    if( vlc_clone_detach( NULL, Thread, thread, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_array_remove( &worker->head.threads,
+                          vlc_array_count( &worker->head.threads ) - 1 );
+        free( thread );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout,
+                        enum background_worker_priority priority )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
     if( unlikely( !item ) )
         return VLC_EGENERIC;
 
+    assert( priority < BACKGROUND_WORKER_PRIORITY_COUNT );
+
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
+    item->date = mdate();
 
     vlc_mutex_lock( &worker->lock );
-    int i_ret = vlc_array_append( &worker->tail.data, item );
-    vlc_cond_signal( &worker->tail.wait );
-    if( i_ret != 0 )
+    size_t pending = CountPending( worker );
+    size_t threads = vlc_array_count( &worker->head.threads );
+
+    /* Start another thread if the idle ones will not be enough */
+    if( pending >= worker->head.idle &&
+        threads < (size_t) worker->conf.max_threads )
+        SpawnThread( worker );
+
+    if( vlc_array_count( &worker->head.threads ) == 0 ||
+        vlc_array_append( &worker->tail.data[priority], item ) )
     {
+        vlc_mutex_unlock( &worker->lock );
         free( item );
         return VLC_EGENERIC;
     }
 
-    if( worker->head.active == false )
-    {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
-    }
-
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
-
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
+    worker->conf.pf_hold( item->entity );
+    vlc_cond_signal( &worker->tail.wait );
     vlc_mutex_unlock( &worker->lock );
 
-    return ret;
+    return VLC_SUCCESS;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -250,15 +374,49 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock( &worker->lock );
-    worker->head.probe_request = true;
-    vlc_cond_signal( &worker->head.worker_wait );
+    for( size_t i = 0; i < vlc_array_count( &worker->head.threads ); i++ )
+    {
+        struct bg_thread* thread =
+            vlc_array_item_at_index( &worker->head.threads, i );
+        thread->probe_request = true;
+    }
+    vlc_cond_broadcast( &worker->head.worker_wait );
+    vlc_mutex_unlock( &worker->lock );
+}
+
+void background_worker_GetStats( struct background_worker* worker,
+                                 struct background_worker_stats* stats )
+{
+    vlc_mutex_lock( &worker->lock );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
+        stats->queued[i] = vlc_array_count( &worker->tail.data[i] );
+
+    stats->threads = vlc_array_count( &worker->head.threads );
+    stats->busy = 0;
+    for( size_t i = 0; i < stats->threads; i++ )
+    {
+        struct bg_thread* thread =
+            vlc_array_item_at_index( &worker->head.threads, i );
+        if( thread->item )
+            stats->busy++;
+    }
+
+    stats->completed = worker->stats.completed;
+    stats->timeouts = worker->stats.timeouts;
+    stats->wait_avg = worker->stats.started ?
+        worker->stats.wait_total / (mtime_t) worker->stats.started : 0;
+    stats->wait_max = worker->stats.wait_max;
+    stats->run_avg = worker->stats.completed ?
+        worker->stats.run_total / (mtime_t) worker->stats.completed : 0;
     vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+    vlc_array_clear( &worker->head.threads );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
+        vlc_array_clear( &worker->tail.data[i] );
     vlc_mutex_destroy( &worker->lock );
     vlc_cond_destroy( &worker->head.wait );
     vlc_cond_destroy( &worker->head.worker_wait );
@@ -19,6 +19,30 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+/**
+ * Priority lanes of the background-worker
+ *
+ * Queued entities are always processed from the highest priority lane first,
+ * so that interactive requests are not delayed by bulk ones.
+ **/
+enum background_worker_priority {
+    BACKGROUND_WORKER_PRIORITY_HIGH, /**< interactive requests */
+    BACKGROUND_WORKER_PRIORITY_LOW, /**< bulk requests */
+};
+
+#define BACKGROUND_WORKER_PRIORITY_COUNT 2
+
+struct background_worker_stats {
+    size_t queued[BACKGROUND_WORKER_PRIORITY_COUNT]; /**< pending entities */
+    unsigned threads; /**< running threads */
+    unsigned busy; /**< threads processing an entity */
+    uint64_t completed; /**< processed entities */
+    uint64_t timeouts; /**< entities stopped on timeout */
+    mtime_t wait_avg; /**< average time spent in the queue */
+    mtime_t wait_max; /**< maximum time spent in the queue */
+    mtime_t run_avg; /**< average processing time */
+};
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -29,6 +53,14 @@ struct background_worker_config {
      **/
     mtime_t default_timeout;
 
+    /**
+     * Maximum number of tasks running concurrently
+     *
+     * Threads are started on demand, up to this count, and terminate when
+     * they are idle. A value less-than 1 is treated as 1.
+     **/
+    int max_threads;
+
     /**
      * Release an entity
      *
@@ -119,10 +151,10 @@ struct background_worker* background_worker_New( void* owner,
     struct background_worker_config* config );
 
 /**
- * Request the background-worker to probe the current task
+ * Request the background-worker to probe the current tasks
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the current tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +168,9 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities of a given priority will be started in the order in which they are
+ * received (in terms of the order of invocations in a single-threaded
+ * environment), after the ones of higher priority.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +178,12 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the lane of the entity
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, enum background_worker_priority priority );
 
 /**
  * Remove entities from the background-worker
@@ -158,8 +192,9 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  * associated id, or to remove all queued (including currently running)
  * entities.
  *
- * \warning if the `id` passed refers to an entity that is currently being
- *          processed, the call will block until the task has been terminated.
+ * \warning if the `id` passed refers to entities that are currently being
+ *          processed, the call will block until their tasks have been
+ *          terminated, other running tasks are not affected.
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
@@ -167,15 +202,24 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
+/**
+ * Get the statistics of the background-worker
+ *
+ * \param worker the background-worker
+ * \param stats [out] the queue depth and latency statistics
+ **/
+void background_worker_GetStats( struct background_worker* worker,
+    struct background_worker_stats* stats );
+
 /**
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block until
+ *          they have been stopped.
  *
  * \param worker the background-worker
  **/
@@ -34,6 +34,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -91,12 +93,436 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
+/*
+ * Block pool
+ *
+ * Buffers of block_Alloc() are recycled by size classes (powers of two).
+ * Each thread has its own cache, so that allocating and releasing blocks does
+ * not take any lock nor write any shared memory. The caches exchange batches
+ * of buffers with a shared depot, as blocks are typically allocated and
+ * released in different threads.
+ *
+ * A thread flags its cache busy while it uses it. When the last user goes
+ * away, it disables the pool, waits until no cache is busy, then frees the
+ * depot and the buffers of all caches. The cache structures are freed by
+ * their threads on exit; the thread variable is deleted once none is left,
+ * or reused by the next user.
+ */
+
+/** Smallest pooled allocation size (log2) */
+#define BLOCK_POOL_MIN_SHIFT 9
+/** Largest pooled allocation size (log2) */
+#define BLOCK_POOL_MAX_SHIFT 17
+#define BLOCK_POOL_CLASSES (BLOCK_POOL_MAX_SHIFT - BLOCK_POOL_MIN_SHIFT + 1)
+/** Per-thread high-water mark, in bytes per size class */
+#define BLOCK_POOL_THREAD_MAX (256 << 10)
+/** Shared high-water mark, in bytes per size class */
+#define BLOCK_POOL_SHARED_MAX (4 << 20)
+
+struct block_pool_list
+{
+    block_t *first;
+    size_t count;
+};
+
+struct block_cache
+{
+    struct block_cache *next;
+    atomic_bool busy; /**< Set by the owner thread while it uses the lists */
+    /* Written by the owner thread only */
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_size_t bytes;
+    struct block_pool_list classes[BLOCK_POOL_CLASSES];
+};
+
+static struct
+{
+    vlc_mutex_t init_lock; /**< Serializes the users, protects users */
+    vlc_mutex_t lock; /**< Protects the depot, the cache list, key and stats */
+    vlc_cond_t idle; /**< Signaled when a cache stops being busy, if disabled */
+    unsigned users;
+    bool has_key;
+    vlc_threadvar_t key; /**< Only used to free the caches on thread exit */
+    struct block_cache *caches;
+    struct block_pool_list classes[BLOCK_POOL_CLASSES];
+    uint64_t hits;
+    uint64_t misses;
+    atomic_bool enabled; /**< Written with the lock held */
+} block_pool = {
+    .init_lock = VLC_STATIC_MUTEX,
+    .lock = VLC_STATIC_MUTEX,
+    .idle = VLC_STATIC_COND,
+};
+
+static thread_local struct block_cache *block_cache_self = NULL;
+
+static size_t block_pool_ClassSize(unsigned i)
+{
+    return (size_t)1 << (BLOCK_POOL_MIN_SHIFT + i);
+}
+
+/** Moves up to count buffers from one list to another. */
+static void block_pool_Move(struct block_pool_list *restrict dst,
+                            struct block_pool_list *restrict src, size_t count)
+{
+    while (count > 0 && src->first != NULL)
+    {
+        block_t *b = src->first;
+
+        src->first = b->p_next;
+        src->count--;
+        b->p_next = dst->first;
+        dst->first = b;
+        dst->count++;
+        count--;
+    }
+}
+
+static void block_pool_Free(block_t *list)
+{
+    while (list != NULL)
+    {
+        block_t *next = list->p_next;
+
+        free(list);
+        list = next;
+    }
+}
+
+/**
+ * Returns buffers to the shared depot, trimming it to its high-water mark.
+ * The buffers are freed if the pool is disabled.
+ */
+static void block_pool_Return(struct block_pool_list *list, unsigned i,
+                              size_t count)
+{
+    struct block_pool_list *shared = &block_pool.classes[i];
+    size_t max = BLOCK_POOL_SHARED_MAX / block_pool_ClassSize(i);
+    struct block_pool_list trim = { NULL, 0 };
+
+    vlc_mutex_lock(&block_pool.lock);
+    if (!atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+        max = 0;
+    block_pool_Move(shared, list, count);
+    if (shared->count > max)
+        block_pool_Move(&trim, shared, shared->count - max);
+    vlc_mutex_unlock(&block_pool.lock);
+
+    block_pool_Free(trim.first);
+    block_pool_Free(list->first);
+}
+
+static void block_cache_Destroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    block_cache_self = NULL;
+
+    vlc_mutex_lock(&block_pool.lock);
+    for (struct block_cache **pp = &block_pool.caches; *pp != NULL;
+         pp = &(*pp)->next)
+        if (*pp == cache)
+        {
+            *pp = cache->next;
+            break;
+        }
+    block_pool.hits += atomic_load(&cache->hits);
+    block_pool.misses += atomic_load(&cache->misses);
+    vlc_mutex_unlock(&block_pool.lock);
+
+    /* Not listed anymore: the last user cannot empty the cache meanwhile */
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        struct block_pool_list *list = &cache->classes[i];
+
+        block_pool_Return(list, i, list->count);
+    }
+    free(cache);
+}
+
+static struct block_cache *block_cache_New(void)
+{
+    struct block_cache *cache = calloc(1, sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    vlc_mutex_lock(&block_pool.lock);
+    /* The thread variable exists as long as the pool is enabled */
+    if (!atomic_load_explicit(&block_pool.enabled, memory_order_relaxed)
+     || vlc_threadvar_set(block_pool.key, cache))
+    {
+        vlc_mutex_unlock(&block_pool.lock);
+        free(cache);
+        return NULL;
+    }
+    cache->next = block_pool.caches;
+    block_pool.caches = cache;
+    vlc_mutex_unlock(&block_pool.lock);
+
+    block_cache_self = cache;
+    return cache;
+}
+
+static void block_cache_Leave(struct block_cache *cache)
+{
+    atomic_store(&cache->busy, false);
+    if (unlikely(!atomic_load(&block_pool.enabled)))
+    {   /* block_pool_Deinit() may be waiting for this cache */
+        vlc_mutex_lock(&block_pool.lock);
+        vlc_cond_broadcast(&block_pool.idle);
+        vlc_mutex_unlock(&block_pool.lock);
+    }
+}
+
+/**
+ * Flags the thread cache busy.
+ * @return the cache, or NULL if the pool is disabled
+ */
+static struct block_cache *block_cache_Enter(void)
+{
+    if (!atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+        return NULL;
+
+    struct block_cache *cache = block_cache_self;
+    if (unlikely(cache == NULL))
+    {
+        cache = block_cache_New();
+        if (cache == NULL)
+            return NULL;
+    }
+
+    /* Either block_pool_Deinit() sees the cache busy and waits, or this
+     * thread sees the pool disabled. */
+    atomic_store(&cache->busy, true);
+    if (unlikely(!atomic_load(&block_pool.enabled)))
+    {
+        block_cache_Leave(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static inline void block_cache_Add(atomic_uint_fast64_t *counter)
+{   /* Only the owner thread writes: no need for an atomic read-modify-write */
+    atomic_store_explicit(counter,
+        atomic_load_explicit(counter, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+}
+
+static void block_cache_SetBytes(struct block_cache *cache, size_t bytes)
+{
+    atomic_store_explicit(&cache->bytes, bytes, memory_order_relaxed);
+}
+
+/**
+ * Rounds an allocation size up to its size class.
+ * @return the size class index, or -1 if the size is not pooled
+ */
+static int block_pool_Class(size_t *size)
+{
+    if (!atomic_load_explicit(&block_pool.enabled, memory_order_relaxed)
+     || *size > ((size_t)1 << BLOCK_POOL_MAX_SHIFT))
+        return -1;
+
+    unsigned i = 0;
+    while (block_pool_ClassSize(i) < *size)
+        i++;
+    *size = block_pool_ClassSize(i);
+    return i;
+}
+
+/** Takes a buffer from a busy thread cache. */
+static block_t *block_cache_Take(struct block_cache *cache, unsigned i)
+{
+    struct block_pool_list *list = &cache->classes[i];
+    const size_t size = block_pool_ClassSize(i);
+
+    if (list->first == NULL)
+    {   /* Refill half the thread cache from the shared depot */
+        vlc_mutex_lock(&block_pool.lock);
+        block_pool_Move(list, &block_pool.classes[i],
+                        BLOCK_POOL_THREAD_MAX / size / 2 + 1);
+        vlc_mutex_unlock(&block_pool.lock);
+
+        if (list->first == NULL)
+        {
+            block_cache_Add(&cache->misses);
+            return NULL;
+        }
+        block_cache_SetBytes(cache, atomic_load_explicit(&cache->bytes,
+                             memory_order_relaxed) + list->count * size);
+    }
+
+    block_t *b = list->first;
+
+    list->first = b->p_next;
+    list->count--;
+    block_cache_Add(&cache->hits);
+    block_cache_SetBytes(cache, atomic_load_explicit(&cache->bytes,
+                                            memory_order_relaxed) - size);
+    return b;
+}
+
+static block_t *block_pool_Get(unsigned i)
+{
+    struct block_cache *cache = block_cache_Enter();
+    if (cache == NULL)
+        return NULL;
+
+    block_t *b = block_cache_Take(cache, i);
+    block_cache_Leave(cache);
+    return b;
+}
+
+/** Gives a buffer to a busy thread cache. */
+static void block_cache_Put(struct block_cache *cache, block_t *b,
+                            size_t size)
+{
+    unsigned i = 0;
+    while (block_pool_ClassSize(i) < size)
+        i++;
+
+    struct block_pool_list *list = &cache->classes[i];
+    size_t bytes = atomic_load_explicit(&cache->bytes, memory_order_relaxed);
+
+    b->p_next = list->first;
+    list->first = b;
+    list->count++;
+    bytes += size;
+
+    if (list->count * size > BLOCK_POOL_THREAD_MAX)
+    {   /* High-water mark: give half of the thread cache to the depot */
+        struct block_pool_list half = { NULL, 0 };
+
+        block_pool_Move(&half, list, list->count / 2);
+        bytes -= half.count * size;
+        block_pool_Return(&half, i, half.count);
+    }
+    block_cache_SetBytes(cache, bytes);
+}
+
+static bool block_pool_Put(block_t *b)
+{
+    const size_t size = sizeof (*b) + b->i_size;
+
+    if ((size & (size - 1)) != 0 /* not a size class */
+     || size < ((size_t)1 << BLOCK_POOL_MIN_SHIFT)
+     || size > ((size_t)1 << BLOCK_POOL_MAX_SHIFT))
+        return false;
+
+    struct block_cache *cache = block_cache_Enter();
+    if (cache == NULL)
+        return false;
+
+    block_cache_Put(cache, b, size);
+    block_cache_Leave(cache);
+    return true;
+}
+
+int block_pool_Init(void)
+{
+    int ret = VLC_SUCCESS;
+
+    vlc_mutex_lock(&block_pool.init_lock);
+    if (block_pool.users == 0)
+    {
+        vlc_mutex_lock(&block_pool.lock);
+        if (!block_pool.has_key)
+            block_pool.has_key =
+                vlc_threadvar_create(&block_pool.key, block_cache_Destroy) == 0;
+        if (block_pool.has_key)
+            atomic_store(&block_pool.enabled, true);
+        else
+            ret = VLC_ENOMEM;
+        vlc_mutex_unlock(&block_pool.lock);
+    }
+    if (ret == VLC_SUCCESS)
+        block_pool.users++;
+    vlc_mutex_unlock(&block_pool.init_lock);
+    return ret;
+}
+
+/** Checks if a thread uses its cache, with the pool lock held. */
+static bool block_pool_Busy(void)
+{
+    for (const struct block_cache *c = block_pool.caches; c != NULL;
+         c = c->next)
+        if (atomic_load(&c->busy))
+            return true;
+    return false;
+}
+
+void block_pool_Deinit(void)
+{
+    vlc_mutex_lock(&block_pool.init_lock);
+    assert(block_pool.users > 0);
+    if (--block_pool.users > 0)
+    {
+        vlc_mutex_unlock(&block_pool.init_lock);
+        return;
+    }
+
+    vlc_mutex_lock(&block_pool.lock);
+    atomic_store(&block_pool.enabled, false);
+    /* The threads check the pool state after flagging their cache busy:
+     * once no cache is busy, none will be used until the next user. */
+    while (block_pool_Busy())
+        vlc_cond_wait(&block_pool.idle, &block_pool.lock);
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        block_pool_Free(block_pool.classes[i].first);
+        block_pool.classes[i].first = NULL;
+        block_pool.classes[i].count = 0;
+    }
+    for (struct block_cache *c = block_pool.caches; c != NULL; c = c->next)
+    {
+        for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+        {
+            block_pool_Free(c->classes[i].first);
+            c->classes[i].first = NULL;
+            c->classes[i].count = 0;
+        }
+        block_cache_SetBytes(c, 0);
+    }
+
+    /* The remaining caches are freed when their threads exit */
+    if (block_pool.caches == NULL)
+    {
+        vlc_threadvar_delete(&block_pool.key);
+        block_pool.has_key = false;
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+    vlc_mutex_unlock(&block_pool.init_lock);
+}
+
+void block_pool_GetStats(struct block_pool_stats *stats)
+{
+    vlc_mutex_lock(&block_pool.lock);
+    stats->hits = block_pool.hits;
+    stats->misses = block_pool.misses;
+    stats->bytes = 0;
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+        stats->bytes += block_pool.classes[i].count * block_pool_ClassSize(i);
+    for (const struct block_cache *c = block_pool.caches; c != NULL;
+         c = c->next)
+    {
+        stats->hits += atomic_load_explicit(&c->hits, memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&c->misses,
+                                              memory_order_relaxed);
+        stats->bytes += atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+}
+
 static void block_generic_Release (block_t *block)
 {
     /* That is always true for blocks allocated with block_Alloc(). */
     assert (block->p_start == (unsigned char *)(block + 1));
     block_Invalidate (block);
-    free (block);
+    if (!block_pool_Put (block))
+        free (block);
 }
 
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
@@ -120,12 +546,17 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    /* The whole size class is used: the extra space is left as headroom at
+     * the end of the buffer, for block_TryRealloc(). */
+    int pool = block_pool_Class (&alloc);
+    block_t *b = (pool >= 0) ? block_pool_Get (pool) : NULL;
+    if (b == NULL)
+        b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
 
@@ -259,6 +690,84 @@ block_t *block_heap_Alloc (void *addr, size_t length)
     return block;
 }
 
+/* Slices of a shared block */
+typedef struct
+{
+    atomic_uint refs;
+    block_t *parent;
+} block_slice_owner_t;
+
+typedef struct
+{
+    block_t self;
+    block_slice_owner_t *owner;
+} block_slice_t;
+
+static void block_slice_Release (block_t *block)
+{
+    block_slice_t *slice = (block_slice_t *)block;
+    block_slice_owner_t *owner = slice->owner;
+
+    block_Invalidate (block);
+    free (slice);
+
+    if (atomic_fetch_sub_explicit (&owner->refs, 1,
+                                   memory_order_acq_rel) == 1)
+    {
+        block_Release (owner->parent);
+        free (owner);
+    }
+}
+
+static block_t *block_slice_New (block_slice_owner_t *owner,
+                                 uint8_t *buf, size_t length)
+{
+    block_slice_t *slice = malloc (sizeof (*slice));
+    if (unlikely(slice == NULL))
+        return NULL;
+
+    block_Init (&slice->self, buf, length);
+    slice->self.pf_release = block_slice_Release;
+    slice->owner = owner;
+    return &slice->self;
+}
+
+block_t *block_slice_Alloc (block_t *parent)
+{
+    block_slice_owner_t *owner = malloc (sizeof (*owner));
+    if (unlikely(owner == NULL))
+    {
+        block_Release (parent);
+        return NULL;
+    }
+
+    block_t *block = block_slice_New (owner, parent->p_buffer,
+                                      parent->i_buffer);
+    if (unlikely(block == NULL))
+    {
+        free (owner);
+        block_Release (parent);
+        return NULL;
+    }
+
+    atomic_init (&owner->refs, 1);
+    owner->parent = parent;
+    block_CopyProperties (block, parent);
+    return block;
+}
+
+block_t *block_Slice (block_t *block, size_t offset, size_t length)
+{
+    assert (block->pf_release == block_slice_Release);
+    assert (offset <= block->i_buffer && length <= block->i_buffer - offset);
+
+    block_slice_owner_t *owner = ((block_slice_t *)block)->owner;
+    block_t *slice = block_slice_New (owner, block->p_buffer + offset, length);
+    if (likely(slice != NULL))
+        atomic_fetch_add_explicit (&owner->refs, 1, memory_order_relaxed);
+    return slice;
+}
+
 #ifdef HAVE_MMAP
 # include <sys/mman.h>
 
@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -233,3 +234,173 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * Internal state for lock-free block queues
+ */
+struct vlc_ring
+{
+    /* Written by the producer */
+    atomic_size_t tail;
+    atomic_size_t pushed_count;
+    atomic_size_t pushed_bytes;
+    atomic_size_t discard; /**< Items before this index are discarded */
+    atomic_size_t discard_count;
+    atomic_size_t discard_bytes;
+
+    /* Written by the consumer */
+    atomic_size_t head;
+    atomic_size_t popped_count;
+    atomic_size_t popped_bytes;
+
+    size_t mask;
+    block_t *slots[];
+};
+
+/* Wrap-around safe comparison of indices and counters */
+static inline bool vlc_ring_Before(size_t a, size_t b)
+{
+    return (size_t)(b - a - 1) < (SIZE_MAX / 2);
+}
+
+static inline size_t vlc_ring_Max(size_t a, size_t b)
+{
+    return vlc_ring_Before(a, b) ? b : a;
+}
+
+vlc_ring_t *vlc_ring_New(size_t max)
+{
+    size_t size = 1;
+
+    while (size < max)
+    {
+        size <<= 1;
+        if (unlikely(size == 0))
+            return NULL;
+    }
+
+    vlc_ring_t *ring = malloc(sizeof (*ring) + size * sizeof (block_t *));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->pushed_count, 0);
+    atomic_init(&ring->pushed_bytes, 0);
+    atomic_init(&ring->discard, 0);
+    atomic_init(&ring->discard_count, 0);
+    atomic_init(&ring->discard_bytes, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->popped_count, 0);
+    atomic_init(&ring->popped_bytes, 0);
+    ring->mask = size - 1;
+    return ring;
+}
+
+void vlc_ring_Delete(vlc_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    while (head != tail)
+        block_ChainRelease(ring->slots[head++ & ring->mask]);
+
+    free(ring);
+}
+
+bool vlc_ring_Push(vlc_ring_t *ring, block_t *block)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    assert(block != NULL);
+
+    if (tail - head > ring->mask)
+        return false; /* Full */
+
+    size_t count = 0, bytes = 0;
+
+    for (const block_t *b = block; b != NULL; b = b->p_next)
+    {
+        count++;
+        bytes += b->i_buffer;
+    }
+
+    ring->slots[tail & ring->mask] = block;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    atomic_fetch_add(&ring->pushed_count, count);
+    atomic_fetch_add(&ring->pushed_bytes, bytes);
+    return true;
+}
+
+block_t *vlc_ring_Pop(vlc_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head == tail)
+            return NULL; /* Empty */
+
+        size_t discard = atomic_load_explicit(&ring->discard,
+                                              memory_order_acquire);
+        block_t **slot = &ring->slots[head & ring->mask];
+        block_t *block = *slot;
+
+        if (vlc_ring_Before(head, discard))
+        {   /* Drop the (remaining) blocks of a discarded item */
+            size_t count = 0, bytes = 0;
+
+            for (const block_t *b = block; b != NULL; b = b->p_next)
+            {
+                count++;
+                bytes += b->i_buffer;
+            }
+            block_ChainRelease(block);
+            atomic_fetch_add(&ring->popped_count, count);
+            atomic_fetch_add(&ring->popped_bytes, bytes);
+            atomic_store_explicit(&ring->head, ++head, memory_order_release);
+            continue;
+        }
+
+        if (block->p_next != NULL)
+        {   /* Split the list: the rest stays in the same slot */
+            *slot = block->p_next;
+            block->p_next = NULL;
+        }
+        else
+            atomic_store_explicit(&ring->head, head + 1,
+                                  memory_order_release);
+
+        atomic_fetch_add(&ring->popped_count, 1);
+        atomic_fetch_add(&ring->popped_bytes, block->i_buffer);
+        return block;
+    }
+}
+
+void vlc_ring_Discard(vlc_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store(&ring->discard_count, atomic_load(&ring->pushed_count));
+    atomic_store(&ring->discard_bytes, atomic_load(&ring->pushed_bytes));
+    atomic_store_explicit(&ring->discard, tail, memory_order_release);
+}
+
+size_t vlc_ring_GetCount(const vlc_ring_t *ring)
+{
+    size_t popped = vlc_ring_Max(atomic_load(&ring->popped_count),
+                                 atomic_load(&ring->discard_count));
+    size_t pushed = atomic_load(&ring->pushed_count);
+
+    return vlc_ring_Before(pushed, popped) ? 0 : pushed - popped;
+}
+
+size_t vlc_ring_GetBytes(const vlc_ring_t *ring)
+{
+    size_t popped = vlc_ring_Max(atomic_load(&ring->popped_bytes),
+                                 atomic_load(&ring->discard_bytes));
+    size_t pushed = atomic_load(&ring->pushed_bytes);
+
+    return vlc_ring_Before(pushed, popped) ? 0 : pushed - popped;
+}
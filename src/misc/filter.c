@@ -180,6 +180,184 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/* */
+
+struct slice_job
+{
+    filter_t *filter;
+    filter_slice_cb cb;
+    void *opaque;
+    unsigned next; /**< next slice to run */
+    unsigned done; /**< slices completed */
+    struct slice_job *p_next;
+};
+
+struct vlc_slice_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /**< a job was queued */
+    vlc_cond_t done; /**< a slice was completed */
+    struct slice_job *first, **lastp; /**< jobs with slices left to run */
+    bool exit;
+    unsigned count; /**< number of slices per job */
+    unsigned threads;
+    vlc_thread_t thread[];
+};
+
+static vlc_mutex_t slice_pool_lock = VLC_STATIC_MUTEX;
+
+/* Takes the next slice of the first queued job, with the pool lock held */
+static unsigned SliceTake(struct vlc_slice_pool *pool, struct slice_job *job)
+{
+    unsigned index = job->next++;
+
+    if (job->next == pool->count)
+    {   /* No slices left: dequeue the job */
+        struct slice_job **pp = &pool->first;
+        while (*pp != job)
+            pp = &(*pp)->p_next;
+        *pp = job->p_next;
+        if (pool->lastp == &job->p_next)
+            pool->lastp = pp;
+    }
+    return index;
+}
+
+static void SliceRun(struct vlc_slice_pool *pool, struct slice_job *job,
+                     unsigned index)
+{
+    vlc_mutex_unlock(&pool->lock);
+    job->cb(job->filter, job->opaque, index, pool->count);
+    vlc_mutex_lock(&pool->lock);
+
+    if (++job->done == pool->count)
+        vlc_cond_broadcast(&pool->done);
+}
+
+static void *SliceThread(void *data)
+{
+    struct vlc_slice_pool *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->first == NULL && !pool->exit)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->exit)
+            break;
+
+        struct slice_job *job = pool->first;
+        SliceRun(pool, job, SliceTake(pool, job));
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static struct vlc_slice_pool *SlicePoolNew(vlc_object_t *obj)
+{
+    int64_t count = var_InheritInteger(obj, "filter-threads");
+    if (count <= 0)
+        count = vlc_GetCPUCount();
+    if (count > 64)
+        count = 64;
+
+    /* The calling thread runs slices too */
+    unsigned threads = count - 1;
+    struct vlc_slice_pool *pool = malloc(sizeof (*pool)
+                                         + threads * sizeof (vlc_thread_t));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->first = NULL;
+    pool->lastp = &pool->first;
+    pool->exit = false;
+    pool->threads = 0;
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        if (vlc_clone(&pool->thread[i], SliceThread, pool,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        pool->threads++;
+    }
+    pool->count = pool->threads + 1;
+
+    msg_Dbg(obj, "using %u video filter thread(s)", pool->count);
+    return pool;
+}
+
+void vlc_slice_pool_Delete(struct vlc_slice_pool *pool)
+{
+    vlc_mutex_lock(&pool->lock);
+    assert(pool->first == NULL);
+    pool->exit = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->threads; i++)
+        vlc_join(pool->thread[i], NULL);
+
+    vlc_cond_destroy(&pool->done);
+    vlc_cond_destroy(&pool->wait);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static struct vlc_slice_pool *GetSlicePool(filter_t *filter)
+{
+    libvlc_priv_t *priv = libvlc_priv(filter->obj.libvlc);
+    struct vlc_slice_pool *pool;
+
+    vlc_mutex_lock(&slice_pool_lock);
+    pool = priv->slice_pool;
+    if (pool == NULL)
+        pool = priv->slice_pool =
+            SlicePoolNew(VLC_OBJECT(filter->obj.libvlc));
+    vlc_mutex_unlock(&slice_pool_lock);
+    return pool;
+}
+
+unsigned filter_GetSliceCount(filter_t *filter)
+{
+    struct vlc_slice_pool *pool = GetSlicePool(filter);
+    return (pool != NULL) ? pool->count : 1;
+}
+
+void filter_ExecuteSlices(filter_t *filter, filter_slice_cb cb, void *opaque)
+{
+    struct vlc_slice_pool *pool = GetSlicePool(filter);
+
+    if (pool == NULL || pool->threads == 0)
+    {
+        cb(filter, opaque, 0, 1);
+        return;
+    }
+
+    struct slice_job job = {
+        .filter = filter,
+        .cb = cb,
+        .opaque = opaque,
+        .next = 0,
+        .done = 0,
+        .p_next = NULL,
+    };
+
+    vlc_mutex_lock(&pool->lock);
+    *pool->lastp = &job;
+    pool->lastp = &job.p_next;
+    vlc_cond_broadcast(&pool->wait);
+
+    /* Help with our own slices, then wait for the ones taken by the pool */
+    while (job.next < pool->count)
+        SliceRun(pool, &job, SliceTake(pool, &job));
+    while (job.done < pool->count)
+        vlc_cond_wait(&pool->done, &pool->lock);
+    vlc_mutex_unlock(&pool->lock);
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
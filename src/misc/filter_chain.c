@@ -40,6 +40,8 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+    mtime_t time; /**< Time spent in the video filter callback */
+    unsigned pictures; /**< Pictures given to the video filter callback */
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -247,6 +249,8 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    chained->time = 0;
+    chained->pictures = 0;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -301,6 +305,10 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
         chain->last = chained->prev;
     }
 
+    if( chained->pictures > 0 )
+        msg_Dbg( obj, "Filter '%s' (%p): %u pictures, %"PRId64" us per picture",
+                 module_get_name( filter->p_module, false ), (void *)filter,
+                 chained->pictures, chained->time / chained->pictures );
     module_unneed( filter, filter->p_module );
 
     msg_Dbg( obj, "Filter %p removed from chain", (void *)filter );
@@ -396,7 +404,11 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        mtime_t start = mdate();
+
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        f->time += mdate() - start;
+        f->pictures++;
         if( !p_pic )
             break;
         if( f->pending )
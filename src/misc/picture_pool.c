@@ -34,21 +34,34 @@
 #include <vlc_atomic.h>
 #include "picture.h"
 
-#define POOL_MAX (CHAR_BIT * sizeof (unsigned long long))
+#define POOL_WORD_BITS (CHAR_BIT * sizeof (unsigned long long))
+#define POOL_WORDS 16
+#define POOL_MAX (POOL_WORDS * POOL_WORD_BITS)
+/* Pictures that can be added to a heap pool with picture_pool_Grow() */
+#define POOL_GROWTH 64
 
-static_assert ((POOL_MAX & (POOL_MAX - 1)) == 0, "Not a power of two");
+struct picture_pool_slot {
+    picture_pool_t *pool;
+    picture_t      *picture;
+};
 
 struct picture_pool_t {
     int       (*pic_lock)(picture_t *);
     void      (*pic_unlock)(picture_t *);
+    /* Only used to sleep in picture_pool_Wait() and to serialize
+     * picture_pool_Grow(): the bitmap is updated without it. */
     vlc_mutex_t lock;
     vlc_cond_t  wait;
-
-    bool               canceled;
-    unsigned long long available;
-    atomic_ushort      refs;
-    unsigned short     picture_count;
-    picture_t  *picture[];
+    atomic_uint waiters;
+
+    atomic_bool        canceled;
+    atomic_ullong      available[POOL_WORDS];
+    atomic_uint        refs;
+    atomic_uint        picture_count;
+    unsigned           capacity;
+    bool               can_grow;
+    video_format_t     fmt; /* only if can_grow */
+    struct picture_pool_slot slot[];
 };
 
 static void picture_pool_Destroy(picture_pool_t *pool)
@@ -56,25 +69,70 @@ static void picture_pool_Destroy(picture_pool_t *pool)
     if (atomic_fetch_sub(&pool->refs, 1) != 1)
         return;
 
+    if (pool->can_grow)
+        video_format_Clean(&pool->fmt);
     vlc_cond_destroy(&pool->wait);
     vlc_mutex_destroy(&pool->lock);
-    aligned_free(pool);
+    free(pool);
 }
 
 void picture_pool_Release(picture_pool_t *pool)
 {
-    for (unsigned i = 0; i < pool->picture_count; i++)
-        picture_Release(pool->picture[i]);
+    unsigned count = atomic_load(&pool->picture_count);
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(pool->slot[i].picture);
     picture_pool_Destroy(pool);
 }
 
+/** Takes a free picture offset out of the bitmap, without locking */
+static int picture_pool_Acquire(picture_pool_t *pool)
+{
+    unsigned count = atomic_load(&pool->picture_count);
+
+    for (unsigned w = 0; w * POOL_WORD_BITS < count; w++) {
+        unsigned long long word = atomic_load(&pool->available[w]);
+
+        while (word != 0) {
+            unsigned bit = ffsll(word) - 1;
+
+            if (atomic_compare_exchange_weak(&pool->available[w], &word,
+                                             word & ~(1ULL << bit)))
+                return w * POOL_WORD_BITS + bit;
+        }
+    }
+    return -1;
+}
+
+/** Puts a picture offset back in the bitmap, without locking */
+static void picture_pool_Free(picture_pool_t *pool, unsigned offset)
+{
+    unsigned long long bit = 1ULL << (offset % POOL_WORD_BITS);
+    unsigned long long prev;
+
+    prev = atomic_fetch_or(&pool->available[offset / POOL_WORD_BITS], bit);
+    assert(!(prev & bit));
+    (void) prev;
+}
+
+/** Puts a picture offset back in the bitmap and wakes a waiter up, if any */
+static void picture_pool_Return(picture_pool_t *pool, unsigned offset)
+{
+    picture_pool_Free(pool, offset);
+
+    if (atomic_load(&pool->waiters) > 0) {
+        vlc_mutex_lock(&pool->lock);
+        vlc_cond_signal(&pool->wait);
+        vlc_mutex_unlock(&pool->lock);
+    }
+}
+
 static void picture_pool_ReleasePicture(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
-    uintptr_t sys = (uintptr_t)priv->gc.opaque;
-    picture_pool_t *pool = (void *)(sys & ~(POOL_MAX - 1));
-    unsigned offset = sys & (POOL_MAX - 1);
-    picture_t *picture = pool->picture[offset];
+    struct picture_pool_slot *slot = priv->gc.opaque;
+    picture_pool_t *pool = slot->pool;
+    picture_t *picture = slot->picture;
 
     free(clone);
 
@@ -82,20 +140,14 @@ static void picture_pool_ReleasePicture(picture_t *clone)
         pool->pic_unlock(picture);
     picture_Release(picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
-    vlc_cond_signal(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
-
+    picture_pool_Return(pool, slot - pool->slot);
     picture_pool_Destroy(pool);
 }
 
 static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
                                             unsigned offset)
 {
-    picture_t *picture = pool->picture[offset];
-    uintptr_t sys = ((uintptr_t)pool) + offset;
+    picture_t *picture = pool->slot[offset].picture;
     picture_resource_t res = {
         .p_sys = picture->p_sys,
         .pf_destroy = picture_pool_ReleasePicture,
@@ -108,23 +160,29 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
     }
 
     picture_t *clone = picture_NewFromResource(&picture->format, &res);
-    if (likely(clone != NULL)) {
-        ((picture_priv_t *)clone)->gc.opaque = (void *)sys;
-        picture_Hold(picture);
+    if (unlikely(clone == NULL)) {
+        if (pool->pic_unlock != NULL)
+            pool->pic_unlock(picture);
+        picture_pool_Return(pool, offset);
+        return NULL;
     }
+
+    ((picture_priv_t *)clone)->gc.opaque = &pool->slot[offset];
+    picture_Hold(picture);
+    assert(clone->p_next == NULL);
+    atomic_fetch_add(&pool->refs, 1);
     return clone;
 }
 
-picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg)
+static picture_pool_t *picture_pool_Alloc(const picture_pool_configuration_t *cfg,
+                                          unsigned capacity)
 {
-    if (unlikely(cfg->picture_count > POOL_MAX))
+    assert(cfg->picture_count <= capacity);
+    if (unlikely(capacity > POOL_MAX))
         return NULL;
 
-    picture_pool_t *pool;
-    size_t size = sizeof (*pool) + cfg->picture_count * sizeof (picture_t *);
-
-    size += (-size) & (POOL_MAX - 1);
-    pool = aligned_alloc(POOL_MAX, size);
+    picture_pool_t *pool = malloc(sizeof (*pool)
+                                  + capacity * sizeof (pool->slot[0]));
     if (unlikely(pool == NULL))
         return NULL;
 
@@ -132,18 +190,35 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
     pool->pic_unlock = cfg->unlock;
     vlc_mutex_init(&pool->lock);
     vlc_cond_init(&pool->wait);
-    if (cfg->picture_count == POOL_MAX)
-        pool->available = ~0ULL;
-    else
-        pool->available = (1ULL << cfg->picture_count) - 1;
-    atomic_init(&pool->refs,  1);
-    pool->picture_count = cfg->picture_count;
-    memcpy(pool->picture, cfg->picture,
-           cfg->picture_count * sizeof (picture_t *));
-    pool->canceled = false;
+    atomic_init(&pool->waiters, 0);
+    atomic_init(&pool->canceled, false);
+
+    for (unsigned w = 0; w < POOL_WORDS; w++) {
+        unsigned long long word = 0;
+
+        if (cfg->picture_count >= (w + 1) * POOL_WORD_BITS)
+            word = ~0ULL;
+        else if (cfg->picture_count > w * POOL_WORD_BITS)
+            word = (1ULL << (cfg->picture_count % POOL_WORD_BITS)) - 1;
+        atomic_init(&pool->available[w], word);
+    }
+
+    atomic_init(&pool->refs, 1);
+    atomic_init(&pool->picture_count, cfg->picture_count);
+    pool->capacity = capacity;
+    pool->can_grow = false;
+    for (unsigned i = 0; i < cfg->picture_count; i++) {
+        pool->slot[i].pool = pool;
+        pool->slot[i].picture = cfg->picture[i];
+    }
     return pool;
 }
 
+picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg)
+{
+    return picture_pool_Alloc(cfg, cfg->picture_count);
+}
+
 picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
 {
     picture_pool_configuration_t cfg = {
@@ -160,16 +235,26 @@ picture_pool_t *picture_pool_NewFromFormat(const video_format_t *fmt,
     picture_t *picture[count ? count : 1];
     unsigned i;
 
+    if (unlikely(count > POOL_MAX))
+        return NULL;
+
     for (i = 0; i < count; i++) {
         picture[i] = picture_NewFromFormat(fmt);
         if (picture[i] == NULL)
             goto error;
     }
 
-    picture_pool_t *pool = picture_pool_New(count, picture);
+    /* Heap pictures can be added later, keep room for them */
+    picture_pool_configuration_t cfg = {
+        .picture_count = count,
+        .picture = picture,
+    };
+    picture_pool_t *pool = picture_pool_Alloc(&cfg,
+                                              __MIN(count + POOL_GROWTH, POOL_MAX));
     if (!pool)
         goto error;
 
+    pool->can_grow = video_format_Copy(&pool->fmt, fmt) == VLC_SUCCESS;
     return pool;
 
 error:
@@ -178,6 +263,37 @@ error:
     return NULL;
 }
 
+int picture_pool_Grow(picture_pool_t *pool, unsigned count)
+{
+    int ret = VLC_SUCCESS;
+
+    vlc_mutex_lock(&pool->lock);
+
+    unsigned total = atomic_load(&pool->picture_count);
+    if (!pool->can_grow || pool->capacity - total < count)
+        ret = VLC_EGENERIC;
+
+    while (ret == VLC_SUCCESS && count > 0) {
+        picture_t *picture = picture_NewFromFormat(&pool->fmt);
+        if (picture == NULL) {
+            ret = VLC_ENOMEM;
+            break;
+        }
+
+        pool->slot[total].pool = pool;
+        pool->slot[total].picture = picture;
+        /* Publish the slot before its availability bit */
+        atomic_store(&pool->picture_count, total + 1);
+        picture_pool_Free(pool, total);
+        total++;
+        count--;
+    }
+
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+    return ret;
+}
+
 picture_pool_t *picture_pool_Reserve(picture_pool_t *master, unsigned count)
 {
     picture_t *picture[count ? count : 1];
@@ -201,96 +317,80 @@ error:
     return NULL;
 }
 
-/** Find next (bit) set */
-static int fnsll(unsigned long long x, unsigned i)
+static picture_t *picture_pool_Lock(picture_pool_t *pool, unsigned offset)
 {
-    if (i >= CHAR_BIT * sizeof (x))
-        return 0;
-    return ffsll(x & ~((1ULL << i) - 1));
+    picture_t *picture = pool->slot[offset].picture;
+
+    if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
+        picture_pool_Return(pool, offset);
+        return NULL;
+    }
+
+    return picture_pool_ClonePicture(pool, offset);
 }
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load(&pool->refs) > 0);
 
-    if (pool->canceled)
-    {
-        vlc_mutex_unlock(&pool->lock);
+    if (atomic_load(&pool->canceled))
         return NULL;
-    }
 
-    for (unsigned i = ffsll(pool->available); i; i = fnsll(pool->available, i))
-    {
-        pool->available &= ~(1ULL << (i - 1));
-        vlc_mutex_unlock(&pool->lock);
+    /* Pictures failing to lock are retried later, not in this call */
+    unsigned long long skipped[POOL_WORDS] = { 0 };
+    picture_t *clone = NULL;
+    int offset;
 
-        picture_t *picture = pool->picture[i - 1];
+    while ((offset = picture_pool_Acquire(pool)) >= 0) {
+        picture_t *picture = pool->slot[offset].picture;
 
         if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
-            vlc_mutex_lock(&pool->lock);
-            pool->available |= 1ULL << (i - 1);
+            skipped[offset / POOL_WORD_BITS] |= 1ULL << (offset % POOL_WORD_BITS);
             continue;
         }
 
-        picture_t *clone = picture_pool_ClonePicture(pool, i - 1);
-        if (clone != NULL) {
-            assert(clone->p_next == NULL);
-            atomic_fetch_add(&pool->refs, 1);
-        }
-        return clone;
+        clone = picture_pool_ClonePicture(pool, offset);
+        break;
     }
 
-    vlc_mutex_unlock(&pool->lock);
-    return NULL;
+    for (unsigned w = 0; w < POOL_WORDS; w++)
+        for (unsigned long long word = skipped[w]; word != 0;
+             word &= word - 1)
+            picture_pool_Return(pool, w * POOL_WORD_BITS + ffsll(word) - 1);
+    return clone;
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
-    unsigned i;
-
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
-
-    while (pool->available == 0)
-    {
-        if (pool->canceled)
-        {
-            vlc_mutex_unlock(&pool->lock);
-            return NULL;
-        }
-        vlc_cond_wait(&pool->wait, &pool->lock);
-    }
-
-    i = ffsll(pool->available);
-    assert(i > 0);
-    pool->available &= ~(1ULL << (i - 1));
-    vlc_mutex_unlock(&pool->lock);
+    int offset;
 
-    picture_t *picture = pool->picture[i - 1];
+    assert(atomic_load(&pool->refs) > 0);
 
-    if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
+    offset = picture_pool_Acquire(pool);
+    if (offset < 0) {
         vlc_mutex_lock(&pool->lock);
-        pool->available |= 1ULL << (i - 1);
-        vlc_cond_signal(&pool->wait);
+        /* The waiter must be visible before the bitmap is checked again,
+         * so that a concurrent release signals it. */
+        atomic_fetch_add(&pool->waiters, 1);
+        while ((offset = picture_pool_Acquire(pool)) < 0
+            && !atomic_load(&pool->canceled))
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        atomic_fetch_sub(&pool->waiters, 1);
         vlc_mutex_unlock(&pool->lock);
-        return NULL;
-    }
 
-    picture_t *clone = picture_pool_ClonePicture(pool, i - 1);
-    if (clone != NULL) {
-        assert(clone->p_next == NULL);
-        atomic_fetch_add(&pool->refs, 1);
+        if (offset < 0)
+            return NULL;
     }
-    return clone;
+
+    return picture_pool_Lock(pool, offset);
 }
 
 void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
 {
     vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load(&pool->refs) > 0);
 
-    pool->canceled = canceled;
+    atomic_store(&pool->canceled, canceled);
     if (canceled)
         vlc_cond_broadcast(&pool->wait);
     vlc_mutex_unlock(&pool->lock);
@@ -305,21 +405,22 @@ bool picture_pool_OwnsPic(picture_pool_t *pool, picture_t *pic)
         priv = (picture_priv_t *)pic;
     }
 
-    uintptr_t sys = (uintptr_t)priv->gc.opaque;
-    picture_pool_t *picpool = (void *)(sys & ~(POOL_MAX - 1));
-    return pool == picpool;
+    const struct picture_pool_slot *slot = priv->gc.opaque;
+    return pool == slot->pool;
 }
 
 unsigned picture_pool_GetSize(const picture_pool_t *pool)
 {
-    return pool->picture_count;
+    return atomic_load(&pool->picture_count);
 }
 
 void picture_pool_Enum(picture_pool_t *pool, void (*cb)(void *, picture_t *),
                        void *opaque)
 {
-    /* NOTE: So far, the pictures table cannot change after the pool is created
-     * so there is no need to lock the pool mutex here. */
-    for (unsigned i = 0; i < pool->picture_count; i++)
-        cb(opaque, pool->picture[i]);
+    /* NOTE: Pictures are only ever appended to the table, and published by
+     * the count, so there is no need to lock the pool mutex here. */
+    unsigned count = atomic_load(&pool->picture_count);
+
+    for (unsigned i = 0; i < count; i++)
+        cb(opaque, pool->slot[i].picture);
 }
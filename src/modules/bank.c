@@ -54,6 +54,8 @@ typedef struct vlc_modcap
     char *name;
     module_t **modv;
     size_t modc;
+    vlc_modname_t *namev; /**< Shortcuts, sorted by name then rank */
+    size_t namec;
 } vlc_modcap_t;
 
 static int vlc_modcap_cmp(const void *a, const void *b)
@@ -66,6 +68,7 @@ static void vlc_modcap_free(void *data)
 {
     vlc_modcap_t *cap = data;
 
+    free(cap->namev);
     free(cap->modv);
     free(cap->name);
     free(cap);
@@ -79,6 +82,50 @@ static int vlc_module_cmp (const void *a, const void *b)
     return (*mb)->i_score - (*ma)->i_score;
 }
 
+static int vlc_modname_cmp(const void *a, const void *b)
+{
+    const vlc_modname_t *na = a, *nb = b;
+    int ret = strcasecmp(na->name, nb->name);
+
+    if (ret == 0)
+        ret = (na->rank > nb->rank) - (na->rank < nb->rank);
+    return ret;
+}
+
+/**
+ * Indexes the modules of a capability by shortcut, so that explicit module
+ * requests do not compare the name with every candidate.
+ */
+static void vlc_modcap_index(vlc_modcap_t *cap)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < cap->modc; i++)
+        n += cap->modv[i]->i_shortcuts;
+
+    free(cap->namev);
+    cap->namev = vlc_alloc(n, sizeof (*cap->namev));
+    cap->namec = 0;
+    if (unlikely(cap->namev == NULL))
+        return;
+
+    for (size_t i = 0; i < cap->modc; i++)
+    {
+        module_t *mod = cap->modv[i];
+
+        for (unsigned j = 0; j < mod->i_shortcuts; j++)
+        {
+            vlc_modname_t *entry = cap->namev + cap->namec++;
+
+            entry->name = mod->pp_shortcuts[j];
+            entry->module = mod;
+            entry->rank = i;
+        }
+    }
+
+    qsort(cap->namev, cap->namec, sizeof (*cap->namev), vlc_modname_cmp);
+}
+
 static void vlc_modcap_sort(const void *node, const VISIT which,
                             const int depth)
 {
@@ -88,6 +135,7 @@ static void vlc_modcap_sort(const void *node, const VISIT which,
         return;
 
     qsort(cap->modv, cap->modc, sizeof (*cap->modv), vlc_module_cmp);
+    vlc_modcap_index(cap);
     (void) depth;
 }
 
@@ -96,8 +144,10 @@ static struct
     vlc_mutex_t lock;
     block_t *caches;
     void *caps_tree;
+    vlc_modname_t *namev; /**< Modules by object name */
+    size_t namec;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, NULL, 0 };
+} modules = { VLC_STATIC_MUTEX, NULL, NULL, NULL, 0, 0 };
 
 vlc_plugin_t *vlc_plugins = NULL;
 
@@ -114,6 +164,8 @@ static int vlc_module_store(module_t *mod)
     cap->name = strdup(name);
     cap->modv = NULL;
     cap->modc = 0;
+    cap->namev = NULL;
+    cap->namec = 0;
 
     if (unlikely(cap->name == NULL))
         goto error;
@@ -612,6 +664,7 @@ void module_EndBank (bool b_plugins)
     vlc_plugin_t *libs = NULL;
     block_t *caches = NULL;
     void *caps_tree = NULL;
+    vlc_modname_t *namev = NULL;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
      * from module_InitBank(). */
@@ -627,13 +680,17 @@ void module_EndBank (bool b_plugins)
         libs = vlc_plugins;
         caches = modules.caches;
         caps_tree = modules.caps_tree;
+        namev = modules.namev;
         vlc_plugins = NULL;
         modules.caches = NULL;
         modules.caps_tree = NULL;
+        modules.namev = NULL;
+        modules.namec = 0;
     }
     vlc_mutex_unlock (&modules.lock);
 
     tdestroy(caps_tree, vlc_modcap_free);
+    free(namev);
 
     while (libs != NULL)
     {
@@ -647,6 +704,50 @@ void module_EndBank (bool b_plugins)
     block_ChainRelease(caches);
 }
 
+static int vlc_modname_strcmp(const void *a, const void *b)
+{
+    const vlc_modname_t *na = a, *nb = b;
+    int ret = strcmp(na->name, nb->name);
+
+    if (ret == 0)
+        ret = (na->rank > nb->rank) - (na->rank < nb->rank);
+    return ret;
+}
+
+/**
+ * Indexes all modules by object name (i.e. first shortcut), for module_find().
+ */
+static void vlc_modname_index(void)
+{
+    size_t count;
+    module_t **list = module_list_get(&count);
+
+    free(modules.namev);
+    modules.namev = vlc_alloc(count, sizeof (*modules.namev));
+    modules.namec = 0;
+
+    if (likely(modules.namev != NULL))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            module_t *mod = list[i];
+
+            if (unlikely(mod->i_shortcuts == 0))
+                continue;
+
+            vlc_modname_t *entry = modules.namev + modules.namec++;
+
+            entry->name = mod->pp_shortcuts[0];
+            entry->module = mod;
+            entry->rank = i;
+        }
+
+        qsort(modules.namev, modules.namec, sizeof (*modules.namev),
+              vlc_modname_strcmp);
+    }
+    module_list_free(list);
+}
+
 #undef module_LoadPlugins
 /**
  * Loads module descriptions for all available plugins.
@@ -670,6 +771,7 @@ size_t module_LoadPlugins (vlc_object_t *obj)
         config_SortConfig ();
 
         twalk(modules.caps_tree, vlc_modcap_sort);
+        vlc_modname_index();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -749,3 +851,76 @@ ssize_t module_list_cap (module_t ***restrict list, const char *name)
     memcpy(tab, cap->modv, sizeof (*tab) * n);
     return n;
 }
+
+/**
+ * Looks up the modules of a given capability having a given shortcut.
+ * @param cap capability name
+ * @param name shortcut to look for (case-insensitive)
+ * @param list pointer to the matching index entries [OUT], sorted by
+ *             decreasing module score; the entry ranks are the positions of
+ *             the modules in the list from module_list_cap()
+ * @return the number of matching entries
+ */
+size_t module_list_cap_find(const char *cap, const char *name,
+                            const vlc_modname_t **restrict list)
+{
+    const vlc_modcap_t **cp = tfind(&cap, &modules.caps_tree, vlc_modcap_cmp);
+    if (cp == NULL)
+    {
+        *list = NULL;
+        return 0;
+    }
+
+    const vlc_modcap_t *c = *cp;
+    size_t lo = 0, hi = c->namec;
+
+    /* Lower bound */
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (strcasecmp(c->namev[mid].name, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    size_t end = lo;
+    while (end < c->namec && !strcasecmp(c->namev[end].name, name))
+        end++;
+
+    *list = c->namev + lo;
+    return end - lo;
+}
+
+/**
+ * Finds a module by object name.
+ * @return the module, or NULL if not found
+ */
+module_t *module_list_find(const char *name)
+{
+    if (modules.namev == NULL)
+    {   /* Plugins not loaded yet */
+        for (vlc_plugin_t *lib = vlc_plugins; lib != NULL; lib = lib->next)
+            for (module_t *m = lib->module; m != NULL; m = m->next)
+                if (m->i_shortcuts > 0 && !strcmp(m->pp_shortcuts[0], name))
+                    return m;
+        return NULL;
+    }
+
+    size_t lo = 0, hi = modules.namec;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (strcmp(modules.namev[mid].name, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < modules.namec && !strcmp(modules.namev[lo].name, name))
+        return modules.namev[lo].module;
+    return NULL;
+}
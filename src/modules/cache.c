@@ -57,13 +57,100 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 34
+#define CACHE_SUBVERSION_NUM 35
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * The cache file is a memory image, mapped and used in place. Following the
+ * magic strings and the header marker, an 8-bytes aligned header locates
+ * tables of fixed-size records. Records refer to each other by index, and to
+ * strings by offset within the string table, so that the image does not
+ * need any relocation. String offset 0 stands for NULL.
+ *
+ * The string table begins with the strings needed to register the plugins
+ * and resolve the configuration (names, capabilities, shortcuts, defaults).
+ * Descriptions and help texts come last: their pages are only faulted in
+ * when some user interface actually displays them.
+ */
+typedef struct
+{
+    uint32_t size; /**< Size of this header */
+    uint32_t plugin_size; /**< Size of a plugin record */
+    uint32_t module_size; /**< Size of a module record */
+    uint32_t config_size; /**< Size of a configuration item record */
+    uint32_t plugins, plugins_count; /**< Plugin records offset and count */
+    uint32_t modules, modules_count; /**< Module records offset and count */
+    uint32_t configs, configs_count; /**< Item records offset and count */
+    uint32_t values, values_count; /**< Integer choices and string lists */
+    uint32_t strings, strings_size; /**< String table offset and size */
+} vlc_cache_header_t;
+
+typedef struct
+{
+    int64_t  mtime;
+    uint64_t size;
+    uint32_t modules, modules_count; /**< First module index and count */
+    uint32_t configs, configs_count; /**< First item index and count */
+    uint32_t textdomain;
+    uint32_t path;
+    uint32_t unloadable;
+} vlc_cache_plugin_t;
+
+typedef struct
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t shortcuts, shortcuts_count; /**< First value index and count */
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t capability;
+    int32_t  score;
+} vlc_cache_module_t;
+
+typedef union
+{
+    int64_t  i;
+    float    f;
+    uint32_t psz;
+} vlc_cache_value_t;
+
+typedef struct
+{
+    vlc_cache_value_t orig, min, max;
+    uint32_t type;
+    uint32_t name;
+    uint32_t text;
+    uint32_t longtext;
+    uint32_t list_cb_name;
+    uint32_t list; /**< First value index of the choices */
+    uint32_t list_text; /**< First value index of the choice descriptions */
+    uint16_t list_count;
+    uint8_t  i_type;
+    char     i_short;
+    uint8_t  flags;
+} vlc_cache_config_t;
+
+#define CACHE_CONFIG_ADVANCED   0x01
+#define CACHE_CONFIG_INTERNAL   0x02
+#define CACHE_CONFIG_UNSAVEABLE 0x04
+#define CACHE_CONFIG_SAFE       0x08
+#define CACHE_CONFIG_REMOVED    0x10
+
+/* Validated view of a mapped cache file */
+typedef struct
+{
+    const vlc_cache_plugin_t *plugins;
+    const vlc_cache_module_t *modules;
+    const vlc_cache_config_t *configs;
+    const uint32_t *values;
+    const char *strings;
+    vlc_cache_header_t hdr;
+} vlc_cache_map_t;
 
 static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
 {
@@ -76,202 +163,149 @@ static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
     return 0;
 }
 
-static int vlc_cache_load_bool(bool *out, block_t *in)
+/* Checks that a table lies within the file and is suitably aligned. */
+static const void *vlc_cache_load_table(const block_t *file, uint32_t offset,
+                                        uint32_t count, size_t size,
+                                        size_t align)
 {
-    unsigned char b;
-
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
-        return -1;
-
-    *out = b;
-    return 0;
+    if (offset > file->i_buffer
+     || (file->i_buffer - offset) / size < count
+     || ((uintptr_t)(file->p_buffer + offset) % align) != 0)
+        return NULL;
+    return file->p_buffer + offset;
 }
 
-static int vlc_cache_load_array(const void **p, size_t size, size_t n,
-                                block_t *file)
+/* Checks that count entries from index first lie within a table. */
+static bool vlc_cache_check_range(uint32_t first, uint32_t count,
+                                  uint32_t total)
 {
-    if (n == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    if (unlikely(size * n < size))
-        return -1;
-
-    size *= n;
-
-    if (file->i_buffer < size)
-        return -1;
-
-    *p = file->p_buffer;
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    return 0;
+    return first <= total && count <= total - first;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
+static int vlc_cache_load_string(const char **restrict p,
+                                 const vlc_cache_map_t *map, uint32_t ref)
 {
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
+    if (ref >= map->hdr.strings_size)
         return -1;
 
-    if (size == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    const char *str = (char *)file->p_buffer;
-
-    if (file->i_buffer < size || str[size - 1] != '\0')
-        return -1;
-
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
-    return 0;
-}
-
-static int vlc_cache_load_align(size_t align, block_t *file)
-{
-    assert(align > 0);
-
-    size_t skip = (-(uintptr_t)file->p_buffer) % align;
-    if (skip == 0)
-        return 0;
-
-    assert(skip < align);
-
-    if (file->i_buffer < skip)
-        return -1;
-
-    file->p_buffer += skip;
-    file->i_buffer -= skip;
-    assert((((uintptr_t)file->p_buffer) % align) == 0);
+    *p = (ref != 0) ? (map->strings + ref) : NULL;
     return 0;
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
-        goto error
-#define LOAD_FLAG(a) \
-    do \
-    { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-#define LOAD_ARRAY(a,n) \
-    do \
-    { \
-        const void *base; \
-        if (vlc_cache_load_array(&base, sizeof (*(a)), (n), file)) \
-            goto error; \
-        (a) = base; \
-    } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
-#define LOAD_ALIGNOF(t) \
-    if (vlc_cache_load_align(alignof(t), file)) \
+#define LOAD_STRING(a, ref) \
+    if (vlc_cache_load_string(&(a), map, (ref))) \
         goto error
 
-static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
-{
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_advanced);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
-
-    if (IsConfigStringType (cfg->i_type))
+static int vlc_cache_load_config(module_config_t *cfg,
+                                 const vlc_cache_map_t *map,
+                                 const vlc_cache_config_t *rec)
+{
+    cfg->i_type = rec->i_type;
+    cfg->i_short = rec->i_short;
+    cfg->b_advanced = (rec->flags & CACHE_CONFIG_ADVANCED) != 0;
+    cfg->b_internal = (rec->flags & CACHE_CONFIG_INTERNAL) != 0;
+    cfg->b_unsaveable = (rec->flags & CACHE_CONFIG_UNSAVEABLE) != 0;
+    cfg->b_safe = (rec->flags & CACHE_CONFIG_SAFE) != 0;
+    cfg->b_removed = (rec->flags & CACHE_CONFIG_REMOVED) != 0;
+    LOAD_STRING(cfg->psz_type, rec->type);
+    LOAD_STRING(cfg->psz_name, rec->name);
+    LOAD_STRING(cfg->psz_text, rec->text);
+    LOAD_STRING(cfg->psz_longtext, rec->longtext);
+
+    if (rec->list_count > 0
+     && (!vlc_cache_check_range(rec->list, rec->list_count,
+                                map->hdr.values_count)
+      || !vlc_cache_check_range(rec->list_text, rec->list_count,
+                                map->hdr.values_count)))
+        goto error;
+
+    if (IsConfigStringType(cfg->i_type))
     {
         const char *psz;
-        LOAD_STRING(psz);
+        LOAD_STRING(psz, rec->orig.psz);
         cfg->orig.psz = (char *)psz;
-        cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
+        cfg->value.psz = (psz != NULL) ? strdup(psz) : NULL;
 
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else
-            LOAD_STRING(cfg->list_cb_name);
-        for (unsigned i = 0; i < cfg->list_count; i++)
+        if (rec->list_count > 0)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
+            cfg->list.psz = xmalloc(rec->list_count * sizeof (char *));
+            cfg->list_count = rec->list_count;
+
+            for (unsigned i = 0; i < rec->list_count; i++)
+            {
+                LOAD_STRING(cfg->list.psz[i], map->values[rec->list + i]);
+                if (cfg->list.psz[i] == NULL) /* NULL -> empty string */
+                    cfg->list.psz[i] = (char *)"";
+            }
         }
+        else
+            LOAD_STRING(cfg->list_cb_name, rec->list_cb_name);
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
-        cfg->value = cfg->orig;
-
-        if (cfg->list_count)
+        if (IsConfigFloatType(cfg->i_type))
         {
-            LOAD_ALIGNOF(*cfg->list.i);
+            cfg->orig.f = rec->orig.f;
+            cfg->min.f = rec->min.f;
+            cfg->max.f = rec->max.f;
         }
         else
-            LOAD_STRING(cfg->list_cb_name);
+        {
+            cfg->orig.i = rec->orig.i;
+            cfg->min.i = rec->min.i;
+            cfg->max.i = rec->max.i;
+        }
+        cfg->value = cfg->orig;
 
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
+        if (rec->list_count > 0)
+        {   /* Integer choices are used in place */
+            static_assert(sizeof (*cfg->list.i) == sizeof (*map->values),
+                          "Integer choices size mismatch");
+            cfg->list.i = (const int *)(map->values + rec->list);
+            cfg->list_count = rec->list_count;
+        }
+        else
+            LOAD_STRING(cfg->list_cb_name, rec->list_cb_name);
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+    if (rec->list_count > 0)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
+        cfg->list_text = xmalloc(rec->list_count * sizeof (char *));
+        for (unsigned i = 0; i < rec->list_count; i++)
+        {
+            LOAD_STRING(cfg->list_text[i], map->values[rec->list_text + i]);
+            if (cfg->list_text[i] == NULL) /* NULL -> empty string */
+                cfg->list_text[i] = (char *)"";
+        }
     }
-
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin,
+                                        const vlc_cache_map_t *map,
+                                        const vlc_cache_plugin_t *rec)
 {
-    uint16_t lines;
-
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
+    if (!vlc_cache_check_range(rec->configs, rec->configs_count,
+                               map->hdr.configs_count)
+     || rec->configs_count > UINT16_MAX)
+        return -1;
 
-    /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.items = calloc(sizeof (module_config_t), lines);
-        if (unlikely(plugin->conf.items == NULL))
-        {
-            plugin->conf.size = 0;
-            return -1;
-        }
-    }
-    else
-        plugin->conf.items = NULL;
+    if (rec->configs_count == 0)
+        return 0;
 
-    plugin->conf.size = lines;
+    /* All items of the plugin at once */
+    plugin->conf.items = calloc(rec->configs_count, sizeof (module_config_t));
+    if (unlikely(plugin->conf.items == NULL))
+        return -1;
+    plugin->conf.size = rec->configs_count;
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
+    for (size_t i = 0; i < rec->configs_count; i++)
     {
         module_config_t *item = plugin->conf.items + i;
 
-        if (vlc_cache_load_config(item, file))
+        if (vlc_cache_load_config(item, map, map->configs + rec->configs + i))
             return -1;
 
         if (CONFIG_ITEM(item->i_type))
@@ -284,60 +318,66 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
     }
 
     return 0;
-error:
-    return -1; /* FIXME: leaks */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_module(vlc_plugin_t *plugin,
+                                 const vlc_cache_map_t *map,
+                                 const vlc_cache_module_t *rec)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
+    if (rec->shortcuts_count > MODULE_SHORTCUT_MAX
+     || !vlc_cache_check_range(rec->shortcuts, rec->shortcuts_count,
+                               map->hdr.values_count))
         goto error;
-    else
+
+    module->pp_shortcuts =
+        xmalloc(sizeof (*module->pp_shortcuts) * rec->shortcuts_count);
+    module->i_shortcuts = rec->shortcuts_count;
+    for (unsigned j = 0; j < rec->shortcuts_count; j++)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
+        LOAD_STRING(module->pp_shortcuts[j], map->values[rec->shortcuts + j]);
+        if (module->pp_shortcuts[j] == NULL)
+            goto error;
     }
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
+    LOAD_STRING(module->activate_name, rec->activate);
+    LOAD_STRING(module->deactivate_name, rec->deactivate);
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
     return 0;
 error:
     return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+static vlc_plugin_t *vlc_cache_load_plugin(const vlc_cache_map_t *map,
+                                           const vlc_cache_plugin_t *rec)
 {
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
+    if (!vlc_cache_check_range(rec->modules, rec->modules_count,
+                               map->hdr.modules_count))
+        goto error;
 
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    for (size_t i = 0; i < rec->modules_count; i++)
+        if (vlc_cache_load_module(plugin, map, map->modules + rec->modules + i))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
+    if (vlc_cache_load_plugin_config(plugin, map, rec))
         goto error;
 
-    LOAD_STRING(plugin->textdomain);
+    LOAD_STRING(plugin->textdomain, rec->textdomain);
 
     const char *path;
-    LOAD_STRING(path);
+    LOAD_STRING(path, rec->path);
     if (path == NULL)
         goto error;
 
@@ -345,9 +385,11 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    if (rec->unloadable > 1)
+        goto error;
+    plugin->unloadable = rec->unloadable;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -359,6 +401,46 @@ error:
     return NULL;
 }
 
+/* Locates and checks the tables of the cache file. */
+static int vlc_cache_load_map(vlc_cache_map_t *map, const block_t *file,
+                              uint32_t offset)
+{
+    const vlc_cache_header_t *hdr =
+        vlc_cache_load_table(file, offset, 1, sizeof (*hdr), alignof (*hdr));
+
+    if (hdr == NULL
+     || hdr->size != sizeof (*hdr)
+     || hdr->plugin_size != sizeof (vlc_cache_plugin_t)
+     || hdr->module_size != sizeof (vlc_cache_module_t)
+     || hdr->config_size != sizeof (vlc_cache_config_t))
+        return -1;
+
+    map->hdr = *hdr;
+    map->plugins = vlc_cache_load_table(file, hdr->plugins, hdr->plugins_count,
+                                        sizeof (vlc_cache_plugin_t),
+                                        alignof (vlc_cache_plugin_t));
+    map->modules = vlc_cache_load_table(file, hdr->modules, hdr->modules_count,
+                                        sizeof (vlc_cache_module_t),
+                                        alignof (vlc_cache_module_t));
+    map->configs = vlc_cache_load_table(file, hdr->configs, hdr->configs_count,
+                                        sizeof (vlc_cache_config_t),
+                                        alignof (vlc_cache_config_t));
+    map->values = vlc_cache_load_table(file, hdr->values, hdr->values_count,
+                                       sizeof (uint32_t), alignof (uint32_t));
+    map->strings = vlc_cache_load_table(file, hdr->strings, hdr->strings_size,
+                                        1, 1);
+
+    if (map->plugins == NULL || map->modules == NULL || map->configs == NULL
+     || map->values == NULL || map->strings == NULL)
+        return -1;
+
+    /* Every string reference is then known to be nul-terminated */
+    if (hdr->strings_size == 0 || map->strings[0] != '\0'
+     || map->strings[hdr->strings_size - 1] != '\0')
+        return -1;
+    return 0;
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -389,8 +471,9 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
 
     /* Check the file is a plugins cache */
     char cachestr[sizeof (CACHE_STRING) - 1];
+    block_t view = *file;
 
-    if (vlc_cache_load_immediate(cachestr, file, sizeof (cachestr))
+    if (vlc_cache_load_immediate(cachestr, &view, sizeof (cachestr))
      || memcmp(cachestr, CACHE_STRING, sizeof (cachestr)))
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
@@ -402,7 +485,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     /* Check for distribution specific version */
     char distrostr[sizeof (DISTRO_VERSION) - 1];
 
-    if (vlc_cache_load_immediate(distrostr, file, sizeof (distrostr))
+    if (vlc_cache_load_immediate(distrostr, &view, sizeof (distrostr))
      || memcmp(distrostr, DISTRO_VERSION, sizeof (distrostr)))
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
@@ -414,7 +497,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     /* Check sub-version number */
     uint32_t marker;
 
-    if (vlc_cache_load_immediate(&marker, file, sizeof (marker))
+    if (vlc_cache_load_immediate(&marker, &view, sizeof (marker))
      || marker != CACHE_SUBVERSION_NUM)
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
@@ -424,7 +507,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     }
 
     /* Check header marker */
-    if (vlc_cache_load_immediate(&marker, file, sizeof (marker))
+    if (vlc_cache_load_immediate(&marker, &view, sizeof (marker))
 #ifdef DISTRO_VERSION
      || marker != (sizeof (cachestr) + sizeof (distrostr) + sizeof (marker))
 #else
@@ -438,11 +521,16 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return 0;
     }
 
+    vlc_cache_map_t map;
     vlc_plugin_t *cache = NULL;
+    uint32_t offset = (marker + sizeof (marker) + 7) & ~7;
+
+    if (vlc_cache_load_map(&map, file, offset))
+        goto error;
 
-    while (file->i_buffer > 0)
+    for (size_t i = 0; i < map.hdr.plugins_count; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(&map, map.plugins + i);
         if (plugin == NULL)
             goto error;
 
@@ -458,6 +546,11 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         cache = plugin;
     }
 
+    msg_Dbg(p_this, "mapped %"PRIu32" plugins, %"PRIu32" modules and "
+            "%"PRIu32" items from the cache", map.hdr.plugins_count,
+            map.hdr.modules_count, map.hdr.configs_count);
+
+    /* The plugins refer to the strings of the mapped file */
     file->p_next = *backingp;
     *backingp = file;
     return cache;
@@ -465,138 +558,376 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
+    while (cache != NULL)
+    {
+        vlc_plugin_t *next = cache->next;
+
+        vlc_plugin_destroy(cache);
+        cache = next;
+    }
     block_Release(file);
     return NULL;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
+/*
+ * String table under construction, with de-duplication.
+ */
+typedef struct
+{
+    char     *data;
+    size_t    size;
+    size_t    alloc;
+    uint32_t *hash; /**< Open addressing table of offsets, 0 if empty */
+    size_t    hash_size;
+    size_t    hash_count;
+} vlc_cache_strtab_t;
+
+static int CacheStringInit(vlc_cache_strtab_t *tab)
+{
+    memset(tab, 0, sizeof (*tab));
+    tab->data = malloc(4096);
+    if (unlikely(tab->data == NULL))
+        return -1;
 
-static int CacheSaveString (FILE *file, const char *str)
+    /* Offset 0 is the NULL string */
+    tab->data[0] = '\0';
+    tab->size = 1;
+    tab->alloc = 4096;
+    return 0;
+}
+
+static uint32_t CacheStringHash(const char *str)
 {
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
+    uint32_t h = 2166136261u; /* FNV-1a */
 
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
-    {
-error:
+    while (*str)
+        h = (h ^ (unsigned char)*(str++)) * 16777619u;
+    return h;
+}
+
+static int CacheStringGrowHash(vlc_cache_strtab_t *tab)
+{
+    size_t size = tab->hash_size ? (tab->hash_size * 2) : 1024;
+    uint32_t *hash = calloc(size, sizeof (*hash));
+    if (unlikely(hash == NULL))
         return -1;
+
+    for (size_t i = 0; i < tab->hash_size; i++)
+    {
+        uint32_t ref = tab->hash[i];
+        if (ref == 0)
+            continue;
+
+        size_t slot = CacheStringHash(tab->data + ref) & (size - 1);
+        while (hash[slot] != 0)
+            slot = (slot + 1) & (size - 1);
+        hash[slot] = ref;
     }
+
+    free(tab->hash);
+    tab->hash = hash;
+    tab->hash_size = size;
     return 0;
 }
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
-
-static int CacheSaveAlign(FILE *file, size_t align)
+/**
+ * Adds a string to the table, if not already present.
+ * \return the string offset in the table (0 for NULL), or -1 on error
+ */
+static int64_t CacheSaveString(vlc_cache_strtab_t *tab, const char *str)
 {
-    assert(align > 0);
-
-    size_t skip = (-ftell(file)) % align;
-    if (skip == 0)
+    if (str == NULL)
         return 0;
 
-    assert(((ftell(file) + skip) % align) == 0);
-    return fseek(file, skip, SEEK_CUR);
+    if (tab->hash_count * 2 >= tab->hash_size && CacheStringGrowHash(tab))
+        return -1;
+
+    size_t slot = CacheStringHash(str) & (tab->hash_size - 1);
+    uint32_t ref;
+
+    while ((ref = tab->hash[slot]) != 0)
+    {
+        if (!strcmp(tab->data + ref, str))
+            return ref;
+        slot = (slot + 1) & (tab->hash_size - 1);
+    }
+
+    size_t len = strlen(str) + 1;
+    if (tab->size + len > UINT32_MAX)
+        return -1;
+
+    if (tab->size + len > tab->alloc)
+    {
+        size_t alloc = (tab->alloc + len) * 2;
+        char *data = realloc(tab->data, alloc);
+        if (unlikely(data == NULL))
+            return -1;
+        tab->data = data;
+        tab->alloc = alloc;
+    }
+
+    ref = tab->size;
+    memcpy(tab->data + ref, str, len);
+    tab->size += len;
+    tab->hash[slot] = ref;
+    tab->hash_count++;
+    return ref;
 }
 
-#define SAVE_ALIGNOF(t) \
-    if (CacheSaveAlign(file, alignof (t))) \
-        goto error
+#define SAVE_STRING(ref, a) \
+    do { \
+        int64_t r_ = CacheSaveString(strtab, (a)); \
+        if (r_ < 0) \
+            goto error; \
+        (ref) = r_; \
+    } while (0)
+
+/* Growable array of records */
+#define CACHE_APPEND(array, count, alloc) \
+    do { \
+        if ((count) >= (alloc)) \
+        { \
+            size_t n_ = (alloc) ? ((alloc) * 2) : 256; \
+            void *p_ = realloc((array), n_ * sizeof (*(array))); \
+            if (unlikely(p_ == NULL)) \
+                goto error; \
+            (array) = p_; \
+            (alloc) = n_; \
+        } \
+        memset((array) + (count), 0, sizeof (*(array))); \
+        (count)++; \
+    } while (0)
+
+typedef struct
+{
+    vlc_cache_strtab_t strings;
+    vlc_cache_module_t *modules;
+    size_t modules_count, modules_alloc;
+    vlc_cache_config_t *configs;
+    size_t configs_count, configs_alloc;
+    uint32_t *values;
+    size_t values_count, values_alloc;
+} vlc_cache_image_t;
+
+/**
+ * Interns the strings needed to register plugins and resolve configuration,
+ * so that they are packed together at the beginning of the string table.
+ */
+static int CacheSaveHotStrings(vlc_cache_strtab_t *strtab,
+                               const vlc_plugin_t *plugin)
+{
+    uint32_t ref;
+
+    for (const module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+    {
+        SAVE_STRING(ref, module->psz_shortname);
+        for (size_t j = 0; j < module->i_shortcuts; j++)
+            SAVE_STRING(ref, module->pp_shortcuts[j]);
+        SAVE_STRING(ref, module->activate_name);
+        SAVE_STRING(ref, module->deactivate_name);
+        SAVE_STRING(ref, module->psz_capability);
+    }
 
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
-{
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_advanced);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
-
-    if (IsConfigStringType (cfg->i_type))
+    for (size_t i = 0; i < plugin->conf.size; i++)
     {
-        SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_STRING(cfg->list_cb_name);
+        const module_config_t *cfg = plugin->conf.items + i;
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+        SAVE_STRING(ref, cfg->psz_type);
+        SAVE_STRING(ref, cfg->psz_name);
+        SAVE_STRING(ref, cfg->list_cb_name);
+        if (IsConfigStringType(cfg->i_type))
+            SAVE_STRING(ref, cfg->orig.psz);
+    }
+
+    SAVE_STRING(ref, plugin->textdomain);
+    SAVE_STRING(ref, plugin->path);
+    (void) ref;
+    return 0;
+error:
+    return -1;
+}
+
+static int CacheSaveConfig(vlc_cache_image_t *img, const module_config_t *cfg)
+{
+    vlc_cache_strtab_t *strtab = &img->strings;
+    vlc_cache_config_t *rec;
+
+    CACHE_APPEND(img->configs, img->configs_count, img->configs_alloc);
+    rec = img->configs + img->configs_count - 1;
+
+    rec->i_type = cfg->i_type;
+    rec->i_short = cfg->i_short;
+    rec->flags = (cfg->b_advanced ? CACHE_CONFIG_ADVANCED : 0)
+               | (cfg->b_internal ? CACHE_CONFIG_INTERNAL : 0)
+               | (cfg->b_unsaveable ? CACHE_CONFIG_UNSAVEABLE : 0)
+               | (cfg->b_safe ? CACHE_CONFIG_SAFE : 0)
+               | (cfg->b_removed ? CACHE_CONFIG_REMOVED : 0);
+    SAVE_STRING(rec->type, cfg->psz_type);
+    SAVE_STRING(rec->name, cfg->psz_name);
+    SAVE_STRING(rec->text, cfg->psz_text);
+    SAVE_STRING(rec->longtext, cfg->psz_longtext);
+    rec->list_count = cfg->list_count;
+
+    if (IsConfigStringType(cfg->i_type))
+        SAVE_STRING(rec->orig.psz, cfg->orig.psz);
+    else if (IsConfigFloatType(cfg->i_type))
+    {
+        rec->orig.f = cfg->orig.f;
+        rec->min.f = cfg->min.f;
+        rec->max.f = cfg->max.f;
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
+        rec->orig.i = cfg->orig.i;
+        rec->min.i = cfg->min.i;
+        rec->max.i = cfg->max.i;
+    }
 
-        if (cfg->list_count > 0)
-        {
-            SAVE_ALIGNOF(*cfg->list.i);
-        }
+    if (cfg->list_count == 0)
+    {
+        SAVE_STRING(rec->list_cb_name, cfg->list_cb_name);
+        return 0;
+    }
+
+    /* Choices, then their descriptions */
+    size_t list = img->values_count;
+    for (unsigned i = 0; i < cfg->list_count; i++)
+    {
+        uint32_t value;
+
+        if (IsConfigStringType(cfg->i_type))
+            SAVE_STRING(value, (cfg->list.psz[i] != NULL)
+                               ? cfg->list.psz[i] : "");
         else
-            SAVE_STRING(cfg->list_cb_name);
+            memcpy(&value, cfg->list.i + i, sizeof (value));
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+        CACHE_APPEND(img->values, img->values_count, img->values_alloc);
+        img->values[img->values_count - 1] = value;
     }
+
+    size_t list_text = img->values_count;
     for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+    {
+        uint32_t value;
 
+        SAVE_STRING(value, (cfg->list_text[i] != NULL)
+                           ? cfg->list_text[i] : "");
+        CACHE_APPEND(img->values, img->values_count, img->values_alloc);
+        img->values[img->values_count - 1] = value;
+    }
+
+    /* The record may have moved */
+    rec = img->configs + img->configs_count - 1;
+    rec->list = list;
+    rec->list_text = list_text;
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+static int CacheSaveModule(vlc_cache_image_t *img, const module_t *module)
 {
-    uint16_t lines = plugin->conf.size;
+    vlc_cache_strtab_t *strtab = &img->strings;
+    vlc_cache_module_t rec;
+    memset(&rec, 0, sizeof (rec));
+
+    SAVE_STRING(rec.shortname, module->psz_shortname);
+    SAVE_STRING(rec.longname, module->psz_longname);
+    SAVE_STRING(rec.help, module->psz_help);
 
-    SAVE_IMMEDIATE (lines);
+    rec.shortcuts = img->values_count;
+    rec.shortcuts_count = module->i_shortcuts;
+    for (size_t j = 0; j < module->i_shortcuts; j++)
+    {
+        uint32_t value;
+
+        SAVE_STRING(value, module->pp_shortcuts[j]);
+        CACHE_APPEND(img->values, img->values_count, img->values_alloc);
+        img->values[img->values_count - 1] = value;
+    }
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.items + i))
-           goto error;
+    SAVE_STRING(rec.activate, module->activate_name);
+    SAVE_STRING(rec.deactivate, module->deactivate_name);
+    SAVE_STRING(rec.capability, module->psz_capability);
+    rec.score = module->i_score;
 
+    CACHE_APPEND(img->modules, img->modules_count, img->modules_alloc);
+    img->modules[img->modules_count - 1] = rec;
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+static int CacheSavePlugin(vlc_cache_image_t *img, vlc_cache_plugin_t *rec,
+                           const vlc_plugin_t *plugin)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    vlc_cache_strtab_t *strtab = &img->strings;
+
+    memset(rec, 0, sizeof (*rec));
+    rec->modules = img->modules_count;
+    for (const module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+        if (CacheSaveModule(img, module))
+            goto error;
+    rec->modules_count = img->modules_count - rec->modules;
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    rec->configs = img->configs_count;
+    for (size_t i = 0; i < plugin->conf.size; i++)
+        if (CacheSaveConfig(img, plugin->conf.items + i))
+            goto error;
+    rec->configs_count = plugin->conf.size;
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
+    SAVE_STRING(rec->textdomain, plugin->textdomain);
+    SAVE_STRING(rec->path, plugin->path);
+    rec->unloadable = plugin->unloadable;
+    rec->mtime = plugin->mtime;
+    rec->size = plugin->size;
     return 0;
 error:
     return -1;
 }
 
+/* Pads the file with zeroes up to the given offset. */
+static int CacheSavePad(FILE *file, long offset)
+{
+    long pos = ftell(file);
+
+    if (pos < 0 || pos > offset)
+        return -1;
+
+    while (pos++ < offset)
+        if (putc(0, file) == EOF)
+            return -1;
+    return 0;
+}
+
+static int CacheSaveTable(FILE *file, uint32_t offset, const void *data,
+                          size_t size, size_t count)
+{
+    if (CacheSavePad(file, offset))
+        return -1;
+    if (count > 0 && fwrite(data, size, count, file) != count)
+        return -1;
+    return 0;
+}
+
+static size_t CacheAlign(size_t offset)
+{
+    return (offset + 7) & ~(size_t)7;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    vlc_cache_image_t img;
+    vlc_cache_strtab_t *strtab = &img.strings;
+    vlc_cache_plugin_t *plugins = NULL;
     uint32_t i_file_size = 0;
+    int ret = -1;
+
+    memset(&img, 0, sizeof (img));
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -617,37 +948,74 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
+    if (CacheStringInit(strtab))
+        goto error;
 
-        SAVE_IMMEDIATE(count);
+    for (size_t i = 0; i < n; i++)
+        if (CacheSaveHotStrings(strtab, cache[i]))
+            goto error;
 
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
+    if (n > 0)
+    {
+        plugins = malloc(n * sizeof (*plugins));
+        if (unlikely(plugins == NULL))
+            goto error;
+    }
 
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
+    for (size_t i = 0; i < n; i++)
+        if (CacheSavePlugin(&img, plugins + i, cache[i]))
             goto error;
 
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
+    vlc_cache_header_t hdr;
+    size_t offset = CacheAlign(i_file_size + sizeof (i_file_size));
+
+    memset(&hdr, 0, sizeof (hdr));
+    hdr.size = sizeof (hdr);
+    hdr.plugin_size = sizeof (vlc_cache_plugin_t);
+    hdr.module_size = sizeof (vlc_cache_module_t);
+    hdr.config_size = sizeof (vlc_cache_config_t);
+    offset = CacheAlign(offset + sizeof (hdr));
+    hdr.plugins = offset;
+    hdr.plugins_count = n;
+    offset = CacheAlign(offset + n * sizeof (*plugins));
+    hdr.modules = offset;
+    hdr.modules_count = img.modules_count;
+    offset = CacheAlign(offset + img.modules_count * sizeof (*img.modules));
+    hdr.configs = offset;
+    hdr.configs_count = img.configs_count;
+    offset = CacheAlign(offset + img.configs_count * sizeof (*img.configs));
+    hdr.values = offset;
+    hdr.values_count = img.values_count;
+    offset = CacheAlign(offset + img.values_count * sizeof (*img.values));
+    hdr.strings = offset;
+    hdr.strings_size = strtab->size;
+    if (offset + strtab->size > UINT32_MAX)
+        goto error;
+
+    if (CacheSaveTable(file, CacheAlign(i_file_size + sizeof (i_file_size)),
+                       &hdr, sizeof (hdr), 1)
+     || CacheSaveTable(file, hdr.plugins, plugins, sizeof (*plugins), n)
+     || CacheSaveTable(file, hdr.modules, img.modules, sizeof (*img.modules),
+                       img.modules_count)
+     || CacheSaveTable(file, hdr.configs, img.configs, sizeof (*img.configs),
+                       img.configs_count)
+     || CacheSaveTable(file, hdr.values, img.values, sizeof (*img.values),
+                       img.values_count)
+     || CacheSaveTable(file, hdr.strings, strtab->data, 1, strtab->size))
+        goto error;
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    free(plugins);
+    free(img.modules);
+    free(img.configs);
+    free(img.values);
+    free(strtab->data);
+    free(strtab->hash);
+    return ret;
 }
 
 /**
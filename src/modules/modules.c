@@ -155,18 +155,6 @@ void module_stop (vlc_object_t *obj, const module_t *m)
         deactivate (obj);
 }
 
-static bool module_match_name (const module_t *m, const char *name)
-{
-     /* Plugins with zero score must be matched explicitly. */
-     if (!strcasecmp ("any", name))
-         return m->i_score > 0;
-
-     for (unsigned i = 0; i < m->i_shortcuts; i++)
-          if (!strcasecmp (m->pp_shortcuts[i], name))
-              return true;
-     return false;
-}
-
 static int module_load (vlc_object_t *obj, module_t *m,
                         vlc_activate_t init, va_list args)
 {
@@ -266,15 +254,24 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
         if (!strcasecmp ("none", shortcut))
             goto done;
 
-        obj->obj.force = strict && strcasecmp ("any", shortcut);
-        for (ssize_t i = 0; i < total; i++)
+        const bool any = !strcasecmp ("any", shortcut);
+        const vlc_modname_t *matches = NULL;
+        size_t count = total;
+
+        if (!any) /* use the name index rather than compare every module */
+            count = module_list_cap_find (capability, shortcut, &matches);
+
+        obj->obj.force = strict && !any;
+        for (size_t i = 0; i < count; i++)
         {
-            module_t *cand = mods[i];
+            size_t rank = any ? i : matches[i].rank;
+            module_t *cand = mods[rank];
             if (cand == NULL)
                 continue; // module failed in previous iteration
-            if (!module_match_name (cand, shortcut))
+            /* Plugins with zero score must be matched explicitly. */
+            if (any && cand->i_score <= 0)
                 continue;
-            mods[i] = NULL; // only try each module once at most...
+            mods[rank] = NULL; // only try each module once at most...
 
             int ret = module_load (obj, cand, probe, args);
             switch (ret)
@@ -386,25 +383,9 @@ void module_unneed(vlc_object_t *obj, module_t *module)
  */
 module_t *module_find (const char *name)
 {
-    size_t count;
-    module_t **list = module_list_get (&count);
-
     assert (name != NULL);
 
-    for (size_t i = 0; i < count; i++)
-    {
-        module_t *module = list[i];
-
-        if (unlikely(module->i_shortcuts == 0))
-            continue;
-        if (!strcmp (module->pp_shortcuts[0], name))
-        {
-            module_list_free (list);
-            return module;
-        }
-    }
-    module_list_free (list);
-    return NULL;
+    return module_list_find (name);
 }
 
 /**
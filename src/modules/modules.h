@@ -119,6 +119,18 @@ int module_Map(vlc_object_t *, vlc_plugin_t *);
 
 ssize_t module_list_cap (module_t ***, const char *);
 
+/** Module name index entry */
+typedef struct vlc_modname
+{
+    const char *name; /**< Shortcut */
+    module_t *module;
+    size_t rank; /**< Position in the capability list (by decreasing score) */
+} vlc_modname_t;
+
+size_t module_list_cap_find(const char *cap, const char *name,
+                            const vlc_modname_t **);
+module_t *module_list_find(const char *name);
+
 int vlc_bindtextdomain (const char *);
 
 /* Low-level OS-dependent handler */
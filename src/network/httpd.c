@@ -37,6 +37,7 @@
 #include <vlc_strings.h>
 #include <vlc_rand.h>
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
@@ -52,6 +53,11 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# define HTTPD_EPOLL 1
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -68,6 +74,7 @@
 
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_HostWake(httpd_host_t *host);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -98,6 +105,25 @@ struct httpd_host_t
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
+
+#ifdef HTTPD_EPOLL
+    /* listening and client sockets are registered once, edge-triggered */
+    int         epfd;
+    int         wakefd;
+    atomic_bool wake;
+    /* Clients were destroyed outside of the host thread, while it was
+     * waiting. The pending events may then point to freed clients, so the
+     * host thread drops them and marks every remaining client ready instead.
+     * This is safe with edge-triggered sockets: a client that is not
+     * actually ready gets EAGAIN on its first read or write, which clears
+     * its ready flag until the next event. */
+    bool        b_stale;
+#endif
+
+    /* statistics (protected by lock) */
+    uint64_t    i_connections;
+    uint64_t    i_bytes_received;
+    uint64_t    i_bytes_sent;
 };
 
 
@@ -144,6 +170,7 @@ enum
 
 struct httpd_client_t
 {
+    httpd_host_t *host;
     httpd_url_t *url;
     vlc_tls_t   *sock;
 
@@ -151,6 +178,10 @@ struct httpd_client_t
 
     bool    b_stream_mode;
     uint8_t i_state;
+    uint8_t i_ready; /* POLLIN/POLLOUT until the socket would block */
+
+    /* stream being sent straight from its circular buffer, if any */
+    httpd_stream_t *stream;
 
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
@@ -624,6 +655,30 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+/* Returns how many bytes are available to the client at *pi_offset,
+ * moving the offset forward if needed. Must be called with the stream lock. */
+static int64_t httpd_StreamPending(httpd_stream_t *stream, httpd_client_t *cl,
+                                   int64_t *pi_offset)
+{
+    if (*pi_offset >= stream->i_buffer_pos)
+        return 0;    /* wait, no data available */
+
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            return 0;
+
+        /* seek to the new keyframe */
+        *pi_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
+
+    if (*pi_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        *pi_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+
+    return stream->i_buffer_pos - *pi_offset;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -636,31 +691,18 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
     if (answer->i_body_offset > 0) {
         int     i_pos;
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
-
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
-
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        vlc_mutex_lock(&stream->lock);
+        int64_t i_write = httpd_StreamPending(stream, cl, &answer->i_body_offset);
 
         if (i_write > HTTPD_CL_BUFSIZE)
             i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
+        else if (i_write <= 0) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         /* Don't go past the end of the circular buffer */
+        i_pos   = answer->i_body_offset % stream->i_buffer_size;
         i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
 
         /* using HTTPD_MSG_ANSWER -> data available */
@@ -671,6 +713,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         answer->i_body = i_write;
         answer->p_body = xmalloc(i_write);
         memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        vlc_mutex_unlock(&stream->lock);
 
         answer->i_body_offset += i_write;
 
@@ -700,6 +743,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
 
         if (query->i_type != HTTPD_MSG_HEAD) {
             cl->b_stream_mode = true;
+            cl->stream = stream;
             vlc_mutex_lock(&stream->lock);
             /* Send the header */
             if (stream->i_header > 0) {
@@ -843,6 +887,9 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
     vlc_mutex_unlock(&stream->lock);
+
+    /* wake up the clients waiting for data */
+    httpd_HostWake(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -903,6 +950,69 @@ httpd_host_t *vlc_rtsp_HostNew(vlc_object_t *p_this)
     return httpd_HostCreate(p_this, "rtsp-host", "rtsp-port", NULL);
 }
 
+#ifdef HTTPD_EPOLL
+static int httpd_HostPollNew(httpd_host_t *host)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1)
+        return -1;
+
+    host->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (host->wakefd == -1)
+        goto error;
+
+    /* listening sockets and the wake-up event are level-triggered */
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &host->wakefd };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, host->wakefd, &ev))
+        goto error;
+
+    for (unsigned i = 0; i < host->nfd; i++) {
+        ev.data.ptr = &host->fds[i];
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
+    }
+    return epfd;
+
+error:
+    if (host->wakefd != -1)
+        vlc_close(host->wakefd);
+    host->wakefd = -1;
+    vlc_close(epfd);
+    return -1;
+}
+
+static void httpd_HostPollDelete(httpd_host_t *host)
+{
+    if (host->epfd == -1)
+        return;
+    vlc_close(host->wakefd);
+    vlc_close(host->epfd);
+}
+#endif
+
+static void httpd_HostWake(httpd_host_t *host)
+{
+#ifdef HTTPD_EPOLL
+    if (host->epfd != -1 && !atomic_exchange(&host->wake, true)) {
+        uint64_t val = 1;
+        if (write(host->wakefd, &val, sizeof (val)) != sizeof (val))
+            atomic_store(&host->wake, false);
+    }
+#else
+    VLC_UNUSED(host);
+#endif
+}
+
+void httpd_HostGetStats(httpd_host_t *host, httpd_host_stats_t *stats)
+{
+    vlc_mutex_lock(&host->lock);
+    stats->i_connections = host->i_connections;
+    stats->i_clients = host->i_client;
+    stats->i_bytes_received = host->i_bytes_received;
+    stats->i_bytes_sent = host->i_bytes_sent;
+    vlc_mutex_unlock(&host->lock);
+}
+
 static struct httpd
 {
     vlc_mutex_t  mutex;
@@ -978,6 +1088,19 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->i_client = 0;
     host->client   = NULL;
     host->p_tls    = p_tls;
+    host->i_connections = 0;
+    host->i_bytes_received = 0;
+    host->i_bytes_sent = 0;
+
+#ifdef HTTPD_EPOLL
+    host->wakefd = -1;
+    atomic_init(&host->wake, false);
+    host->b_stale = false;
+    host->epfd = httpd_HostPollNew(host);
+    if (host->epfd == -1)
+        msg_Warn(p_this, "cannot create event poll: %s",
+                 vlc_strerror_c(errno));
+#endif
 
     /* create the thread */
     if (vlc_clone(&host->thread, httpd_HostThread, host,
@@ -998,6 +1121,9 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+#ifdef HTTPD_EPOLL
+        httpd_HostPollDelete(host);
+#endif
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1043,6 +1169,13 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_CLEAN(host->i_client, host->client);
 
+    msg_Dbg(host, "%"PRIu64" connection(s), %"PRIu64" bytes received, "
+            "%"PRIu64" bytes sent", host->i_connections,
+            host->i_bytes_received, host->i_bytes_sent);
+
+#ifdef HTTPD_EPOLL
+    httpd_HostPollDelete(host);
+#endif
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1122,6 +1255,10 @@ void httpd_UrlDelete(httpd_url_t *url)
         TAB_REMOVE(host->i_client, host->client, client);
         httpd_ClientDestroy(client);
         i--;
+#ifdef HTTPD_EPOLL
+        /* see httpd_host_t: the next host loop iteration rescans all clients */
+        host->b_stale = true;
+#endif
     }
     free(url);
     vlc_mutex_unlock(&host->lock);
@@ -1206,6 +1343,7 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->stream = NULL;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1231,15 +1369,18 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     free(cl);
 }
 
-static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock, mtime_t now)
+static httpd_client_t *httpd_ClientNew(httpd_host_t *host, vlc_tls_t *sock,
+                                       mtime_t now)
 {
     httpd_client_t *cl = malloc(sizeof(httpd_client_t));
 
     if (!cl) return NULL;
 
+    cl->host    = host;
     cl->i_ref   = 0;
     cl->sock    = sock;
     cl->url     = NULL;
+    cl->i_ready = POLLIN | POLLOUT;
 
     httpd_ClientInit(cl, now);
     return cl;
@@ -1250,15 +1391,33 @@ ssize_t httpd_NetRecv (httpd_client_t *cl, uint8_t *p, size_t i_len)
 {
     vlc_tls_t *sock = cl->sock;
     struct iovec iov = { .iov_base = p, .iov_len = i_len };
-    return sock->readv(sock, &iov, 1);
+    ssize_t val = sock->readv(sock, &iov, 1);
+
+    if (val > 0)
+        cl->host->i_bytes_received += val;
+    else if (val < 0 && errno == EAGAIN)
+        cl->i_ready &= ~POLLIN;
+    return val;
 }
 
 static
-ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
+ssize_t httpd_NetSendv (httpd_client_t *cl, struct iovec *iov, unsigned count)
 {
     vlc_tls_t *sock = cl->sock;
-    const struct iovec iov = { .iov_base = (void *)p, .iov_len = i_len };
-    return sock->writev(sock, &iov, 1);
+    ssize_t val = sock->writev(sock, iov, count);
+
+    if (val > 0)
+        cl->host->i_bytes_sent += val;
+    else if (val < 0 && errno == EAGAIN)
+        cl->i_ready &= ~POLLOUT;
+    return val;
+}
+
+static
+ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
+{
+    struct iovec iov = { .iov_base = (void *)p, .iov_len = i_len };
+    return httpd_NetSendv(cl, &iov, 1);
 }
 
 
@@ -1606,7 +1765,8 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer += i_len;
 
         if (cl->i_buffer >= cl->i_buffer_size) {
-            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0
+             && cl->stream == NULL) {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
                 int64_t i_offset = cl->answer.i_body_offset;
@@ -1643,14 +1803,57 @@ static void httpd_ClientSend(httpd_client_t *cl)
     }
 }
 
+/* Sends the pending stream data straight from the circular buffer */
+static void httpd_ClientStreamSend(httpd_client_t *cl, mtime_t now)
+{
+    httpd_stream_t *stream = cl->stream;
+    int64_t *pi_offset = &cl->answer.i_body_offset;
+    ssize_t i_len = -1;
+    bool b_dead = false;
+
+    vlc_mutex_lock(&stream->lock);
+    int64_t i_write = httpd_StreamPending(stream, cl, pi_offset);
+    if (i_write > 0) {
+        cl->i_activity_date = now;
+
+        size_t i_avail = i_write;
+        size_t i_pos = *pi_offset % stream->i_buffer_size;
+        size_t i_first = __MIN(i_avail, stream->i_buffer_size - i_pos);
+        struct iovec iov[2] = {
+            { .iov_base = stream->p_buffer + i_pos, .iov_len = i_first },
+            { .iov_base = stream->p_buffer, .iov_len = i_avail - i_first },
+        };
+
+        i_len = httpd_NetSendv(cl, iov, (i_avail > i_first) ? 2 : 1);
+        if (i_len > 0)
+            *pi_offset += i_len;
+#if defined(_WIN32)
+        else if (i_len == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+#else
+        else if (i_len == 0 || errno != EAGAIN)
+#endif
+            b_dead = true;
+    }
+    vlc_mutex_unlock(&stream->lock);
+
+    if (b_dead)
+        cl->i_state = HTTPD_CLIENT_DEAD;
+}
+
 static void httpd_ClientTlsHandshake(httpd_host_t *host, httpd_client_t *cl)
 {
     switch (vlc_tls_SessionHandshake(host->p_tls, cl->sock))
     {
         case -1: cl->i_state = HTTPD_CLIENT_DEAD;       break;
         case 0:  cl->i_state = HTTPD_CLIENT_RECEIVING;  break;
-        case 1:  cl->i_state = HTTPD_CLIENT_TLS_HS_IN;  break;
-        case 2:  cl->i_state = HTTPD_CLIENT_TLS_HS_OUT; break;
+        case 1:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_IN;
+            cl->i_ready &= ~POLLIN;
+            break;
+        case 2:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+            cl->i_ready &= ~POLLOUT;
+            break;
     }
 }
 
@@ -1694,264 +1897,365 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Handles the client state transitions, and returns the events to wait for */
+static short httpd_ClientProcess(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
-
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
-    }
-
-    mtime_t now = mdate();
-    bool b_low_delay = false;
-
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
-            i_client--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+    int64_t i_offset;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        pufd->fd = vlc_tls_GetFD(cl->sock);
-        pufd->events = pufd->revents = 0;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                default: {
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    /* Search the url and trigger callbacks */
+                    for (int i = 0; i < host->i_url; i++) {
+                        httpd_url_t *url = host->url[i];
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                            httpd_MsgAdd(answer, "Connection", "close");
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
+
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
                             httpd_MsgAdd(answer, "Connection", "close");
+                    }
 
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+            }
+            break;
+        }
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                bool do_close = false;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                                httpd_MsgAdd(answer, "Connection", "close");
-                        }
+                cl->url = NULL;
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
+                if (cl->query.i_proto != HTTPD_PROTO_HTTP
+                 || cl->query.i_version > 0)
+                {
+                    const char *psz_connection = httpd_MsgGet(&cl->answer,
+                                                             "Connection");
+                    if (psz_connection != NULL)
+                        do_close = !strcasecmp(psz_connection, "close");
                 }
-                break;
+                else
+                    do_close = true;
+
+                if (!do_close) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
+
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    cl->p_buffer = xmalloc(cl->i_buffer_size);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
+                i_offset = cl->answer.i_body_offset;
+                httpd_MsgClean(&cl->answer);
+
+                cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
+
+                cl->i_state = HTTPD_CLIENT_WAITING;
             }
+            break;
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    bool do_close = false;
+        case HTTPD_CLIENT_WAITING:
+            if (cl->stream != NULL)
+                break; /* sent straight from the stream buffer */
 
-                    cl->url = NULL;
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
 
-                    if (cl->query.i_proto != HTTPD_PROTO_HTTP
-                     || cl->query.i_version > 0)
-                    {
-                        const char *psz_connection = httpd_MsgGet(&cl->answer,
-                                                                 "Connection");
-                        if (psz_connection != NULL)
-                            do_close = !strcasecmp(psz_connection, "close");
-                    }
-                    else
-                        do_close = true;
-
-                    if (!do_close) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            return POLLIN;
+
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            return POLLOUT;
+
+        case HTTPD_CLIENT_WAITING:
+            if (cl->stream != NULL) {
+                httpd_stream_t *stream = cl->stream;
+                int64_t i_write;
+
+                vlc_mutex_lock(&stream->lock);
+                i_write = httpd_StreamPending(stream, cl,
+                                              &cl->answer.i_body_offset);
+                vlc_mutex_unlock(&stream->lock);
+                if (i_write > 0)
+                    return POLLOUT;
+            }
+            break;
+    }
+    return 0;
+}
 
-            case HTTPD_CLIENT_WAITING:
-                i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+static void httpd_ClientIO(httpd_host_t *host, httpd_client_t *cl, mtime_t now)
+{
+    if (cl->i_state != HTTPD_CLIENT_WAITING)
+        cl->i_activity_date = now;
 
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_WAITING:
+            if (cl->stream != NULL)
+                httpd_ClientStreamSend(cl, now);
+            break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+}
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+/* Accepts a new connection on a listening socket */
+static httpd_client_t *httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return NULL;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return NULL;
+    }
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return NULL;
         }
+        sk = tls;
+    }
+
+    cl = httpd_ClientNew(host, sk, now);
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return NULL;
+    }
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    TAB_APPEND(host->i_client, host->client, cl);
+    host->i_connections++;
+    return cl;
+}
+
+/* Destroys the dead and timed out clients */
+static bool httpd_ClientReap(httpd_host_t *host, int i_client, mtime_t now)
+{
+    httpd_client_t *cl = host->client[i_client];
+
+    if (cl->i_ref < 0 || (cl->i_ref == 0 &&
+                (cl->i_state == HTTPD_CLIENT_DEAD ||
+                  (cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now)))) {
+        TAB_REMOVE(host->i_client, host->client, cl);
+        httpd_ClientDestroy(cl);
+        return true;
+    }
+    return false;
+}
+
+static void httpdLoop(httpd_host_t *host)
+{
+    struct pollfd ufd[host->nfd + host->i_client];
+    unsigned nfd;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+
+    /* add all socket that should be read/write and close dead connection */
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+
+    mtime_t now = mdate();
+    bool b_low_delay = false;
+
+    int canc = vlc_savecancel();
+    for (int i_client = 0; i_client < host->i_client; i_client++) {
+        if (httpd_ClientReap(host, i_client, now)) {
+            i_client--;
+            continue;
+        }
+
+        httpd_client_t *cl = host->client[i_client];
+        struct pollfd *pufd = ufd + nfd;
+        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+
+        pufd->fd = vlc_tls_GetFD(cl->sock);
+        pufd->events = httpd_ClientProcess(host, cl);
+        pufd->revents = 0;
 
         if (pufd->events != 0)
             nfd++;
@@ -1987,21 +2291,11 @@ static void httpdLoop(httpd_host_t *host)
         if (pufd->revents == 0)
             continue; // no event received
 
-        cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        httpd_ClientIO(host, cl, now);
     }
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
         int fd = ufd[nfd].fd;
 
         assert (fd == host->fds[nfd]);
@@ -2009,50 +2303,146 @@ static void httpdLoop(httpd_host_t *host)
         if (ufd[nfd].revents == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
+        httpd_HostAccept(host, fd, now);
+    }
+
+    vlc_restorecancel(canc);
+}
+
+#ifdef HTTPD_EPOLL
+#define HTTPD_EPOLL_EVENTS 64
+
+/* Same as httpdLoop(), but the sockets stay registered edge-triggered with the
+ * kernel: each client remembers its readiness until an operation would block,
+ * and streaming clients are woken up by httpd_StreamSend(). */
+static void httpdLoopEpoll(httpd_host_t *host)
+{
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+
+    mtime_t now = mdate();
+    bool b_busy = false;
+
+    int canc = vlc_savecancel();
+    for (int i_client = 0; i_client < host->i_client; i_client++) {
+        if (httpd_ClientReap(host, i_client, now)) {
+            i_client--;
             continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+        }
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
+        httpd_client_t *cl = host->client[i_client];
+        short events = httpd_ClientProcess(host, cl);
+
+        if ((events & cl->i_ready) || cl->i_state == HTTPD_CLIENT_DEAD)
+            b_busy = true;
+    }
+    vlc_mutex_unlock(&host->lock);
+    vlc_restorecancel(canc);
+
+    int n;
+    while ((n = epoll_wait(host->epfd, ev, HTTPD_EPOLL_EVENTS,
+                           b_busy ? 0 : -1)) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
+
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+
+    now = mdate();
+
+    /* Clients may have been destroyed while waiting: the events can then
+     * not be trusted, so assume all sockets are ready instead. */
+    const bool b_stale = host->b_stale;
+    if (b_stale) {
+        host->b_stale = false;
+        for (int i_client = 0; i_client < host->i_client; i_client++)
+            host->client[i_client]->i_ready = POLLIN | POLLOUT;
+    }
+
+    for (int i = 0; i < n; i++) {
+        void *data = ev[i].data.ptr;
+        unsigned j;
+
+        if (data == &host->wakefd) {
+            uint64_t val;
+
+            /* re-arm the wake-up before looking at the streams again */
+            atomic_store(&host->wake, false);
+            if (read(host->wakefd, &val, sizeof (val)) != sizeof (val))
+                msg_Dbg(host, "spurious wake-up");
             continue;
         }
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
+        for (j = 0; j < host->nfd; j++)
+            if (data == &host->fds[j])
+                break;
 
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
+        if (j < host->nfd) {
+            /* new connection */
+            httpd_client_t *cl = httpd_HostAccept(host, host->fds[j], now);
+            if (cl == NULL)
                 continue;
-            }
-            sk = tls;
+
+            struct epoll_event cev = {
+                .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                .data.ptr = cl,
+            };
+            if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, vlc_tls_GetFD(cl->sock),
+                          &cev))
+                cl->i_state = HTTPD_CLIENT_DEAD;
+        } else if (!b_stale) {
+            httpd_client_t *cl = data;
+
+            if (ev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                cl->i_ready |= POLLIN;
+            if (ev[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                cl->i_ready |= POLLOUT;
         }
+    }
 
-        cl = httpd_ClientNew(sk, now);
+    /* Handle client sockets */
+    for (int i_client = 0; i_client < host->i_client; i_client++) {
+        httpd_client_t *cl = host->client[i_client];
+        short events = 0;
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_RECEIVING:
+            case HTTPD_CLIENT_TLS_HS_IN:
+                events = POLLIN;
+                break;
+            case HTTPD_CLIENT_SENDING:
+            case HTTPD_CLIENT_WAITING:
+            case HTTPD_CLIENT_TLS_HS_OUT:
+                events = POLLOUT;
+                break;
+        }
 
-        TAB_APPEND(host->i_client, host->client, cl);
+        if (events & cl->i_ready)
+            httpd_ClientIO(host, cl, now);
     }
 
     vlc_restorecancel(canc);
 }
+#endif
 
 static void* httpd_HostThread(void *data)
 {
     httpd_host_t *host = data;
 
     vlc_mutex_lock(&host->lock);
+#ifdef HTTPD_EPOLL
+    if (host->epfd != -1) {
+        while (host->i_ref > 0)
+            httpdLoopEpoll(host);
+    } else
+#endif
     while (host->i_ref > 0)
         httpdLoop(host);
     vlc_mutex_unlock(&host->lock);
@@ -36,6 +36,7 @@
 #include "art.h"
 #include "libvlc.h"
 #include "fetcher.h"
+#include "preparser.h"
 #include "input/input_interface.h"
 #include "misc/background_worker.h"
 #include "misc/interrupt.h"
@@ -207,7 +208,8 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0,
+                    playlist_preparser_Priority( req->options ) ) )
             return VLC_SUCCESS;
     }
 
@@ -297,7 +299,8 @@ static void SearchLocal( playlist_fetcher_t* fetcher, struct fetcher_request* re
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( background_worker_Push( fetcher->network, req, NULL, 0,
+                    playlist_preparser_Priority( req->options ) ) )
             SetPreparsed( req );
     }
     else
@@ -404,6 +407,7 @@ static void WorkerInit( playlist_fetcher_t* fetcher,
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
+        .max_threads = var_InheritInteger( fetcher->owner, "preparse-threads" ),
         .pf_start = starter,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
@@ -462,7 +466,8 @@ int playlist_fetcher_Push( playlist_fetcher_t* fetcher, input_item_t* item,
     atomic_init( &req->refs, 1 );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( background_worker_Push( fetcher->local, req, NULL, 0,
+                    playlist_preparser_Priority( req->options ) ) )
         SetPreparsed( req );
 
     RequestRelease( req );
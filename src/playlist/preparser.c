@@ -39,6 +39,19 @@ struct playlist_preparser_t
     atomic_bool deactivated;
 };
 
+struct preparser_request
+{
+    input_item_t* item;
+    input_item_meta_request_option_t options;
+    atomic_uint refs;
+};
+
+struct preparser_task
+{
+    input_thread_t* input;
+    struct preparser_request* req;
+};
+
 static int InputEvent( vlc_object_t* obj, const char* varname,
     vlc_value_t old, vlc_value_t cur, void* worker )
 {
@@ -50,14 +63,24 @@ static int InputEvent( vlc_object_t* obj, const char* varname,
     return VLC_SUCCESS;
 }
 
-static int PreparserOpenInput( void* preparser_, void* item_, void** out )
+static int PreparserOpenInput( void* preparser_, void* req_, void** out )
 {
     playlist_preparser_t* preparser = preparser_;
+    struct preparser_request* req = req_;
+    input_item_t* item = req->item;
 
-    input_thread_t* input = input_CreatePreparser( preparser->owner, item_ );
+    struct preparser_task* task = malloc( sizeof( *task ) );
+    if( unlikely( !task ) )
+    {
+        input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
+        return VLC_ENOMEM;
+    }
+
+    input_thread_t* input = input_CreatePreparser( preparser->owner, item );
     if( !input )
     {
-        input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
+        free( task );
+        input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
         return VLC_EGENERIC;
     }
 
@@ -66,26 +89,34 @@ static int PreparserOpenInput( void* preparser_, void* item_, void** out )
     {
         input_Close( input );
         var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
-        input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
+        free( task );
+        input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
         return VLC_EGENERIC;
     }
 
-    *out = input;
+    task->input = input;
+    task->req = req;
+    *out = task;
     return VLC_SUCCESS;
 }
 
-static int PreparserProbeInput( void* preparser_, void* input_ )
+static int PreparserProbeInput( void* preparser_, void* task_ )
 {
-    int state = input_GetState( input_ );
+    struct preparser_task* task = task_;
+    int state = input_GetState( task->input );
     return state == END_S || state == ERROR_S;
     VLC_UNUSED( preparser_ );
 }
 
-static void PreparserCloseInput( void* preparser_, void* input_ )
+static void PreparserCloseInput( void* preparser_, void* task_ )
 {
     playlist_preparser_t* preparser = preparser_;
-    input_thread_t* input = input_;
+    struct preparser_task* task = task_;
+    input_thread_t* input = task->input;
     input_item_t* item = input_priv(input)->p_item;
+    input_item_meta_request_option_t options = task->req->options;
+
+    free( task );
 
     var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
 
@@ -107,7 +138,9 @@ static void PreparserCloseInput( void* preparser_, void* input_ )
 
     if( preparser->fetcher )
     {
-        if( !playlist_fetcher_Push( preparser->fetcher, item, 0, status ) )
+        if( !playlist_fetcher_Push( preparser->fetcher, item,
+                                    options & META_REQUEST_OPTION_BACKGROUND,
+                                    status ) )
             return;
     }
 
@@ -115,8 +148,22 @@ static void PreparserCloseInput( void* preparser_, void* input_ )
     input_item_SignalPreparseEnded( item, status );
 }
 
-static void InputItemRelease( void* item ) { input_item_Release( item ); }
-static void InputItemHold( void* item ) { input_item_Hold( item ); }
+static void RequestRelease( void* req_ )
+{
+    struct preparser_request* req = req_;
+
+    if( atomic_fetch_sub( &req->refs, 1 ) != 1 )
+        return;
+
+    input_item_Release( req->item );
+    free( req );
+}
+
+static void RequestHold( void* req_ )
+{
+    struct preparser_request* req = req_;
+    atomic_fetch_add_explicit( &req->refs, 1, memory_order_relaxed );
+}
 
 playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 {
@@ -124,11 +171,12 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 
     struct background_worker_config conf = {
         .default_timeout = var_InheritInteger( parent, "preparse-timeout" ),
+        .max_threads = var_InheritInteger( parent, "preparse-threads" ),
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
-        .pf_release = InputItemRelease,
-        .pf_hold = InputItemHold };
+        .pf_release = RequestRelease,
+        .pf_hold = RequestHold };
 
 
     if( likely( preparser ) )
@@ -175,8 +223,23 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    struct preparser_request* req = malloc( sizeof( *req ) );
+    if( unlikely( !req ) )
+    {
+        input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
+        return;
+    }
+
+    req->item = item;
+    req->options = i_options;
+    atomic_init( &req->refs, 1 );
+    input_item_Hold( item );
+
+    if( background_worker_Push( preparser->worker, req, id, timeout,
+                    playlist_preparser_Priority( i_options ) ) )
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
+
+    RequestRelease( req );
 }
 
 void playlist_preparser_fetcher_Push( playlist_preparser_t *preparser,
@@ -199,6 +262,13 @@ void playlist_preparser_Deactivate( playlist_preparser_t* preparser )
 
 void playlist_preparser_Delete( playlist_preparser_t *preparser )
 {
+    struct background_worker_stats stats;
+    background_worker_GetStats( preparser->worker, &stats );
+    msg_Dbg( preparser->owner, "preparsed %"PRIu64" item(s), %"PRIu64
+             " timeout(s), queued %"PRId64" us on average (%"PRId64" us max), "
+             "run %"PRId64" us on average", stats.completed, stats.timeouts,
+             stats.wait_avg, stats.wait_max, stats.run_avg );
+
     background_worker_Delete( preparser->worker );
 
     if( preparser->fetcher )
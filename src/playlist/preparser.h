@@ -26,6 +26,8 @@
 #define _PLAYLIST_PREPARSER_H 1
 
 #include <vlc_input_item.h>
+#include "misc/background_worker.h"
+
 /**
  * Preparser opaque structure.
  *
@@ -58,6 +60,20 @@ void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
                               input_item_meta_request_option_t,
                               int timeout, void *id );
 
+/**
+ * Lane of a preparse or fetch request
+ *
+ * \param options the input_item_meta_request_option_t of the request
+ * \return the low priority lane for background requests, the high one
+ *         otherwise
+ **/
+static inline enum background_worker_priority
+playlist_preparser_Priority( int options )
+{
+    return options & META_REQUEST_OPTION_BACKGROUND
+         ? BACKGROUND_WORKER_PRIORITY_LOW : BACKGROUND_WORKER_PRIORITY_HIGH;
+}
+
 void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
                                       input_item_meta_request_option_t );
 
@@ -23,6 +23,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #undef NDEBUG
 #include <assert.h>
@@ -86,11 +87,310 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static unsigned allocated, released;
+
+static void test_block_Release(block_t *block)
+{
+    released++;
+    free(block);
+}
+
+/* Allocates a block with a release counter. */
+static block_t *test_block_New(size_t size, mtime_t dts)
+{
+    block_t *block = malloc(sizeof (*block) + size);
+    assert(block != NULL);
+
+    block_Init(block, block + 1, size);
+    block->pf_release = test_block_Release;
+    block->i_dts = dts;
+    allocated++;
+    return block;
+}
+
+static void test_block_Slice(void)
+{
+    block_t *parent = test_block_New(sizeof (text), 42);
+    memcpy(parent->p_buffer, text, sizeof (text));
+    parent->i_flags = BLOCK_FLAG_TYPE_I;
+
+    const unsigned base = released;
+    block_t *whole = block_slice_Alloc(parent);
+    assert(whole != NULL);
+    assert(whole->p_buffer == parent->p_buffer);
+    assert(whole->i_buffer == sizeof (text));
+    assert(whole->i_dts == 42);
+    assert(whole->i_flags == BLOCK_FLAG_TYPE_I);
+
+    /* Slices reference the payload of their slice, and get no properties */
+    block_t *first = block_Slice(whole, 0, 16);
+    assert(first != NULL);
+    assert(first->p_buffer == parent->p_buffer);
+    assert(first->i_buffer == 16);
+    assert(first->i_dts == VLC_TS_INVALID);
+    assert(first->i_flags == 0);
+
+    block_t *second = block_Slice(whole, 16, sizeof (text) - 16);
+    assert(second != NULL);
+    assert(second->p_buffer == parent->p_buffer + 16);
+    assert(!memcmp(second->p_buffer, text + 16, sizeof (text) - 16));
+
+    /* Bounds: empty slices at both ends, and a slice up to the end */
+    block_t *head = block_Slice(whole, 0, 0);
+    assert(head != NULL && head->i_buffer == 0);
+    block_t *tail = block_Slice(whole, sizeof (text), 0);
+    assert(tail != NULL && tail->i_buffer == 0);
+    assert(tail->p_buffer == parent->p_buffer + sizeof (text));
+
+    /* Nested slices are relative to their slice, and share the parent */
+    block_t *nested = block_Slice(second, 5, 4);
+    assert(nested != NULL);
+    assert(nested->p_buffer == second->p_buffer + 5);
+    assert(!memcmp(nested->p_buffer, "file", 4));
+    block_t *inner = block_Slice(nested, 4, 0);
+    assert(inner != NULL);
+    assert(inner->p_buffer == nested->p_buffer + 4);
+
+    /* The payload is shared, not copied */
+    memcpy(nested->p_buffer, "FILE", 4);
+    assert(!memcmp(second->p_buffer + 5, "FILE", 4));
+    assert(!memcmp(whole->p_buffer + 21, "FILE", 4));
+
+    /* The parent survives until the last slice, whatever the order */
+    block_Release(whole);
+    block_Release(second);
+    block_Release(head);
+    block_Release(first);
+    block_Release(tail);
+    block_Release(nested);
+    assert(released == base);
+    assert(!memcmp(parent->p_buffer, text, 16));
+    block_Release(inner);
+    assert(released == base + 1);
+    assert(released == allocated);
+
+    /* A parent with a single slice */
+    parent = test_block_New(8, 0);
+    whole = block_slice_Alloc(parent);
+    assert(whole != NULL);
+    block_Release(whole);
+    assert(released == allocated);
+}
+
+static void test_ring_Edges(void)
+{
+    vlc_ring_t *ring = vlc_ring_New(3); /* rounded up to 4 */
+    assert(ring != NULL);
+    assert(vlc_ring_IsEmpty(ring));
+    assert(vlc_ring_Pop(ring) == NULL);
+
+    for (int i = 0; i < 4; i++)
+        assert(vlc_ring_Push(ring, test_block_New(i, i)));
+    assert(vlc_ring_GetCount(ring) == 4);
+    assert(vlc_ring_GetBytes(ring) == 0 + 1 + 2 + 3);
+
+    /* A full ring leaves the block to the caller */
+    block_t *extra = test_block_New(4, 4);
+    assert(!vlc_ring_Push(ring, extra));
+    assert(extra->p_next == NULL);
+    assert(vlc_ring_GetCount(ring) == 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        block_t *block = vlc_ring_Pop(ring);
+        assert(block != NULL);
+        assert(block->i_dts == i);
+        assert(block->i_buffer == (size_t)i);
+        block_Release(block);
+    }
+    assert(vlc_ring_IsEmpty(ring));
+    assert(vlc_ring_GetBytes(ring) == 0);
+    assert(vlc_ring_Pop(ring) == NULL);
+
+    /* One slot is free again */
+    assert(vlc_ring_Push(ring, extra));
+    assert(vlc_ring_Pop(ring) == extra);
+    block_Release(extra);
+
+    vlc_ring_Delete(ring);
+    assert(released == allocated);
+}
+
+static void test_ring_Wrap(void)
+{
+    vlc_ring_t *ring = vlc_ring_New(4);
+    assert(ring != NULL);
+
+    /* Go round the ring many times, with a partly filled ring */
+    mtime_t in = 0, out = 0;
+
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        for (;;)
+        {
+            block_t *block = test_block_New(1, in);
+            if (!vlc_ring_Push(ring, block))
+            {
+                block_Release(block);
+                break;
+            }
+            in++;
+        }
+        assert(in - out == 4);
+        assert(vlc_ring_GetCount(ring) == 4);
+
+        for (unsigned j = 0; j < 1 + (i % 4); j++)
+        {
+            block_t *block = vlc_ring_Pop(ring);
+            assert(block != NULL);
+            assert(block->i_dts == out++);
+            block_Release(block);
+        }
+    }
+
+    /* A chain takes a single slot, but comes out block by block */
+    while (out < in)
+    {
+        block_t *block = vlc_ring_Pop(ring);
+        assert(block->i_dts == out++);
+        block_Release(block);
+    }
+
+    block_t *chain = NULL;
+    for (int i = 0; i < 3; i++)
+        block_ChainAppend(&chain, test_block_New(2, in++));
+    assert(vlc_ring_Push(ring, chain));
+    for (int i = 0; i < 3; i++)
+        assert(vlc_ring_Push(ring, test_block_New(1, in++)));
+    assert(vlc_ring_GetCount(ring) == 6);
+    assert(vlc_ring_GetBytes(ring) == 3 * 2 + 3);
+
+    while (out < in)
+    {
+        block_t *block = vlc_ring_Pop(ring);
+        assert(block != NULL);
+        assert(block->p_next == NULL);
+        assert(block->i_dts == out++);
+        block_Release(block);
+        assert(vlc_ring_GetCount(ring) == (size_t)(in - out));
+    }
+    assert(vlc_ring_Pop(ring) == NULL);
+
+    vlc_ring_Delete(ring);
+    assert(released == allocated);
+}
+
+static void test_ring_Discard(void)
+{
+    vlc_ring_t *ring = vlc_ring_New(4);
+    assert(ring != NULL);
+
+    block_t *chain = NULL;
+    block_ChainAppend(&chain, test_block_New(5, 0));
+    block_ChainAppend(&chain, test_block_New(5, 1));
+    assert(vlc_ring_Push(ring, chain));
+    assert(vlc_ring_Push(ring, test_block_New(5, 2)));
+
+    /* The consumer already took part of the chain */
+    block_t *block = vlc_ring_Pop(ring);
+    assert(block->i_dts == 0);
+    block_Release(block);
+
+    vlc_ring_Discard(ring);
+    assert(vlc_ring_IsEmpty(ring));
+    assert(vlc_ring_GetBytes(ring) == 0);
+
+    assert(vlc_ring_Push(ring, test_block_New(7, 3)));
+    assert(vlc_ring_GetCount(ring) == 1);
+    assert(vlc_ring_GetBytes(ring) == 7);
+
+    block = vlc_ring_Pop(ring);
+    assert(block != NULL);
+    assert(block->i_dts == 3);
+    /* The discarded blocks were released on the way */
+    assert(released == allocated - 1);
+    block_Release(block);
+    assert(vlc_ring_Pop(ring) == NULL);
+
+    vlc_ring_Delete(ring);
+}
+
+static void test_ring_Delete(void)
+{
+    vlc_ring_t *ring = vlc_ring_New(8);
+    assert(ring != NULL);
+
+    for (int i = 0; i < 5; i++)
+    {
+        block_t *chain = NULL;
+        for (int j = 0; j <= i; j++)
+            block_ChainAppend(&chain, test_block_New(j, j));
+        assert(vlc_ring_Push(ring, chain));
+    }
+
+    /* Leave a split chain in its slot */
+    block_Release(vlc_ring_Pop(ring));
+    block_Release(vlc_ring_Pop(ring));
+    assert(released + 13 == allocated);
+
+    vlc_ring_Delete(ring);
+    assert(released == allocated);
+}
+
+#define RING_THREAD_BLOCKS 100000
+
+static void *test_ring_Producer(void *data)
+{
+    vlc_ring_t *ring = data;
+
+    for (unsigned i = 0; i < RING_THREAD_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc(i % 7);
+        assert(block != NULL);
+        block->i_dts = i;
+
+        while (!vlc_ring_Push(ring, block)); /* busy wait if full */
+    }
+    return NULL;
+}
+
+static void test_ring_Threads(void)
+{
+    vlc_ring_t *ring = vlc_ring_New(16);
+    vlc_thread_t th;
+
+    assert(ring != NULL);
+    assert(vlc_clone(&th, test_ring_Producer, ring,
+                     VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (unsigned i = 0; i < RING_THREAD_BLOCKS; i++)
+    {
+        block_t *block;
+
+        while ((block = vlc_ring_Pop(ring)) == NULL); /* busy wait if empty */
+        assert(block->i_dts == (mtime_t)i);
+        assert(block->i_buffer == i % 7);
+        assert(vlc_ring_GetCount(ring) <= 16);
+        block_Release(block);
+    }
+
+    vlc_join(th, NULL);
+    assert(vlc_ring_IsEmpty(ring));
+    assert(vlc_ring_Pop(ring) == NULL);
+    vlc_ring_Delete(ring);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Slice();
+    test_ring_Edges();
+    test_ring_Wrap();
+    test_ring_Discard();
+    test_ring_Delete();
+    test_ring_Threads();
     return 0;
 }
 
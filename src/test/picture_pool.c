@@ -106,6 +106,45 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void test_grow(void)
+{
+    /* More pictures than bits in a word of the bitmap */
+    const unsigned count = 100, extra = 60;
+    picture_t *pics[count + extra];
+
+    pool = picture_pool_NewFromFormat(&fmt, count);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < count; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    assert(picture_pool_Grow(pool, extra) == VLC_SUCCESS);
+    assert(picture_pool_GetSize(pool) == count + extra);
+    /* The pool can only grow by 64 pictures */
+    assert(picture_pool_Grow(pool, 64 - extra + 1) != VLC_SUCCESS);
+    assert(picture_pool_GetSize(pool) == count + extra);
+
+    for (unsigned i = count; i < count + extra; i++) {
+        pics[i] = picture_pool_Wait(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    for (unsigned i = 0; i < count + extra; i++)
+        picture_Release(pics[i]);
+
+    reserve = picture_pool_Reserve(pool, count);
+    assert(reserve != NULL);
+    /* Only heap pools can grow */
+    assert(picture_pool_Grow(reserve, 1) != VLC_SUCCESS);
+
+    picture_pool_Release(reserve);
+    picture_pool_Release(pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -122,6 +161,7 @@ int main(void)
 
     test(false);
     test(true);
+    test_grow();
 
     return 0;
 }
@@ -31,12 +31,20 @@
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+
+    /* Rendered pictures, depending on whether the decoder pool was the
+     * display pool, or pictures had to be copied to the display pool. These
+     * are not reset by vout_statistic_GetReset(). */
+    atomic_uint direct;
+    atomic_uint copied;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    atomic_init(&stat->direct, 0);
+    atomic_init(&stat->copied, 0);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -63,4 +71,18 @@ static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
     atomic_fetch_add(&stat->lost, lost);
 }
 
+static inline void vout_statistic_AddRendered(vout_statistic_t *stat,
+                                              bool copied)
+{
+    atomic_fetch_add(copied ? &stat->copied : &stat->direct, 1);
+}
+
+static inline void vout_statistic_GetRendered(vout_statistic_t *stat,
+                                              unsigned *restrict direct,
+                                              unsigned *restrict copied)
+{
+    *direct = atomic_load(&stat->direct);
+    *copied = atomic_load(&stat->copied);
+}
+
 #endif
@@ -1046,7 +1046,9 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         picture_Copy(direct, todisplay);
         picture_Release(todisplay);
         todisplay = direct;
-    }
+        vout_statistic_AddRendered(&vout->p->statistic, true);
+    } else if (sys->display.use_dr)
+        vout_statistic_AddRendered(&vout->p->statistic, false);
 
     /*
      * Take a snapshot if requested
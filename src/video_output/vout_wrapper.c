@@ -141,6 +141,17 @@ int vout_InitWrapper(vout_thread_t *vout)
                  display_pool_size, picture_pool_GetSize(display_pool));
 #endif
 
+    /* Heap-allocated display pools can be extended, so that the decoder
+     * renders in them directly instead of having its pictures copied. */
+    if (allow_dr &&
+        picture_pool_GetSize(display_pool) < reserved_picture + decoder_picture) {
+        unsigned missing = reserved_picture + decoder_picture
+                         - picture_pool_GetSize(display_pool);
+
+        if (picture_pool_Grow(display_pool, missing) == VLC_SUCCESS)
+            msg_Dbg(vout, "added %u pictures to the display pool", missing);
+    }
+
     if (allow_dr &&
         picture_pool_GetSize(display_pool) >= reserved_picture + decoder_picture) {
         sys->dpb_size     = picture_pool_GetSize(display_pool) - reserved_picture;
@@ -181,6 +192,12 @@ void vout_EndWrapper(vout_thread_t *vout)
 
     assert(vout->p->decoder_pool && vout->p->private_pool);
 
+    unsigned direct, copied;
+    vout_statistic_GetRendered(&sys->statistic, &direct, &copied);
+    if (copied > 0)
+        msg_Dbg(vout, "%u pictures copied to the display pool, %u direct",
+                copied, direct);
+
     picture_pool_Release(sys->private_pool);
 
     if (sys->decoder_pool != sys->display_pool)
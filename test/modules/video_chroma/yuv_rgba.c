@@ -0,0 +1,192 @@
+/*****************************************************************************
+ * yuv_rgba.c: YUV to RGBA/BGRA converters test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_fourcc.h>
+#include "../modules/video_chroma/yuv_rgba_conv.h"
+#include "../modules/video_chroma/yuv_rgba_conv.c"
+
+#define MAX_WIDTH 1920
+
+static const video_color_space_t spaces[] = {
+    COLOR_SPACE_BT601, COLOR_SPACE_BT709, COLOR_SPACE_BT2020,
+};
+
+static uint8_t luma[MAX_WIDTH * 2];
+static uint8_t chroma[2][MAX_WIDTH * 2 * 2];
+static uint8_t ref[MAX_WIDTH * 4], out[MAX_WIDTH * 4];
+
+static void PutSample( uint8_t *p, unsigned i, unsigned i_size, unsigned v )
+{
+    if( i_size == 1 )
+        p[i] = v;
+    else
+        SetWLE( &p[2 * i], v );
+}
+
+/* Random samples of the format depth, P010 being stored in the MSB */
+static void FillRandom( unsigned i_depth, bool b_msb, unsigned i_size )
+{
+    const unsigned i_shift = b_msb ? 16 - i_depth : 0;
+
+    for( unsigned i = 0; i < MAX_WIDTH; i++ )
+        PutSample( luma, i, i_size, (rand() % (1 << i_depth)) << i_shift );
+    for( unsigned p = 0; p < 2; p++ )
+        for( unsigned i = 0; i < 2 * MAX_WIDTH; i++ )
+            PutSample( chroma[p], i, i_size,
+                       (rand() % (1 << i_depth)) << i_shift );
+}
+
+static void ConvertLine( const yuv_rgba_conv_t *p_conv, yuv_rgba_line_cb pf_line,
+                         uint8_t *p_dst, unsigned i_width )
+{
+    const bool b_semi = p_conv->i_layout >= YUV_RGBA_SEMIPLANAR;
+    pf_line( p_conv, p_dst, luma, chroma[0], b_semi ? NULL : chroma[1],
+             i_width );
+}
+
+/* Every SIMD converter must give the same result as the C one, including
+ * at the end of lines of any width */
+static void test_bitexact( void )
+{
+    const unsigned i_impls = yuv_rgba_CountImpl();
+
+    for( size_t f = 0; f < ARRAY_SIZE(formats); f++ )
+    for( size_t s = 0; s < ARRAY_SIZE(spaces); s++ )
+    for( int i_range = 0; i_range < 2; i_range++ )
+    for( int i_out = 0; i_out < 2; i_out++ )
+    {
+        yuv_rgba_conv_t conv;
+        int ret = yuv_rgba_Init( &conv, formats[f].i_chroma,
+                                 i_out ? VLC_CODEC_BGRA : VLC_CODEC_RGBA,
+                                 spaces[s], i_range );
+        assert( ret == VLC_SUCCESS );
+
+        const bool b_p010 = formats[f].i_chroma == VLC_CODEC_P010;
+        FillRandom( b_p010 ? 10 : formats[f].i_depth, b_p010,
+                    conv.i_sample_size );
+
+        for( unsigned i_width = 1; i_width <= 67; i_width += 11 )
+        {
+            ConvertLine( &conv, ConvertLineC, ref, i_width );
+            for( unsigned i = 0; i + 1 < i_impls; i++ )
+            {
+                yuv_rgba_line_cb pf_line = yuv_rgba_GetImpl( &conv, i );
+                if( pf_line == NULL )
+                    continue;
+                memset( out, 0, sizeof(out) );
+                ConvertLine( &conv, pf_line, out, i_width );
+                if( memcmp( out, ref, 4 * i_width ) )
+                {
+                    fprintf( stderr, "%4.4s %s mismatch, width %u\n",
+                             (const char *)&formats[f].i_chroma,
+                             yuv_rgba_ImplName( i ), i_width );
+                    abort();
+                }
+            }
+        }
+    }
+}
+
+/* Converts colors back and forth, with the usual formulas */
+static void test_matrices( void )
+{
+    static const struct { double kr, kb; } k[] = {
+        { 0.299, 0.114 }, { 0.2126, 0.0722 }, { 0.2627, 0.0593 },
+    };
+    static const vlc_fourcc_t chromas[] = {
+        VLC_CODEC_I444, VLC_CODEC_I444_10L, VLC_CODEC_I444_16L,
+    };
+    static const unsigned depths[] = { 8, 10, 16 };
+
+    for( size_t c = 0; c < ARRAY_SIZE(chromas); c++ )
+    for( size_t s = 0; s < ARRAY_SIZE(spaces); s++ )
+    for( int i_range = 0; i_range < 2; i_range++ )
+    {
+        const double kg = 1. - k[s].kr - k[s].kb;
+        const double max = (1 << depths[c]) - 1;
+        const double scale = (1 << depths[c]) / 256.;
+        yuv_rgba_conv_t conv;
+
+        int ret = yuv_rgba_Init( &conv, chromas[c], VLC_CODEC_RGBA,
+                                 spaces[s], i_range );
+        assert( ret == VLC_SUCCESS );
+
+        for( unsigned i = 0; i < MAX_WIDTH; i++ )
+        {
+            const double r = rand() % 256 / 255.;
+            const double g = rand() % 256 / 255.;
+            const double b = rand() % 256 / 255.;
+            const double y = k[s].kr * r + kg * g + k[s].kb * b;
+            const double u = (b - y) / (2. * (1. - k[s].kb));
+            const double v = (r - y) / (2. * (1. - k[s].kr));
+            double yq, uq, vq;
+
+            if( i_range )
+            {
+                yq = y * max;
+                uq = (u * 255. + 128.) * scale;
+                vq = (v * 255. + 128.) * scale;
+            }
+            else
+            {
+                yq = (y * 219. + 16.) * scale;
+                uq = (u * 224. + 128.) * scale;
+                vq = (v * 224. + 128.) * scale;
+            }
+            PutSample( luma, i, conv.i_sample_size, VLC_CLIP( lround( yq ), 0, max ) );
+            PutSample( chroma[0], i, conv.i_sample_size, VLC_CLIP( lround( uq ), 0, max ) );
+            PutSample( chroma[1], i, conv.i_sample_size, VLC_CLIP( lround( vq ), 0, max ) );
+
+            ref[4 * i + 0] = lround( r * 255. );
+            ref[4 * i + 1] = lround( g * 255. );
+            ref[4 * i + 2] = lround( b * 255. );
+            ref[4 * i + 3] = 255;
+        }
+
+        ConvertLine( &conv, ConvertLineC, out, MAX_WIDTH );
+        for( unsigned i = 0; i < 4 * MAX_WIDTH; i++ )
+        {
+            /* quantization of 8-bit limited range YUV */
+            if( abs( out[i] - ref[i] ) > 2 )
+            {
+                fprintf( stderr, "%4.4s space %d range %d: %u instead of %u\n",
+                         (const char *)&chromas[c], spaces[s], i_range,
+                         out[i], ref[i] );
+                abort();
+            }
+        }
+    }
+}
+
+int main( void )
+{
+    test_bitexact();
+    test_matrices();
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * yuv_rgba_bench.c: YUV to RGBA/BGRA converters benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_fourcc.h>
+#include "../modules/video_chroma/yuv_rgba_conv.h"
+#include "../modules/video_chroma/yuv_rgba_conv.c"
+
+#define MAX_WIDTH 1920
+
+static uint8_t luma[MAX_WIDTH * 2];
+static uint8_t chroma[2][MAX_WIDTH * 2 * 2];
+static uint8_t out[MAX_WIDTH * 4];
+
+static void benchmark( unsigned i_lines )
+{
+    static const vlc_fourcc_t chromas[] = {
+        VLC_CODEC_I420, VLC_CODEC_NV12, VLC_CODEC_I444,
+        VLC_CODEC_I420_10L, VLC_CODEC_P010, VLC_CODEC_I444_16L,
+    };
+
+    for( size_t i = 0; i < sizeof(luma); i++ )
+        luma[i] = rand();
+    for( size_t i = 0; i < sizeof(chroma); i++ )
+        chroma[i / sizeof(chroma[0])][i % sizeof(chroma[0])] = rand();
+
+    for( size_t c = 0; c < ARRAY_SIZE(chromas); c++ )
+    {
+        yuv_rgba_conv_t conv;
+        int ret = yuv_rgba_Init( &conv, chromas[c], VLC_CODEC_RGBA,
+                                 COLOR_SPACE_BT709, false );
+        assert( ret == VLC_SUCCESS );
+
+        const bool b_semi = conv.i_layout >= YUV_RGBA_SEMIPLANAR;
+
+        for( unsigned i = 0; i < yuv_rgba_CountImpl(); i++ )
+        {
+            yuv_rgba_line_cb pf_line = yuv_rgba_GetImpl( &conv, i );
+            if( pf_line == NULL )
+                continue;
+
+            mtime_t i_start = mdate();
+            for( unsigned y = 0; y < i_lines; y++ )
+                pf_line( &conv, out, luma, chroma[0],
+                         b_semi ? NULL : chroma[1], MAX_WIDTH );
+            mtime_t i_time = __MAX( mdate() - i_start, 1 );
+
+            printf( "%4.4s %-6s %8"PRId64" us, %.1f Mpixels/s\n",
+                    (const char *)&chromas[c], yuv_rgba_ImplName( i ),
+                    i_time, (double)i_lines * MAX_WIDTH / i_time );
+        }
+    }
+}
+
+/* Usage: yuv_rgba_bench [lines to convert] */
+int main( int argc, char *argv[] )
+{
+    benchmark( argc > 1 ? strtoul( argv[1], NULL, 0 ) : 1080 );
+    return 0;
+}
@@ -37,6 +37,20 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* additional LibVLC options (e.g. "--ts-threads=4") */
+    int argc;
+    const char *const *argv;
+
+    /* if not NULL, receives the time spent in the demuxer (in microseconds) */
+    int64_t *demux_time;
+
+    /* if not NULL, receive the payload bytes that the demuxer referenced
+     * from its input buffers, and the ones it copied, as published in the
+     * "demux-sliced-bytes" and "demux-copied-bytes" variables at the end
+     * of the stream (zero if the demuxer does not report them) */
+    uint64_t *demux_sliced_bytes;
+    uint64_t *demux_copied_bytes;
 };
 
 void vlc_run_args_init(struct vlc_run_args *args);
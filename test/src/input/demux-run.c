@@ -280,6 +280,7 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
 
     uintmax_t i = 0;
     int val;
+    mtime_t start = mdate();
 
     while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS)
     {
@@ -305,9 +306,17 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
         i++;
     }
 
+    if (args->demux_sliced_bytes != NULL)
+        *args->demux_sliced_bytes = var_GetInteger(demux, "demux-sliced-bytes");
+    if (args->demux_copied_bytes != NULL)
+        *args->demux_copied_bytes = var_GetInteger(demux, "demux-copied-bytes");
+
     demux_Delete(demux);
     es_out_Delete(out);
 
+    if (args->demux_time != NULL)
+        *args->demux_time = mdate() - start;
+
     debug("Completed with %ju iteration(s).\n", i);
 
     return val == VLC_DEMUXER_EOF ? 0 : -1;
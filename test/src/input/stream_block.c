@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * stream_block.c: chained block stream unit test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+/* Each call of the access returns one chain: the strings of a line, with
+ * "" for an empty block. */
+static const char *const chains[][4] = {
+    { "abc", "", "def", NULL },
+    { "", "ghi", NULL },
+    { "", "", NULL },
+    { "jk", "", "", "l" },
+};
+
+static unsigned allocated, released;
+
+struct test_block
+{
+    block_t self;
+    char data[8];
+};
+
+static void ReleaseBlock(block_t *block)
+{
+    released++;
+    free(block);
+}
+
+static block_t *NewBlock(const char *str)
+{
+    struct test_block *b = malloc(sizeof (*b));
+    assert(b != NULL);
+
+    size_t len = strlen(str);
+    assert(len <= sizeof (b->data));
+    memcpy(b->data, str, len);
+    block_Init(&b->self, b->data, len);
+    b->self.pf_release = ReleaseBlock;
+    allocated++;
+    return &b->self;
+}
+
+static block_t *Block(stream_t *s, bool *restrict eof)
+{
+    unsigned *index = s->p_sys;
+
+    if (*index >= ARRAY_SIZE(chains))
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    block_t *chain = NULL, **pp = &chain;
+    for (unsigned i = 0; i < 4 && chains[*index][i] != NULL; i++)
+    {
+        *pp = NewBlock(chains[*index][i]);
+        pp = &(*pp)->p_next;
+    }
+    (*index)++;
+    return chain;
+}
+
+static int Control(stream_t *s, int query, va_list ap)
+{
+    (void) s; (void) query; (void) ap;
+    return VLC_EGENERIC;
+}
+
+static void Destroy(stream_t *s)
+{
+    (void) s;
+}
+
+static stream_t *NewStream(vlc_object_t *parent, unsigned *index)
+{
+    stream_t *s = vlc_stream_CommonNew(parent, Destroy);
+    assert(s != NULL);
+
+    *index = 0;
+    s->pf_block = Block;
+    s->pf_control = Control;
+    s->p_sys = index;
+    return s;
+}
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+    vlc_object_t *parent;
+    stream_t *s;
+    unsigned index;
+    char buf[16];
+    ssize_t val;
+
+    test_init();
+
+    vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    /* The whole content, empty blocks included, is read in order */
+    s = NewStream(parent, &index);
+    val = vlc_stream_Read(s, buf, sizeof (buf));
+    assert(val == 12);
+    assert(memcmp(buf, "abcdefghijkl", 12) == 0);
+    assert(vlc_stream_Tell(s) == 12);
+    val = vlc_stream_Read(s, buf, sizeof (buf));
+    assert(val == 0);
+    assert(vlc_stream_Eof(s));
+    vlc_stream_Delete(s);
+    assert(released == allocated);
+
+    /* Reads ending on a block boundary, before an empty block */
+    s = NewStream(parent, &index);
+    val = vlc_stream_Read(s, buf, 3);
+    assert(val == 3);
+    assert(memcmp(buf, "abc", 3) == 0);
+    val = vlc_stream_Read(s, buf, 3);
+    assert(val == 3);
+    assert(memcmp(buf, "def", 3) == 0);
+    val = vlc_stream_Read(s, buf, 5);
+    assert(val == 5);
+    assert(memcmp(buf, "ghijk", 5) == 0);
+    val = vlc_stream_Read(s, buf, 1);
+    assert(val == 1);
+    assert(buf[0] == 'l');
+    assert(vlc_stream_Tell(s) == 12);
+    vlc_stream_Delete(s);
+    assert(released == allocated);
+
+    /* Peeking only takes the head of the chain */
+    s = NewStream(parent, &index);
+    val = vlc_stream_Read(s, buf, 2);
+    assert(val == 2);
+    const uint8_t *peek;
+    val = vlc_stream_Peek(s, &peek, 4);
+    assert(val == 4);
+    assert(memcmp(peek, "cdef", 4) == 0);
+    val = vlc_stream_Read(s, buf, 6);
+    assert(val == 6);
+    assert(memcmp(buf, "cdefgh", 6) == 0);
+    vlc_stream_Delete(s);
+    /* The queued rest of the chain is released with the stream */
+    assert(released == allocated);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ * block_pool.c: block allocation pool unit test
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+/* Overhead of block_Alloc(): alignment, and padding before and after */
+#define OVERHEAD (sizeof (block_t) + 32 + 2 * 32)
+
+/* Size of the buffer of a pooled block (the size class of the allocation) */
+static size_t PooledSize(size_t size)
+{
+    size_t alloc = 512;
+
+    while (alloc < OVERHEAD + size)
+        alloc <<= 1;
+    return alloc - sizeof (block_t);
+}
+
+static bool IsPooled(const block_t *block, size_t size)
+{
+    if (block->i_size == PooledSize(size))
+        return true;
+    assert(block->i_size == OVERHEAD + size - sizeof (block_t));
+    return false;
+}
+
+static libvlc_instance_t *NewInstance(bool pool)
+{
+    const char *argv[test_defaults_nargs + 1];
+
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = pool ? "--block-pool" : "--no-block-pool";
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs + 1, argv);
+    assert(vlc != NULL);
+    return vlc;
+}
+
+static void test_pool_Recycle(void)
+{
+    struct block_pool_stats before, after;
+
+    block_pool_GetStats(&before);
+
+    /* Rounded up to a size class, with the rest as headroom */
+    block_t *block = block_Alloc(1000);
+    assert(block != NULL);
+    assert(IsPooled(block, 1000));
+    assert(block->i_buffer == 1000);
+
+    const size_t tail = block->p_start + block->i_size - block->p_buffer;
+    uint8_t *buf = block->p_buffer;
+    assert(tail > 1000);
+    block = block_TryRealloc(block, 0, tail);
+    assert(block != NULL);
+    assert(block->p_buffer == buf); /* grown in place */
+    assert(block->i_buffer == tail);
+
+    /* The buffer is recycled for another allocation of the same class */
+    block_t *prev = block;
+    block_Release(block);
+    block = block_Alloc(1200);
+    assert(block == prev);
+    assert(block->i_buffer == 1200);
+    block_Release(block);
+
+    block_pool_GetStats(&after);
+    assert(after.hits > before.hits);
+    assert(after.bytes >= PooledSize(1200) + sizeof (block_t));
+
+    /* Large allocations are not pooled */
+    block = block_Alloc(1 << 20);
+    assert(block != NULL);
+    assert(!IsPooled(block, 1 << 20));
+    block_Release(block);
+}
+
+#define BLOCKS 1000
+
+struct test_thread
+{
+    block_t *blocks[BLOCKS];
+    vlc_sem_t done, quit;
+};
+
+static void *Allocate(void *data)
+{
+    struct test_thread *t = data;
+
+    /* Blocks are usually allocated in a thread, and released in another */
+    for (int round = 0; round < 2; round++)
+    {
+        for (unsigned i = 0; i < BLOCKS; i++)
+        {
+            t->blocks[i] = block_Alloc(i * 61);
+            assert(t->blocks[i] != NULL);
+        }
+        vlc_sem_post(&t->done);
+        vlc_sem_wait(&t->quit);
+    }
+
+    /* Keep a thread cache until the pool is destroyed */
+    block_Release(block_Alloc(4000));
+    vlc_sem_post(&t->done);
+    vlc_sem_wait(&t->quit);
+    return NULL;
+}
+
+static void test_pool_Threads(void)
+{
+    struct test_thread t;
+    vlc_thread_t th;
+
+    vlc_sem_init(&t.done, 0);
+    vlc_sem_init(&t.quit, 0);
+
+    libvlc_instance_t *vlc = NewInstance(true);
+    assert(vlc_clone(&th, Allocate, &t, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (int round = 0; round < 2; round++)
+    {
+        vlc_sem_wait(&t.done);
+        for (unsigned i = 0; i < BLOCKS; i++)
+            block_Release(t.blocks[i]);
+        vlc_sem_post(&t.quit);
+    }
+
+    /* The pool goes away while the other thread still has its cache */
+    vlc_sem_wait(&t.done);
+    libvlc_release(vlc);
+    vlc_sem_post(&t.quit);
+    vlc_join(th, NULL);
+
+    vlc_sem_destroy(&t.quit);
+    vlc_sem_destroy(&t.done);
+}
+
+int main(void)
+{
+    test_init();
+
+    /* The pool is off by default */
+    libvlc_instance_t *vlc = NewInstance(false);
+    block_t *block = block_Alloc(1000);
+    assert(block != NULL);
+    assert(!IsPooled(block, 1000));
+    block_Release(block);
+    libvlc_release(vlc);
+
+    vlc = NewInstance(true);
+    test_pool_Recycle();
+
+    /* The pool lives as long as its last user */
+    libvlc_instance_t *vlc2 = NewInstance(true);
+    block = block_Alloc(3000);
+    assert(IsPooled(block, 3000));
+    libvlc_release(vlc);
+
+    block_t *other = block_Alloc(3000);
+    assert(IsPooled(other, 3000));
+    block_Release(other);
+    libvlc_release(vlc2);
+
+    /* Blocks allocated from the pool outlive it */
+    block_Release(block);
+    block = block_Alloc(3000);
+    assert(!IsPooled(block, 3000));
+    block_Release(block);
+
+    test_pool_Threads();
+    return 0;
+}
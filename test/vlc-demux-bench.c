@@ -0,0 +1,143 @@
+/**
+ * @file vlc-demux-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/input/demux-run.h"
+
+/* Demuxes the files from memory, so that the I/O is not measured, and
+ * reports the throughput, in MPEG-TS packets for convenience. For the
+ * demuxers that report it (TS and MKV), also reports how much of the
+ * payload was referenced from the input buffers (sliced) instead of
+ * copied, per second of demuxing. */
+
+static unsigned char *read_file(const char *path, size_t *length)
+{
+    FILE *stream = fopen(path, "rb");
+    if (stream == NULL)
+        return NULL;
+
+    unsigned char *buf = NULL;
+    size_t size = 0;
+
+    for (;;)
+    {
+        unsigned char *newbuf = realloc(buf, size + 65536);
+        if (newbuf == NULL)
+        {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = newbuf;
+
+        size_t len = fread(buf + size, 1, 65536, stream);
+        size += len;
+        if (len < 65536)
+            break;
+    }
+
+    fclose(stream);
+    *length = size;
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    struct vlc_run_args args;
+    vlc_run_args_init(&args);
+
+    /* Leading options are passed to LibVLC */
+    int i = 1;
+    while (i < argc && !strncmp(argv[i], "--", 2))
+        i++;
+    args.argc = i - 1;
+    args.argv = (const char *const *)&argv[1];
+
+    if (i >= argc)
+    {
+        fprintf(stderr, "Usage: [VLC_TARGET=demux] %s [--option...] "
+                "<filename>...\n", argv[0]);
+        return 1;
+    }
+
+    int64_t total_time = 0;
+    uint64_t total_size = 0, total_sliced = 0, total_copied = 0;
+    int ret = 0;
+
+    for (; i < argc; i++)
+    {
+        size_t length;
+        unsigned char *buf = read_file(argv[i], &length);
+        if (buf == NULL)
+        {
+            fprintf(stderr, "Error: cannot read %s\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+
+        int64_t time = 0;
+        uint64_t sliced = 0, copied = 0;
+        args.demux_time = &time;
+        args.demux_sliced_bytes = &sliced;
+        args.demux_copied_bytes = &copied;
+        if (vlc_demux_process_memory(&args, buf, length))
+            ret = 1;
+        free(buf);
+
+        if (time <= 0)
+            time = 1;
+        printf("%s: %zu bytes in %"PRId64" us, %.2f MiB/s, %.0f packets/s\n",
+               argv[i], length, time, length / (time * 1.048576),
+               (length / 188.) * 1000000. / time);
+        if (sliced + copied > 0)
+            printf("%s: %"PRIu64" bytes sliced (%.2f MiB/s), %"PRIu64" bytes "
+                   "copied (%.2f MiB/s)\n", argv[i],
+                   sliced, sliced / (time * 1.048576),
+                   copied, copied / (time * 1.048576));
+
+        total_time += time;
+        total_size += length;
+        total_sliced += sliced;
+        total_copied += copied;
+    }
+
+    if (total_time > 0)
+    {
+        printf("total: %"PRIu64" bytes in %"PRId64" us, %.2f MiB/s, "
+               "%.0f packets/s\n", total_size, total_time,
+               total_size / (total_time * 1.048576),
+               (total_size / 188.) * 1000000. / total_time);
+        if (total_sliced + total_copied > 0)
+            printf("total: %"PRIu64" bytes sliced (%.2f MiB/s), %"PRIu64
+                   " bytes copied (%.2f MiB/s)\n",
+                   total_sliced, total_sliced / (total_time * 1.048576),
+                   total_copied, total_copied / (total_time * 1.048576));
+    }
+
+    return ret;
+}
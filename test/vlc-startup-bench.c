@@ -0,0 +1,99 @@
+/**
+ * @file vlc-startup-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2018 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vlc/vlc.h>
+
+/* Measures the time to create a LibVLC instance, i.e. mostly the time to
+ * enumerate the plugins. Run vlc-cache-gen beforehand to measure the
+ * plugins cache rather than the loading of every plugin. The first run is
+ * reported separately, as it also includes the dynamic linking of LibVLC
+ * and the cache is likely not in memory yet. */
+
+static int64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char *argv[])
+{
+    /* Leading options are passed to LibVLC */
+    int i = 1;
+    while (i < argc && !strncmp(argv[i], "--", 2))
+        i++;
+
+    unsigned runs = 10;
+    if (i < argc)
+    {
+        char *end;
+        unsigned long n = strtoul(argv[i], &end, 10);
+
+        if (*end != '\0' || n == 0 || n > 100000)
+        {
+            fprintf(stderr, "Usage: %s [--option...] [runs]\n", argv[0]);
+            return 1;
+        }
+        runs = n;
+    }
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+
+    const char *const *vlc_argv = (const char *const *)&argv[1];
+    int64_t first = 0, min = INT64_MAX, total = 0;
+
+    for (unsigned run = 0; run <= runs; run++)
+    {
+        int64_t start = now();
+        libvlc_instance_t *vlc = libvlc_new(i - 1, vlc_argv);
+        int64_t time = now() - start;
+
+        if (vlc == NULL)
+        {
+            fprintf(stderr, "Error: cannot initialize LibVLC\n");
+            return 1;
+        }
+        libvlc_release(vlc);
+
+        if (run == 0)
+        {
+            first = time;
+            continue;
+        }
+        if (time < min)
+            min = time;
+        total += time;
+    }
+
+    printf("libvlc_new: first %"PRId64" us, then min %"PRId64" us, "
+           "avg %"PRId64" us over %u runs\n", first, min, total / runs, runs);
+    return 0;
+}